@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const float AGENT_RADIUS = 0.5f;
+    const float AGENT_STEP = 0.1f;
+    const unsigned TICKS = 10;
+
+    // drops agents onto the terrain at random spots and gives each a random walking direction
+    void spawn_agents(const CollisionMesh& mesh, unsigned count, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& displacements)
+    {
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 down(0.0f, -(bounds.extent().y + 2.0f), 0.0f);
+
+        positions.clear();
+        displacements.clear();
+
+        while (positions.size() < count) {
+            glm::vec3 start(bounds.min.x + unit(rng) * bounds.extent().x, bounds.max.y + 1.0f, bounds.min.z + unit(rng) * bounds.extent().z);
+            RaycastHit hit;
+
+            if (mesh.segment_cast(start, down, hit)) {
+                float angle = unit(rng) * 6.2831853f;
+                positions.push_back(hit.point + hit.normal * (AGENT_RADIUS + 0.01f));
+                displacements.push_back(glm::vec3(std::cos(angle), -0.5f, std::sin(angle)) * AGENT_STEP);
+            }
+        }
+    }
+}
+
+void run_batch_collision_benchmark()
+{
+    CollisionMesh mesh("res/models/grandure.obj");
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const unsigned agent_counts[] = { 1000, 10000, 100000 };
+
+    // powers of two, then every hardware thread if that is not one of them
+    std::vector<unsigned> thread_counts;
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+
+    if (thread_counts.back() != max_threads) {
+        thread_counts.push_back(max_threads);
+    }
+
+    std::printf("res/models/grandure.obj, %u ticks per run, radius %.2f\n", TICKS, AGENT_RADIUS);
+    std::printf("%8s %8s %14s %14s %9s\n", "agents", "threads", "ms/tick", "agents/s", "speedup");
+
+    for (unsigned count : agent_counts) {
+        std::vector<glm::vec3> initial_positions, displacements, results;
+        spawn_agents(mesh, count, initial_positions, displacements);
+        double single_thread_seconds = 0.0;
+
+        for (unsigned threads : thread_counts) {
+            ThreadPool pool(threads);
+            std::vector<glm::vec3> positions = initial_positions;
+            BenchClock::time_point start = BenchClock::now();
+
+            for (unsigned tick = 0; tick < TICKS; tick++) {
+                mesh.slide_spheres(positions, displacements, AGENT_RADIUS, results, pool);
+                positions.swap(results);
+            }
+
+            double seconds = seconds_since(start);
+
+            if (threads == 1) {
+                single_thread_seconds = seconds;
+            }
+
+            std::printf("%8u %8u %14.3f %14.0f %8.2fx\n", count, threads, seconds * 1.0e3 / TICKS, count * TICKS / seconds, single_thread_seconds / seconds);
+        }
+    }
+}
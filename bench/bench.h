@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <glm/vec3.hpp>
+#include <random>
+#include <vector>
+
+#include "../src/geometry/geometry.h"
+
+using BenchClock = std::chrono::steady_clock;
+
+struct Segment {
+    glm::vec3 origin;
+    glm::vec3 displacement;
+};
+
+double seconds_since(BenchClock::time_point start);
+
+/**
+ * @brief Generates count random segments that start inside bounds and are length long.
+ *
+ * The generator is seeded with a constant so every run tests the same segments.
+ */
+std::vector<Segment> random_segments(const AABB& bounds, float length, unsigned count);
+
+void run_triangle_kernel_benchmark();
+void run_batch_collision_benchmark();
+void run_compressed_collision_benchmark();
+void run_refit_benchmark();
+void run_heightfield_benchmark();
+void run_closest_point_benchmark();
+void run_signed_distance_field_benchmark();
+void run_contact_cache_benchmark();
+void run_trace_replay_benchmark();
+void run_picking_benchmark();
+void run_sweep_and_prune_benchmark();
+void run_convex_collision_benchmark();
+void run_bvh_build_benchmark();
+void run_collision_cache_benchmark();
+void run_instancing_benchmark();
+void run_frustum_culling_benchmark();
+void run_occlusion_culling_benchmark();
+void run_world_streaming_benchmark();
+void run_lod_benchmark();
+void run_vertex_cache_benchmark();
@@ -0,0 +1,134 @@
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <thread>
+
+#include "../src/geometry/bvh.h"
+#include "../src/geometry/collision_mesh.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const unsigned BUILD_GRID_SAMPLES = 1582; // about five million triangles
+    const unsigned QUERY_GRID_SAMPLES = 708; // about a million triangles
+    const unsigned NUM_SEGMENTS = 200000;
+
+    const BVH::Quality QUALITIES[] = { BVH::FAST, BVH::BALANCED, BVH::BEST };
+    const char* QUALITY_NAMES[] = { "fast", "balanced", "best" };
+
+    glm::vec3 terrain_vertex(unsigned column, unsigned row)
+    {
+        float height = 12.0f * std::sin(column * 0.02f) * std::cos(row * 0.017f) + 1.5f * std::sin((column + 2 * row) * 0.15f);
+        return glm::vec3(column * 1.0f, height, row * 1.0f);
+    }
+
+    std::vector<Triangle> terrain_triangles(unsigned n)
+    {
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                triangles.push_back(Triangle(terrain_vertex(column, row), terrain_vertex(column + 1, row + 1), terrain_vertex(column + 1, row)));
+                triangles.push_back(Triangle(terrain_vertex(column, row), terrain_vertex(column, row + 1), terrain_vertex(column + 1, row + 1)));
+            }
+        }
+
+        return triangles;
+    }
+
+    void benchmark_build_scaling()
+    {
+        std::vector<AABB> bounds;
+
+        for (const Triangle& triangle : terrain_triangles(BUILD_GRID_SAMPLES)) {
+            AABB box;
+            box.grow(triangle.points[0]);
+            box.grow(triangle.points[1]);
+            box.grow(triangle.points[2]);
+            bounds.push_back(box);
+        }
+
+        std::vector<unsigned> thread_counts;
+        unsigned hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (unsigned threads = 1; threads < hardware_threads; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+
+        thread_counts.push_back(hardware_threads);
+
+        std::printf("build: %zu primitives, leaves of up to %zu\n", bounds.size(), TriangleSoA::LANE_WIDTH);
+        std::printf("  %-8s  %7s  %10s  %8s  %9s  %9s\n", "quality", "threads", "build", "speedup", "nodes", "SAH cost");
+
+        for (int q = 0; q < 3; q++) {
+            double single_thread_seconds = 0.0;
+
+            for (unsigned threads : thread_counts) {
+                ThreadPool pool(threads);
+                BenchClock::time_point start = BenchClock::now();
+                BVH bvh(bounds, TriangleSoA::LANE_WIDTH, QUALITIES[q], pool);
+                double seconds = seconds_since(start);
+
+                if (threads == 1) {
+                    single_thread_seconds = seconds;
+                }
+
+                std::printf("  %-8s  %7u  %7.1f ms  %7.2fx  %9zu  %9.2f\n", QUALITY_NAMES[q], threads, seconds * 1.0e3, single_thread_seconds / seconds, bvh.nodes().size(), bvh.sah_cost());
+            }
+        }
+    }
+
+    void benchmark_query_quality()
+    {
+        std::vector<Triangle> triangles = terrain_triangles(QUERY_GRID_SAMPLES);
+        ThreadPool pool;
+        std::vector<float> reference_t;
+        std::vector<Segment> segments;
+
+        std::printf("queries: %zu triangles, %u segments\n", triangles.size(), NUM_SEGMENTS);
+        std::printf("  %-8s  %12s  %14s  %12s  %10s\n", "quality", "mesh build", "segment cast", "hits", "mismatches");
+
+        for (int q = 0; q < 3; q++) {
+            BenchClock::time_point start = BenchClock::now();
+            CollisionMesh mesh(triangles, QUALITIES[q], pool);
+            double build_seconds = seconds_since(start);
+
+            if (segments.empty()) {
+                const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+                segments = random_segments(bounds, glm::length(bounds.extent()) * 0.25f, NUM_SEGMENTS);
+            }
+
+            std::vector<float> t(segments.size(), -1.0f);
+            unsigned hits = 0, mismatches = 0;
+            start = BenchClock::now();
+
+            for (std::size_t i = 0; i < segments.size(); i++) {
+                RaycastHit hit;
+
+                if (mesh.segment_cast(segments[i].origin, segments[i].displacement, hit)) {
+                    t[i] = hit.t;
+                    hits++;
+                }
+            }
+
+            double query_seconds = seconds_since(start);
+
+            if (reference_t.empty()) {
+                reference_t = t;
+            }
+
+            for (std::size_t i = 0; i < t.size(); i++) {
+                mismatches += glm::abs(t[i] - reference_t[i]) > 1.0e-5f;
+            }
+
+            std::printf("  %-8s  %9.1f ms  %11.3f us  %12u  %10u\n", QUALITY_NAMES[q], build_seconds * 1.0e3, query_seconds * 1.0e6 / segments.size(), hits, mismatches);
+        }
+    }
+}
+
+void run_bvh_build_benchmark()
+{
+    benchmark_build_scaling();
+    benchmark_query_quality();
+}
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#include "../src/geometry/collision_mesh.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_QUERIES = 20000;
+    const unsigned NUM_VERIFIED = 500;
+
+    // search radii as fractions of the mesh's diagonal
+    const float RADII[] = { 0.001f, 0.005f, 0.01f, 0.025f, 0.05f, 0.1f, 0.25f, 0.5f, 1.0f };
+
+    float brute_force_distance(const CollisionMesh& mesh, const glm::vec3& P)
+    {
+        const TriangleSoA& triangles = mesh.triangles();
+        float closest = std::numeric_limits<float>::max();
+
+        for (std::size_t i = 0; i < triangles.size(); i++) {
+            Triangle triangle = triangles.triangle(i);
+            glm::vec3 Q = closest_point_on_triangle(P, triangle.points[0], triangle.points[1], triangle.points[2]);
+            closest = glm::min(closest, glm::length(Q - P));
+        }
+
+        return closest;
+    }
+}
+
+void run_closest_point_benchmark()
+{
+    const char* path = "res/models/grandure.obj";
+    CollisionMesh mesh(path);
+    const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+    float diagonal = glm::length(bounds.extent());
+    std::vector<Segment> queries = random_segments(bounds, 0.0f, NUM_QUERIES);
+
+    std::vector<float> exact(NUM_VERIFIED);
+    BenchClock::time_point start = BenchClock::now();
+
+    for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+        exact[i] = brute_force_distance(mesh, queries[i].origin);
+    }
+
+    double brute_force_seconds = seconds_since(start);
+
+    std::printf("%s: %zu triangles, diagonal %.1f, brute force %.3f us/query\n", path, mesh.triangles().size(), diagonal, brute_force_seconds * 1.0e6 / NUM_VERIFIED);
+    std::printf("  %8s  %12s  %8s  %15s  %8s  %10s\n", "radius", "closest", "found", "within_distance", "inside", "mismatches");
+
+    for (float fraction : RADII) {
+        float radius = fraction * diagonal;
+        unsigned found = 0, inside = 0, mismatches = 0;
+        start = BenchClock::now();
+
+        for (const Segment& query : queries) {
+            ClosestPoint result;
+            found += mesh.closest_point(query.origin, radius, result);
+        }
+
+        double closest_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (const Segment& query : queries) {
+            inside += mesh.within_distance(query.origin, radius);
+        }
+
+        double within_seconds = seconds_since(start);
+
+        for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+            ClosestPoint result;
+            bool expected = exact[i] <= radius;
+
+            if (mesh.closest_point(queries[i].origin, radius, result) != expected || mesh.within_distance(queries[i].origin, radius) != expected) {
+                mismatches++;
+            } else if (expected && glm::abs(result.distance - exact[i]) > 1.0e-4f * diagonal) {
+                mismatches++;
+            }
+        }
+
+        std::printf("  %8.3f  %9.3f us  %7.1f%%  %12.3f us  %7.1f%%  %10u\n", radius, closest_seconds * 1.0e6 / queries.size(), 100.0 * found / queries.size(), within_seconds * 1.0e6 / queries.size(), 100.0 * inside / queries.size(), mismatches);
+    }
+}
@@ -0,0 +1,111 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/utility/mapped_file.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const unsigned GRID_SAMPLES = 708; // about a million triangles
+    const unsigned NUM_SEGMENTS = 200000;
+
+    const char* SOURCE_PATH = "collision_cache_benchmark.obj";
+    const char* CACHE_PATH = "collision_cache_benchmark.obj.collision";
+
+    void write_terrain(const char* path)
+    {
+        const unsigned n = GRID_SAMPLES;
+        std::ofstream file(path);
+
+        for (unsigned row = 0; row < n; row++) {
+            for (unsigned column = 0; column < n; column++) {
+                float height = 12.0f * std::sin(column * 0.02f) * std::cos(row * 0.017f) + 1.5f * std::sin((column + 2 * row) * 0.15f);
+                file << "v " << column << ' ' << height << ' ' << row << '\n';
+            }
+        }
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                unsigned v = row * n + column + 1;
+                file << "f " << v << ' ' << v + n + 1 << ' ' << v + 1 << '\n';
+                file << "f " << v << ' ' << v + n << ' ' << v + n + 1 << '\n';
+            }
+        }
+    }
+
+    double time_queries(const CollisionMesh& mesh, const std::vector<Segment>& segments, std::vector<RaycastHit>& hits)
+    {
+        hits.assign(segments.size(), RaycastHit());
+        BenchClock::time_point start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            if (!mesh.segment_cast(segments[i].origin, segments[i].displacement, hits[i])) {
+                hits[i].triangle = CollisionMesh::NO_NEIGHBOUR;
+            }
+        }
+
+        return seconds_since(start);
+    }
+
+    // the meshes keep the cache mapped, so they must be gone before it can be deleted
+    void benchmark_cache()
+    {
+        ThreadPool pool;
+        BenchClock::time_point start = BenchClock::now();
+        std::uint64_t hash = MappedFile(SOURCE_PATH).hash();
+        double hash_seconds = seconds_since(start);
+        std::size_t source_size = MappedFile(SOURCE_PATH).size();
+
+        start = BenchClock::now();
+        CollisionMesh built(SOURCE_PATH, CACHE_PATH, BVH::BEST, pool);
+        double build_seconds = seconds_since(start);
+
+        start = BenchClock::now();
+        CollisionMesh mapped(SOURCE_PATH, CACHE_PATH, BVH::BEST, pool);
+        double map_seconds = seconds_since(start);
+        std::size_t cache_size = MappedFile(CACHE_PATH).size();
+
+        std::printf("%s: %zu triangles, %.1f MB of OBJ hashed in %.2f ms (%016llx), %.1f MB cache\n", SOURCE_PATH, built.triangles().size(), source_size / 1048576.0, hash_seconds * 1.0e3, static_cast<unsigned long long>(hash), cache_size / 1048576.0);
+        std::printf("  %-22s  %10s  %6s\n", "load", "time", "cached");
+        std::printf("  %-22s  %7.1f ms  %6s\n", "import, build and save", build_seconds * 1.0e3, built.is_cached() ? "yes" : "no");
+        std::printf("  %-22s  %7.1f ms  %6s\n", "map the cache", map_seconds * 1.0e3, mapped.is_cached() ? "yes" : "no");
+
+        // the first queries on a freshly mapped file also pay for its page faults
+        const AABB& bounds = built.bvh().nodes()[0].bounds;
+        std::vector<Segment> segments = random_segments(bounds, 0.1f * glm::length(bounds.extent()), NUM_SEGMENTS);
+        std::vector<RaycastHit> built_hits, mapped_hits;
+        double built_seconds = time_queries(built, segments, built_hits);
+        double first_mapped_seconds = time_queries(mapped, segments, mapped_hits);
+        double mapped_seconds = time_queries(mapped, segments, mapped_hits);
+        unsigned mismatches = 0;
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            mismatches += built_hits[i].triangle != mapped_hits[i].triangle || (built_hits[i].triangle != CollisionMesh::NO_NEIGHBOUR && built_hits[i].t != mapped_hits[i].t);
+        }
+
+        std::printf("  segment cast: built %.3f us, mapped %.3f us on first touch and %.3f us after, %u mismatches\n", built_seconds * 1.0e6 / segments.size(), first_mapped_seconds * 1.0e6 / segments.size(), mapped_seconds * 1.0e6 / segments.size(), mismatches);
+
+        // editing the source must invalidate the cache
+        {
+            std::ofstream file(SOURCE_PATH, std::ios::app);
+            file << "# edited\n";
+        }
+
+        start = BenchClock::now();
+        CollisionMesh edited(SOURCE_PATH, CACHE_PATH, BVH::BEST, pool);
+        double edited_seconds = seconds_since(start);
+        std::printf("  after editing the source: %.1f ms, cached %s\n", edited_seconds * 1.0e3, edited.is_cached() ? "yes (stale!)" : "no");
+    }
+}
+
+void run_collision_cache_benchmark()
+{
+    write_terrain(SOURCE_PATH);
+    std::remove(CACHE_PATH);
+    benchmark_cache();
+    std::remove(SOURCE_PATH);
+    std::remove(CACHE_PATH);
+}
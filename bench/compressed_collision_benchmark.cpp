@@ -0,0 +1,65 @@
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/compressed_collision_mesh.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_SEGMENTS = 200000;
+
+    void benchmark_model(const char* path)
+    {
+        CollisionMesh mesh(path);
+        BenchClock::time_point start = BenchClock::now();
+        CompressedCollisionMesh compressed(mesh);
+        double build_seconds = seconds_since(start);
+
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::vector<Segment> segments = random_segments(bounds, glm::length(bounds.extent()) * 0.25f, NUM_SEGMENTS);
+        std::vector<float> full_t(segments.size(), -1.0f);
+        unsigned full_hits = 0, compressed_hits = 0, mismatches = 0;
+
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit hit;
+
+            if (mesh.segment_cast(segments[i].origin, segments[i].displacement, hit)) {
+                full_t[i] = hit.t;
+                full_hits++;
+            }
+        }
+
+        double full_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit hit;
+
+            if (compressed.segment_cast(segments[i].origin, segments[i].displacement, hit)) {
+                compressed_hits++;
+                mismatches += full_t[i] < 0.0f || glm::abs(hit.t - full_t[i]) > 1.0e-3f;
+            } else {
+                mismatches += full_t[i] >= 0.0f;
+            }
+        }
+
+        double compressed_seconds = seconds_since(start);
+        std::size_t full_bytes = mesh.memory_usage();
+        std::size_t compressed_bytes = compressed.memory_usage();
+
+        std::printf("%s: %zu triangles, %zu welded vertices (%.2f per triangle), compressed in %.1f ms\n", path, compressed.num_triangles(), compressed.num_welded_vertices(), static_cast<double>(compressed.num_welded_vertices()) / compressed.num_triangles(), build_seconds * 1.0e3);
+        std::printf("  welded per leaf: %zu vertices stored (%.2f per triangle, %.2f copies per welded vertex)\n", compressed.num_stored_vertices(), static_cast<double>(compressed.num_stored_vertices()) / compressed.num_triangles(), static_cast<double>(compressed.num_stored_vertices()) / compressed.num_welded_vertices());
+        std::printf("  full        %10zu bytes  %6.1f B/triangle  %8.3f us/segment  (%u hits)\n", full_bytes, static_cast<double>(full_bytes) / compressed.num_triangles(), full_seconds * 1.0e6 / segments.size(), full_hits);
+        std::printf("  compressed  %10zu bytes  %6.1f B/triangle  %8.3f us/segment  (%u hits, %u mismatches)\n", compressed_bytes, static_cast<double>(compressed_bytes) / compressed.num_triangles(), compressed_seconds * 1.0e6 / segments.size(), compressed_hits, mismatches);
+        std::printf("  memory saved %.1f%%, query slowdown %.2fx\n", 100.0 * (1.0 - static_cast<double>(compressed_bytes) / full_bytes), compressed_seconds / full_seconds);
+    }
+}
+
+void run_compressed_collision_benchmark()
+{
+    benchmark_model("res/models/grandure.obj");
+    benchmark_model("res/models/terrain.obj");
+    benchmark_model("res/models/suzanne.obj");
+}
@@ -0,0 +1,80 @@
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_AGENTS = 2000;
+    const unsigned TICKS = 120;
+    const float AGENT_STEP = 0.05f;
+    const float RADII[] = { 0.25f, 0.5f, 1.0f };
+
+    // drops agents onto the terrain at random spots and gives each a steady walking direction
+    void spawn_agents(const CollisionMesh& mesh, float radius, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& displacements)
+    {
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 down(0.0f, -(bounds.extent().y + 2.0f), 0.0f);
+
+        while (positions.size() < NUM_AGENTS) {
+            glm::vec3 start(bounds.min.x + unit(rng) * bounds.extent().x, bounds.max.y + 1.0f, bounds.min.z + unit(rng) * bounds.extent().z);
+            RaycastHit hit;
+
+            if (mesh.segment_cast(start, down, hit)) {
+                float angle = unit(rng) * 6.2831853f;
+                positions.push_back(hit.point + hit.normal * (radius + 0.01f));
+                displacements.push_back(glm::vec3(std::cos(angle), -0.5f, std::sin(angle)) * AGENT_STEP);
+            }
+        }
+    }
+}
+
+void run_contact_cache_benchmark()
+{
+    const char* path = "res/models/grandure.obj";
+    CollisionMesh mesh(path);
+
+    std::printf("%s, %u agents, %u ticks, step %.2f, margin %.1f steps\n", path, NUM_AGENTS, TICKS, AGENT_STEP, CollisionMesh::CONTACT_CACHE_MARGIN);
+    std::printf("  %6s  %14s  %14s  %8s  %9s  %15s  %10s\n", "radius", "uncached", "cached", "speedup", "hit rate", "triangles/tick", "mismatches");
+
+    for (float radius : RADII) {
+        std::vector<glm::vec3> initial_positions, displacements;
+        spawn_agents(mesh, radius, initial_positions, displacements);
+
+        std::vector<glm::vec3> uncached = initial_positions;
+        BenchClock::time_point start = BenchClock::now();
+
+        for (unsigned tick = 0; tick < TICKS; tick++) {
+            for (unsigned i = 0; i < NUM_AGENTS; i++) {
+                uncached[i] = mesh.slide_sphere(uncached[i], radius, displacements[i]);
+            }
+        }
+
+        double uncached_seconds = seconds_since(start);
+        std::vector<glm::vec3> cached = initial_positions;
+        std::vector<ContactCache> caches(NUM_AGENTS);
+        start = BenchClock::now();
+
+        for (unsigned tick = 0; tick < TICKS; tick++) {
+            for (unsigned i = 0; i < NUM_AGENTS; i++) {
+                cached[i] = mesh.slide_sphere(cached[i], radius, displacements[i], caches[i]);
+            }
+        }
+
+        double cached_seconds = seconds_since(start);
+        std::uint64_t queries = 0, hits = 0, tested = 0;
+        unsigned mismatches = 0;
+
+        for (unsigned i = 0; i < NUM_AGENTS; i++) {
+            queries += caches[i].queries;
+            hits += caches[i].hits;
+            tested += caches[i].triangles_tested;
+            mismatches += glm::length(cached[i] - uncached[i]) > 1.0e-4f;
+        }
+
+        std::printf("  %6.2f  %8.3f ms/tick  %8.3f ms/tick  %7.2fx  %8.1f%%  %15.1f  %10u\n", radius, uncached_seconds * 1.0e3 / TICKS, cached_seconds * 1.0e3 / TICKS, uncached_seconds / cached_seconds, 100.0 * hits / queries, static_cast<double>(tested) / queries, mismatches);
+    }
+}
@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/convex_hull.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_BODIES = 500;
+    const unsigned TICKS = 60;
+    const float BODY_STEP = 0.02f; // per tick, as a fraction of the hull's radius
+    const float BODY_TURN = 0.01f; // radians per tick
+
+    struct Body {
+        glm::vec3 position;
+        glm::quat orientation;
+        glm::vec3 velocity;
+        glm::quat spin;
+    };
+
+    // drops bodies onto the terrain at random spots, some hovering and some sunk into the ground
+    std::vector<Body> spawn_bodies(const CollisionMesh& mesh, float radius)
+    {
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 down(0.0f, -(bounds.extent().y + 2.0f), 0.0f);
+        std::vector<Body> bodies;
+
+        while (bodies.size() < NUM_BODIES) {
+            glm::vec3 start(bounds.min.x + unit(rng) * bounds.extent().x, bounds.max.y + 1.0f, bounds.min.z + unit(rng) * bounds.extent().z);
+            RaycastHit hit;
+
+            if (mesh.segment_cast(start, down, hit)) {
+                float angle = unit(rng) * 6.2831853f;
+                glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f);
+                Body body;
+                body.position = hit.point + hit.normal * (radius * (unit(rng) * 1.5f - 0.5f));
+                body.orientation = glm::angleAxis(angle, axis);
+                body.velocity = glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * (BODY_STEP * radius);
+                body.spin = glm::angleAxis(BODY_TURN, axis);
+                bodies.push_back(body);
+            }
+        }
+
+        return bodies;
+    }
+
+    struct Run {
+        double seconds;
+        std::uint64_t contacts;
+        std::uint64_t triangles_tested;
+        std::uint64_t iterations;
+        std::vector<unsigned> overlaps; // contacts per body and tick, to compare runs
+    };
+
+    Run run_bodies(const CollisionMesh& mesh, const ConvexHull& hull, std::vector<Body> bodies, bool warm)
+    {
+        std::vector<ConvexCache> caches(bodies.size());
+        std::vector<ConvexContact> contacts;
+        Run run = {};
+        run.overlaps.reserve(bodies.size() * TICKS);
+        BenchClock::time_point start = BenchClock::now();
+
+        for (unsigned tick = 0; tick < TICKS; tick++) {
+            for (std::size_t i = 0; i < bodies.size(); i++) {
+                Body& body = bodies[i];
+
+                if (!warm) {
+                    caches[i].simplices.clear();
+                }
+
+                mesh.convex_contacts(hull, body.orientation, body.position, caches[i], contacts);
+                run.contacts += contacts.size();
+                run.overlaps.push_back(static_cast<unsigned>(contacts.size()));
+                body.position += body.velocity;
+                body.orientation = glm::normalize(body.spin * body.orientation);
+            }
+        }
+
+        run.seconds = seconds_since(start);
+
+        for (const ConvexCache& cache : caches) {
+            run.triangles_tested += cache.triangles_tested;
+            run.iterations += cache.iterations;
+        }
+
+        return run;
+    }
+
+    void benchmark_terrain(const char* path, const ConvexHull& hull)
+    {
+        CollisionMesh mesh(path);
+        std::vector<Body> bodies = spawn_bodies(mesh, hull.radius());
+        unsigned queries = NUM_BODIES * TICKS;
+
+        Run cold = run_bodies(mesh, hull, bodies, false);
+        Run warm = run_bodies(mesh, hull, bodies, true);
+        unsigned mismatches = 0;
+
+        for (std::size_t k = 0; k < cold.overlaps.size(); k++) {
+            mismatches += cold.overlaps[k] != warm.overlaps[k];
+        }
+
+        // the cheapest query that still looks at the hull's surroundings, for scale
+        unsigned near = 0;
+        BenchClock::time_point start = BenchClock::now();
+
+        for (unsigned tick = 0; tick < TICKS; tick++) {
+            for (const Body& body : bodies) {
+                near += mesh.within_distance(body.orientation * hull.center() + body.position + body.velocity * static_cast<float>(tick), hull.radius());
+            }
+        }
+
+        double sphere_seconds = seconds_since(start);
+
+        std::printf("%s: %zu triangles, %u bodies, %u ticks\n", path, mesh.triangles().size(), NUM_BODIES, TICKS);
+        std::printf("  %-22s  %12s  %10s  %17s  %18s  %16s\n", "query", "queries/s", "us/query", "triangles/query", "iterations/test", "contacts/query");
+        std::printf("  %-22s  %12.0f  %10.3f  %17.1f  %18.2f  %16.2f\n", "hull, cold simplex", queries / cold.seconds, cold.seconds * 1.0e6 / queries, static_cast<double>(cold.triangles_tested) / queries, static_cast<double>(cold.iterations) / cold.triangles_tested, static_cast<double>(cold.contacts) / queries);
+        std::printf("  %-22s  %12.0f  %10.3f  %17.1f  %18.2f  %16.2f\n", "hull, warm simplex", queries / warm.seconds, warm.seconds * 1.0e6 / queries, static_cast<double>(warm.triangles_tested) / queries, static_cast<double>(warm.iterations) / warm.triangles_tested, static_cast<double>(warm.contacts) / queries);
+        std::printf("  %-22s  %12.0f  %10.3f  %17s  %18s  %15.1f%%\n", "bounding sphere", queries / sphere_seconds, sphere_seconds * 1.0e6 / queries, "-", "-", 100.0 * near / queries);
+        std::printf("  warm speedup %.2fx, %u of %u queries disagree between cold and warm\n", cold.seconds / warm.seconds, mismatches, queries);
+    }
+}
+
+void run_convex_collision_benchmark()
+{
+    const char* hull_path = "res/models/suzanne.obj";
+    CollisionMesh model(hull_path);
+    BenchClock::time_point start = BenchClock::now();
+    ConvexHull hull(model.vertices());
+    double build_seconds = seconds_since(start);
+
+    std::printf("%s: %zu vertices -> hull with %zu vertices, %zu faces, radius %.2f, built in %.2f ms\n", hull_path, model.vertices().size(), hull.vertices().size(), hull.faces().size(), hull.radius(), build_seconds * 1.0e3);
+
+    benchmark_terrain("res/models/terrain.obj", hull);
+    benchmark_terrain("res/models/grandure.obj", hull);
+}
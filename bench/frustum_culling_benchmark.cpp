@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/frustum.h"
+#include "../src/graphics/camera.h"
+#include "bench.h"
+
+namespace {
+    const unsigned BOX_COUNTS[] = { 1000, 10000, 100000 };
+    const unsigned NUM_REPEATS = 200; // culls per box count, like consecutive frames
+    const float WORLD_SIZE = 2000.0f;
+
+    const unsigned GRID_SAMPLES = 708; // about a million triangles
+    const unsigned CHUNK_TRIANGLES[] = { 4096, 16384, 65536 };
+
+    struct Pose {
+        const char* name;
+        glm::vec3 position;
+        float yaw;   // degrees about +y, from looking down -z
+        float pitch; // degrees, negative looks down
+    };
+
+    const Pose POSES[] = {
+        { "overview", glm::vec3(354.0f, 600.0f, 354.0f), 0.0f, -89.0f },
+        { "ground", glm::vec3(20.0f, 15.0f, 690.0f), -30.0f, -5.0f },
+        { "center", glm::vec3(354.0f, 20.0f, 354.0f), 60.0f, -10.0f },
+        { "edge, facing out", glm::vec3(354.0f, 20.0f, -5.0f), 0.0f, -5.0f },
+    };
+
+    glm::vec3 terrain_vertex(unsigned column, unsigned row)
+    {
+        float height = 12.0f * std::sin(column * 0.02f) * std::cos(row * 0.017f) + 1.5f * std::sin((column + 2 * row) * 0.15f);
+        return glm::vec3(column * 1.0f, height, row * 1.0f);
+    }
+
+    std::vector<Triangle> terrain_triangles(unsigned n)
+    {
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                triangles.push_back(Triangle(terrain_vertex(column, row), terrain_vertex(column + 1, row + 1), terrain_vertex(column + 1, row)));
+                triangles.push_back(Triangle(terrain_vertex(column, row), terrain_vertex(column, row + 1), terrain_vertex(column + 1, row + 1)));
+            }
+        }
+
+        return triangles;
+    }
+
+    void place(Camera& camera, const Pose& pose)
+    {
+        Transform& transform = camera.get_transform();
+        transform.reset();
+        transform.set_position(pose.position);
+        transform.rotate(pose.yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+        transform.rotate(pose.pitch, transform.right());
+    }
+
+    // props of assorted sizes scattered through a large world, seen from its middle
+    void benchmark_random_boxes()
+    {
+        Camera camera;
+        camera.set_aspect_ratio(16.0f / 9.0f);
+        place(camera, { "", glm::vec3(0.5f * WORLD_SIZE, 10.0f, 0.5f * WORLD_SIZE), 30.0f, -5.0f });
+        const Frustum& frustum = camera.get_frustum();
+
+        std::printf("random boxes, %s kernel\n", cull_kernel_name());
+        std::printf("  %8s  %10s  %12s  %12s  %8s  %10s\n", "boxes", "visible", "scalar", "cull_boxes", "speedup", "mismatches");
+
+        for (unsigned count : BOX_COUNTS) {
+            std::mt19937 generator(1234);
+            std::uniform_real_distribution<float> position(0.0f, WORLD_SIZE), size(0.5f, 20.0f);
+            std::vector<AABB> boxes(count);
+            BoxSoA soa;
+
+            for (AABB& box : boxes) {
+                glm::vec3 center(position(generator), 0.05f * position(generator), position(generator));
+                glm::vec3 half_extent(size(generator), size(generator), size(generator));
+                box = AABB(center - half_extent, center + half_extent);
+                soa.push_back(box);
+            }
+
+            std::vector<unsigned> scalar_visible, visible;
+            BenchClock::time_point start = BenchClock::now();
+
+            for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+                scalar_visible.clear();
+
+                for (unsigned i = 0; i < count; i++) {
+                    if (frustum.intersects(boxes[i])) {
+                        scalar_visible.push_back(i);
+                    }
+                }
+            }
+
+            double scalar_seconds = seconds_since(start);
+            start = BenchClock::now();
+
+            for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+                cull_boxes(frustum, soa, visible);
+            }
+
+            double simd_seconds = seconds_since(start);
+            unsigned mismatches = 0;
+
+            for (std::size_t i = 0; i < std::max(visible.size(), scalar_visible.size()); i++) {
+                mismatches += i >= visible.size() || i >= scalar_visible.size() || visible[i] != scalar_visible[i];
+            }
+
+            std::printf("  %8u  %10zu  %9.3f us  %9.3f us  %7.2fx  %10u\n", count, visible.size(), scalar_seconds * 1.0e6 / NUM_REPEATS, simd_seconds * 1.0e6 / NUM_REPEATS, scalar_seconds / simd_seconds, mismatches);
+        }
+    }
+
+    // a large terrain split into chunks along its hierarchy, as the game draws it
+    void benchmark_terrain_chunks()
+    {
+        CollisionMesh terrain(terrain_triangles(GRID_SAMPLES));
+        const BVH& bvh = terrain.bvh();
+        Camera camera;
+        camera.set_aspect_ratio(16.0f / 9.0f);
+
+        std::printf("terrain: %zu triangles\n", terrain.triangles().size());
+        std::printf("  %16s  %10s  %8s  %16s  %16s  %10s\n", "pose", "max chunk", "chunks", "visible chunks", "drawn triangles", "cull");
+
+        for (unsigned max_triangles : CHUNK_TRIANGLES) {
+            std::vector<unsigned> roots = bvh.subtrees(max_triangles);
+            std::vector<unsigned> chunk_triangles;
+            BoxSoA chunks;
+
+            for (unsigned node : roots) {
+                unsigned first, count;
+                bvh.primitive_range(node, first, count);
+                chunk_triangles.push_back(count);
+                chunks.push_back(bvh.nodes()[node].bounds);
+            }
+
+            for (const Pose& pose : POSES) {
+                place(camera, pose);
+                std::vector<unsigned> visible;
+                BenchClock::time_point start = BenchClock::now();
+
+                for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+                    cull_boxes(camera.get_frustum(), chunks, visible);
+                }
+
+                double seconds = seconds_since(start);
+                std::size_t drawn = 0;
+
+                for (unsigned chunk : visible) {
+                    drawn += chunk_triangles[chunk];
+                }
+
+                std::printf("  %16s  %10u  %8zu  %16zu  %15.1f%%  %7.3f us\n", pose.name, max_triangles, roots.size(), visible.size(), 100.0 * drawn / terrain.triangles().size(), seconds * 1.0e6 / NUM_REPEATS);
+            }
+        }
+    }
+}
+
+void run_frustum_culling_benchmark()
+{
+    benchmark_random_boxes();
+    benchmark_terrain_chunks();
+}
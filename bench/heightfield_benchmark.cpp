@@ -0,0 +1,131 @@
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/heightfield_collider.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_QUERIES = 200000;
+    const unsigned SYNTHETIC_SAMPLES = 513;
+
+    void benchmark_heightfield(const char* name, const CollisionMesh& mesh, const HeightfieldCollider& heightfield)
+    {
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::vector<Segment> segments = random_segments(bounds, glm::length(bounds.extent()) * 0.25f, NUM_QUERIES);
+        std::vector<float> mesh_t(segments.size(), -1.0f);
+        std::vector<float> mesh_heights(segments.size(), std::numeric_limits<float>::quiet_NaN());
+        unsigned mesh_hits = 0, heightfield_hits = 0, mismatches = 0;
+        float max_height_error = 0.0f;
+
+        // ground queries on a triangle soup are vertical segment casts through the whole mesh
+        glm::vec3 down(0.0f, -(bounds.extent().y + 2.0f), 0.0f);
+        BenchClock::time_point start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit hit;
+            glm::vec3 top(segments[i].origin.x, bounds.max.y + 1.0f, segments[i].origin.z);
+
+            if (mesh.segment_cast(top, down, hit)) {
+                mesh_heights[i] = hit.point.y;
+            }
+        }
+
+        double mesh_height_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            float height;
+
+            if (heightfield.height_at(segments[i].origin.x, segments[i].origin.z, height) && !std::isnan(mesh_heights[i])) {
+                max_height_error = std::max(max_height_error, std::abs(height - mesh_heights[i]));
+            }
+        }
+
+        double heightfield_height_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit hit;
+
+            if (mesh.segment_cast(segments[i].origin, segments[i].displacement, hit)) {
+                mesh_t[i] = hit.t;
+                mesh_hits++;
+            }
+        }
+
+        double mesh_segment_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit hit;
+
+            if (heightfield.segment_cast(segments[i].origin, segments[i].displacement, hit)) {
+                heightfield_hits++;
+                mismatches += mesh_t[i] < 0.0f || glm::abs(hit.t - mesh_t[i]) > 1.0e-3f;
+            } else {
+                mismatches += mesh_t[i] >= 0.0f;
+            }
+        }
+
+        double heightfield_segment_seconds = seconds_since(start);
+
+        std::printf("%s: %ux%u samples\n", name, heightfield.columns(), heightfield.rows());
+        std::printf("  mesh         %10zu bytes  %8.3f us/height  %8.3f us/segment  (%u hits)\n", mesh.memory_usage(), mesh_height_seconds * 1.0e6 / segments.size(), mesh_segment_seconds * 1.0e6 / segments.size(), mesh_hits);
+        std::printf("  heightfield  %10zu bytes  %8.3f us/height  %8.3f us/segment  (%u hits, %u mismatches)\n", heightfield.memory_usage(), heightfield_height_seconds * 1.0e6 / segments.size(), heightfield_segment_seconds * 1.0e6 / segments.size(), heightfield_hits, mismatches);
+        std::printf("  max height error %g, height speedup %.1fx, segment speedup %.1fx\n", max_height_error, mesh_height_seconds / heightfield_height_seconds, mesh_segment_seconds / heightfield_segment_seconds);
+    }
+
+    void benchmark_model(const char* path)
+    {
+        CollisionMesh mesh(path);
+        HeightfieldCollider heightfield;
+
+        if (!HeightfieldCollider::from_mesh(mesh, heightfield)) {
+            std::printf("%s: not a regular grid\n", path);
+            return;
+        }
+
+        benchmark_heightfield(path, mesh, heightfield);
+    }
+
+    void benchmark_synthetic()
+    {
+        const unsigned n = SYNTHETIC_SAMPLES;
+        const float spacing = 1.0f;
+        std::vector<float> heights(n * n);
+
+        for (unsigned row = 0; row < n; row++) {
+            for (unsigned column = 0; column < n; column++) {
+                heights[row * n + column] = 8.0f * std::sin(column * 0.05f) * std::cos(row * 0.03f) + 2.0f * std::sin((column + row) * 0.21f);
+            }
+        }
+
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                glm::vec3 v00(column * spacing, heights[row * n + column], row * spacing);
+                glm::vec3 v10((column + 1) * spacing, heights[row * n + column + 1], row * spacing);
+                glm::vec3 v01(column * spacing, heights[(row + 1) * n + column], (row + 1) * spacing);
+                glm::vec3 v11((column + 1) * spacing, heights[(row + 1) * n + column + 1], (row + 1) * spacing);
+                triangles.push_back(Triangle(v00, v11, v10));
+                triangles.push_back(Triangle(v00, v01, v11));
+            }
+        }
+
+        CollisionMesh mesh(triangles);
+        HeightfieldCollider heightfield(glm::vec3(0.0f), spacing, spacing, n, n, heights);
+        benchmark_heightfield("synthetic", mesh, heightfield);
+    }
+}
+
+void run_heightfield_benchmark()
+{
+    benchmark_model("res/models/terrain.obj");
+    benchmark_model("res/models/grandure.obj");
+    benchmark_synthetic();
+}
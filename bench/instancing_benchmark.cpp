@@ -0,0 +1,118 @@
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <random>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/collision_scene.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_RAYS = 100000;
+    const unsigned NUM_FLATTENED = 64; // instances also copied into one flat mesh to check the results against
+    const unsigned INSTANCE_COUNTS[] = { NUM_FLATTENED, 1000, 10000, 100000 };
+    const float SPACING = 6.0f; // between neighbouring props
+
+    // props scattered over a square grid with random rotations and sizes, like rocks on a field
+    std::vector<Transform> scatter(unsigned count)
+    {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> jitter(-0.3f, 0.3f), angle(0.0f, 360.0f), size(0.5f, 2.0f);
+        unsigned columns = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<float>(count))));
+        std::vector<Transform> transforms(count);
+
+        for (unsigned i = 0; i < count; i++) {
+            glm::vec3 position((i % columns + jitter(generator)) * SPACING, jitter(generator), (i / columns + jitter(generator)) * SPACING);
+            transforms[i].set_position(position);
+            transforms[i].set_orientation(angle(generator), glm::normalize(glm::vec3(jitter(generator), 1.0f, jitter(generator))));
+            transforms[i].set_scale(glm::vec3(size(generator)));
+        }
+
+        return transforms;
+    }
+
+    // rays from above the props, slanting down across them
+    std::vector<Segment> rays(const AABB& bounds)
+    {
+        std::vector<Segment> rays = random_segments(bounds, 0.0f, NUM_RAYS);
+        std::mt19937 generator(99);
+        std::uniform_real_distribution<float> slant(-1.0f, 1.0f);
+
+        for (Segment& ray : rays) {
+            ray.origin.y = bounds.max.y + 1.0f;
+            ray.displacement = glm::vec3(slant(generator), -1.0f, slant(generator)) * (bounds.extent().y + 2.0f);
+        }
+
+        return rays;
+    }
+}
+
+void run_instancing_benchmark()
+{
+    const char* path = "res/models/suzanne.obj";
+    CollisionMesh prop(path);
+
+    std::printf("%s: %zu triangles, %.2f MB, rays from above\n", path, prop.triangles().size(), prop.memory_usage() / 1048576.0);
+    std::printf("  %9s  %14s  %10s  %10s  %12s  %10s  %8s\n", "instances", "placed tris", "build", "memory", "B/instance", "raycast", "hit");
+
+    for (unsigned count : INSTANCE_COUNTS) {
+        std::vector<Transform> transforms = scatter(count);
+        CollisionScene scene;
+        BenchClock::time_point start = BenchClock::now();
+
+        for (const Transform& transform : transforms) {
+            scene.add_instance(prop, transform);
+        }
+
+        scene.build();
+        double build_seconds = seconds_since(start);
+        std::vector<Segment> segments = rays(scene.bvh().nodes()[0].bounds);
+        std::vector<SceneHit> hits(segments.size());
+        std::vector<bool> hit(segments.size());
+        unsigned num_hits = 0;
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            hit[i] = scene.segment_cast(segments[i].origin, segments[i].displacement, hits[i]);
+            num_hits += hit[i];
+        }
+
+        double raycast_seconds = seconds_since(start);
+        std::size_t memory = scene.memory_usage();
+        std::printf("  %9u  %14zu  %7.1f ms  %7.2f MB  %12.1f  %7.3f us  %7.1f%%\n", count, count * prop.triangles().size(), build_seconds * 1.0e3, memory / 1048576.0, static_cast<double>(memory - prop.memory_usage()) / count, raycast_seconds * 1.0e6 / segments.size(), 100.0 * num_hits / segments.size());
+
+        if (count != NUM_FLATTENED) {
+            continue;
+        }
+
+        // the same props with their triangles copied into world space
+        std::vector<Triangle> triangles;
+
+        for (const Transform& transform : transforms) {
+            for (std::size_t i = 0; i < prop.triangles().size(); i++) {
+                Triangle triangle = prop.triangles().triangle(i);
+
+                for (glm::vec3& point : triangle.points) {
+                    point = glm::vec3(transform.get_matrix() * glm::vec4(point, 1.0f));
+                }
+
+                triangles.push_back(triangle);
+            }
+        }
+
+        start = BenchClock::now();
+        CollisionMesh flattened(triangles);
+        double flat_build_seconds = seconds_since(start);
+        unsigned mismatches = 0;
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            RaycastHit flat_hit;
+            bool flat = flattened.segment_cast(segments[i].origin, segments[i].displacement, flat_hit);
+            mismatches += flat != hit[i] || (flat && std::abs(flat_hit.t - hits[i].hit.t) > 1.0e-4f);
+        }
+
+        double flat_seconds = seconds_since(start);
+        std::printf("  %9s  %14zu  %7.1f ms  %7.2f MB  %12.1f  %7.3f us  %8s  (flattened, %u mismatches)\n", "", flattened.triangles().size(), flat_build_seconds * 1.0e3, flattened.memory_usage() / 1048576.0, static_cast<double>(flattened.memory_usage()) / count, flat_seconds * 1.0e6 / segments.size(), "", mismatches);
+    }
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/frustum.h"
+#include "../src/geometry/simplify.h"
+#include "../src/graphics/camera.h"
+#include "bench.h"
+
+namespace {
+    const char* MODEL_PATH = "res/models/suzanne.obj";
+    const unsigned GRID_SIDE = 100; // instances per side of the field
+    const float SPACING = 6.0f;
+    const float VIEWPORT_WIDTH = 1280.0f;
+    const float VIEWPORT_HEIGHT = 720.0f;
+    const float MAX_ERROR_PIXELS[] = { 0.5f, 1.0f, 4.0f };
+    const unsigned NUM_REPEATS = 20;
+
+    std::vector<Triangle> level_triangles(ArrayView<glm::vec3> positions, const std::vector<unsigned>& elements, const LodLevel& level)
+    {
+        std::vector<Triangle> triangles;
+
+        for (std::size_t i = level.first; i < level.first + level.count; i += 3) {
+            triangles.push_back(Triangle(positions[elements[i]], positions[elements[i + 1]], positions[elements[i + 2]]));
+        }
+
+        return triangles;
+    }
+
+    // the farthest any point sampled on one mesh lies from the other, both ways round
+    float measured_error(const CollisionMesh& full, const CollisionMesh& coarse)
+    {
+        float worst = 0.0f;
+
+        auto sample = [&](const CollisionMesh& from, const CollisionMesh& to) {
+            const TriangleSoA& triangles = from.triangles();
+
+            for (std::size_t i = 0; i < triangles.size(); i++) {
+                Triangle triangle = triangles.triangle(i);
+                const glm::vec3 points[] = {
+                    triangle.points[0],
+                    (triangle.points[0] + triangle.points[1]) * 0.5f,
+                    (triangle.points[0] + triangle.points[1] + triangle.points[2]) / 3.0f,
+                };
+
+                for (const glm::vec3& point : points) {
+                    ClosestPoint closest;
+
+                    if (to.closest_point(point, 1.0e3f, closest)) {
+                        worst = std::max(worst, closest.distance);
+                    }
+                }
+            }
+        };
+
+        sample(coarse, full);
+        sample(full, coarse);
+        return worst;
+    }
+}
+
+void run_lod_benchmark()
+{
+    CollisionMesh model(MODEL_PATH);
+    ArrayView<glm::vec3> positions = model.vertices();
+    std::vector<unsigned> elements(model.indices().begin(), model.indices().end());
+
+    BenchClock::time_point start = BenchClock::now();
+    std::vector<LodLevel> levels = build_lods(positions, elements);
+    double build_seconds = seconds_since(start);
+
+    std::printf("%s: %zu vertices, %zu triangles, %zu levels built in %.1f ms\n", MODEL_PATH, positions.size(), levels[0].count / 3, levels.size(), build_seconds * 1.0e3);
+    std::printf("  %5s  %9s  %9s  %9s\n", "level", "triangles", "error", "measured");
+
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        float measured = i == 0 ? 0.0f : measured_error(model, CollisionMesh(level_triangles(positions, elements, levels[i])));
+        std::printf("  %5zu  %9zu  %9.4f  %9.4f\n", i, levels[i].count / 3, levels[i].error, measured);
+    }
+
+    // a field of models seen from one corner, near ones filling the screen and far ones a few pixels
+    AABB model_bounds;
+
+    for (const glm::vec3& position : positions) {
+        model_bounds.grow(position);
+    }
+
+    BoxSoA boxes;
+
+    for (unsigned row = 0; row < GRID_SIDE; row++) {
+        for (unsigned column = 0; column < GRID_SIDE; column++) {
+            glm::vec3 offset(column * SPACING, 0.0f, -(row * SPACING));
+            boxes.push_back(AABB(model_bounds.min + offset, model_bounds.max + offset));
+        }
+    }
+
+    Camera camera;
+    camera.set_aspect_ratio(VIEWPORT_WIDTH / VIEWPORT_HEIGHT);
+    Transform& transform = camera.get_transform();
+    transform.set_position(glm::vec3(-SPACING, 3.0f, SPACING));
+    transform.rotate(-45.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    transform.rotate(-5.0f, transform.right());
+    glm::vec3 eye(camera.get_transform().get_matrix()[3]);
+
+    std::vector<unsigned> visible;
+    cull_boxes(camera.get_frustum(), boxes, visible);
+    std::size_t full_triangles = visible.size() * (levels[0].count / 3);
+
+    std::printf("field: %u models, %zu in view at %.0fx%.0f, %zu triangles at full detail\n", GRID_SIDE * GRID_SIDE, visible.size(), VIEWPORT_WIDTH, VIEWPORT_HEIGHT, full_triangles);
+    std::printf("  %10s  %10s  %9s  %28s  %10s\n", "max error", "triangles", "reduction", "models per level", "select");
+
+    for (float max_error_pixels : MAX_ERROR_PIXELS) {
+        std::vector<unsigned> per_level(levels.size(), 0);
+        std::size_t triangles = 0;
+        start = BenchClock::now();
+
+        for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+            std::fill(per_level.begin(), per_level.end(), 0);
+            triangles = 0;
+
+            for (unsigned i : visible) {
+                glm::vec3 center(boxes.stream(BoxSoA::CENTER_X)[i], boxes.stream(BoxSoA::CENTER_Y)[i], boxes.stream(BoxSoA::CENTER_Z)[i]);
+                glm::vec3 half_extent(boxes.stream(BoxSoA::HALF_EXTENT_X)[i], boxes.stream(BoxSoA::HALF_EXTENT_Y)[i], boxes.stream(BoxSoA::HALF_EXTENT_Z)[i]);
+                float distance = AABB(center - half_extent, center + half_extent).distance(eye);
+                unsigned lod = select_lod(levels, camera.get_pixels_per_unit(distance, VIEWPORT_HEIGHT), max_error_pixels);
+                per_level[lod]++;
+                triangles += levels[lod].count / 3;
+            }
+        }
+
+        double select_seconds = seconds_since(start);
+        char histogram[64] = "";
+        int length = 0;
+
+        for (std::size_t i = 0; i < per_level.size() && length < static_cast<int>(sizeof(histogram)); i++) {
+            length += std::snprintf(histogram + length, sizeof(histogram) - length, i == 0 ? "%u" : "/%u", per_level[i]);
+        }
+
+        std::printf("  %8.1f px  %10zu  %8.1fx  %28s  %7.1f ns\n", max_error_pixels, triangles, static_cast<double>(full_triangles) / std::max<std::size_t>(triangles, 1), histogram, select_seconds * 1.0e9 / NUM_REPEATS / std::max<std::size_t>(visible.size(), 1));
+    }
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <cstring>
+#include <glm/geometric.hpp>
+#include <iostream>
+
+#include "bench.h"
+
+namespace {
+    struct Benchmark {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark benchmarks[] = {
+        { "triangle_kernel", run_triangle_kernel_benchmark },
+        { "batch_collision", run_batch_collision_benchmark },
+        { "compressed_collision", run_compressed_collision_benchmark },
+        { "refit", run_refit_benchmark },
+        { "heightfield", run_heightfield_benchmark },
+        { "closest_point", run_closest_point_benchmark },
+        { "signed_distance_field", run_signed_distance_field_benchmark },
+        { "contact_cache", run_contact_cache_benchmark },
+        { "trace_replay", run_trace_replay_benchmark },
+        { "picking", run_picking_benchmark },
+        { "sweep_and_prune", run_sweep_and_prune_benchmark },
+        { "convex_collision", run_convex_collision_benchmark },
+        { "bvh_build", run_bvh_build_benchmark },
+        { "collision_cache", run_collision_cache_benchmark },
+        { "instancing", run_instancing_benchmark },
+        { "frustum_culling", run_frustum_culling_benchmark },
+        { "occlusion_culling", run_occlusion_culling_benchmark },
+        { "world_streaming", run_world_streaming_benchmark },
+        { "lod", run_lod_benchmark },
+        { "vertex_cache", run_vertex_cache_benchmark },
+    };
+}
+
+double seconds_since(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+std::vector<Segment> random_segments(const AABB& bounds, float length, unsigned count)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal;
+    std::vector<Segment> segments(count);
+
+    for (Segment& segment : segments) {
+        glm::vec3 direction(normal(rng), normal(rng), normal(rng));
+        segment.origin = bounds.min + glm::vec3(unit(rng), unit(rng), unit(rng)) * bounds.extent();
+        segment.displacement = glm::normalize(direction) * length;
+    }
+
+    return segments;
+}
+
+int main(int argc, char** argv)
+{
+    bool ran = false;
+
+    try {
+        for (const Benchmark& benchmark : benchmarks) {
+            bool selected = argc < 2;
+
+            for (int i = 1; i < argc; i++) {
+                selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+            }
+
+            if (selected) {
+                std::cout << "== " << benchmark.name << std::endl;
+                benchmark.run();
+                ran = true;
+            }
+        }
+    } catch (std::exception& ex) {
+        std::cerr << "[Error] " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!ran) {
+        std::cerr << "usage: " << argv[0] << " [benchmark...]" << std::endl << "benchmarks:";
+
+        for (const Benchmark& benchmark : benchmarks) {
+            std::cerr << " " << benchmark.name;
+        }
+
+        std::cerr << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/frustum.h"
+#include "../src/graphics/camera.h"
+#include "../src/graphics/occlusion_buffer.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const unsigned GRID_SAMPLES = 708; // about a million triangles
+    const unsigned MAX_CHUNK_TRIANGLES = 16384;
+    const unsigned MAX_OCCLUDER_TRIANGLES = 65536;
+    const unsigned PROXY_REDUCTION = 128; // full chunk triangles per proxy triangle
+    const unsigned BUFFER_WIDTH = 320;
+    const unsigned BUFFER_HEIGHT = 180;
+    const unsigned NUM_PROPS = 20000;
+    const unsigned NUM_REPEATS = 50;
+    const unsigned PROBES_PER_AXIS = 4; // points per face edge cast at to check occluded props
+
+    struct Pose {
+        const char* name;
+        float x, z;   // on the terrain, the camera stands just above it
+        float yaw;    // degrees about +y, from looking down -z
+        float pitch;  // degrees, negative looks down
+    };
+
+    const Pose POSES[] = {
+        { "valley", 160.0f, 500.0f, -60.0f, 0.0f },
+        { "hillside", 354.0f, 650.0f, 10.0f, -3.0f },
+        { "ridge", 420.0f, 300.0f, 120.0f, -10.0f },
+        { "looking down", 354.0f, 354.0f, 45.0f, -60.0f },
+    };
+
+    float terrain_height(float x, float z)
+    {
+        return 40.0f * std::sin(x * 0.015f) * std::cos(z * 0.012f) + 12.0f * std::sin((x + 2.0f * z) * 0.03f);
+    }
+
+    std::vector<Triangle> terrain_triangles(unsigned n)
+    {
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+        auto vertex = [](unsigned column, unsigned row) {
+            return glm::vec3(column * 1.0f, terrain_height(column * 1.0f, row * 1.0f), row * 1.0f);
+        };
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                triangles.push_back(Triangle(vertex(column, row), vertex(column + 1, row + 1), vertex(column + 1, row)));
+                triangles.push_back(Triangle(vertex(column, row), vertex(column, row + 1), vertex(column + 1, row + 1)));
+            }
+        }
+
+        return triangles;
+    }
+
+    // crates and rocks standing on the terrain
+    std::vector<AABB> props()
+    {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(0.0f, GRID_SAMPLES - 1.0f), size(0.5f, 2.0f);
+        std::vector<AABB> boxes(NUM_PROPS);
+
+        for (AABB& box : boxes) {
+            float x = position(generator), z = position(generator);
+            glm::vec3 half_extent(size(generator), size(generator), size(generator));
+            glm::vec3 base(x, terrain_height(x, z), z);
+            box = AABB(base - glm::vec3(half_extent.x, 0.0f, half_extent.z), base + glm::vec3(half_extent.x, 2.0f * half_extent.y, half_extent.z));
+        }
+
+        return boxes;
+    }
+
+    // whether any of a grid of points on the box's surface can be seen from eye past the terrain
+    bool probe_visible(const CollisionMesh& terrain, const glm::vec3& eye, const AABB& box)
+    {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int side = 0; side < 2; side++) {
+                for (unsigned i = 0; i <= PROBES_PER_AXIS; i++) {
+                    for (unsigned j = 0; j <= PROBES_PER_AXIS; j++) {
+                        glm::vec3 t;
+                        t[axis] = static_cast<float>(side);
+                        t[(axis + 1) % 3] = static_cast<float>(i) / PROBES_PER_AXIS;
+                        t[(axis + 2) % 3] = static_cast<float>(j) / PROBES_PER_AXIS;
+                        glm::vec3 point = box.min + t * box.extent();
+                        RaycastHit hit;
+
+                        // the terrain is one-sided, so cast from both ends to catch its back faces too
+                        if (!terrain.segment_cast(eye, 0.999f * (point - eye), hit) && !terrain.segment_cast(point, 0.999f * (eye - point), hit)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+}
+
+void run_occlusion_culling_benchmark()
+{
+    ThreadPool pool;
+    CollisionMesh terrain(terrain_triangles(GRID_SAMPLES), BVH::BEST, pool);
+    const BVH& bvh = terrain.bvh();
+    std::vector<unsigned> chunk_nodes = bvh.subtrees(MAX_CHUNK_TRIANGLES);
+    std::vector<AABB> boxes;
+
+    for (unsigned node : chunk_nodes) {
+        boxes.push_back(bvh.nodes()[node].bounds);
+    }
+
+    // a coarse proxy of every chunk, for drawing much more of the terrain into the buffer for less
+    std::vector<TriangleSoA> proxies;
+    ArrayView<unsigned> indices = terrain.indices();
+
+    for (unsigned node : chunk_nodes) {
+        unsigned first, count;
+        bvh.primitive_range(node, first, count);
+        proxies.push_back(build_occluder(terrain.vertices(), ArrayView<unsigned>(indices.data() + 3 * first, 3 * count), count / PROXY_REDUCTION));
+    }
+
+    std::vector<AABB> prop_boxes = props();
+    boxes.insert(boxes.end(), prop_boxes.begin(), prop_boxes.end());
+    BoxSoA soa;
+
+    for (const AABB& box : boxes) {
+        soa.push_back(box);
+    }
+
+    OcclusionBuffer occlusion(BUFFER_WIDTH, BUFFER_HEIGHT);
+    Camera camera;
+    camera.set_aspect_ratio(16.0f / 9.0f);
+
+    std::printf("terrain: %zu triangles in %zu chunks, %u props, %ux%u buffer, %u threads\n", terrain.triangles().size(), chunk_nodes.size(), NUM_PROPS, BUFFER_WIDTH, BUFFER_HEIGHT, pool.size());
+    std::printf("  %12s  %8s  %8s  %10s  %10s  %10s  %10s  %8s\n", "pose", "occluder", "in view", "occluded", "occluders", "raster", "test", "false");
+
+    for (const Pose& pose : POSES) {
+        glm::vec3 eye(pose.x, terrain_height(pose.x, pose.z) + 2.0f, pose.z);
+        Transform& transform = camera.get_transform();
+        transform.reset();
+        transform.set_position(eye);
+        transform.rotate(pose.yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+        transform.rotate(pose.pitch, transform.right());
+
+        std::vector<unsigned> visible, occluders;
+        cull_boxes(camera.get_frustum(), soa, visible);
+
+        for (unsigned i : visible) {
+            if (i < chunk_nodes.size()) {
+                occluders.push_back(i);
+            }
+        }
+
+        std::sort(occluders.begin(), occluders.end(), [&](unsigned a, unsigned b) {
+            return boxes[a].distance(eye) < boxes[b].distance(eye);
+        });
+
+        for (bool use_proxies : { false, true }) {
+            double raster_seconds = 0.0;
+            std::size_t rasterized = 0;
+
+            for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+                BenchClock::time_point start = BenchClock::now();
+                occlusion.begin(camera.get_view_projection_matrix());
+                unsigned occluder_triangles = 0;
+
+                for (unsigned chunk : occluders) {
+                    const TriangleSoA& triangles = use_proxies ? proxies[chunk] : terrain.triangles();
+                    unsigned first = 0, count = static_cast<unsigned>(proxies[chunk].size());
+
+                    if (!use_proxies) {
+                        bvh.primitive_range(chunk_nodes[chunk], first, count);
+                    }
+
+                    if (occluder_triangles + count > MAX_OCCLUDER_TRIANGLES) {
+                        break;
+                    }
+
+                    occlusion.add_occluder(triangles, first, count);
+                    occluder_triangles += count;
+                }
+
+                occlusion.finish(pool);
+                raster_seconds += seconds_since(start);
+                rasterized = occlusion.get_num_rasterized();
+            }
+
+            std::vector<bool> occluded(visible.size());
+            unsigned num_occluded = 0;
+            BenchClock::time_point start = BenchClock::now();
+
+            for (unsigned repeat = 0; repeat < NUM_REPEATS; repeat++) {
+                num_occluded = 0;
+
+                for (std::size_t i = 0; i < visible.size(); i++) {
+                    occluded[i] = !occlusion.is_visible(boxes[visible[i]]);
+                    num_occluded += occluded[i];
+                }
+            }
+
+            double test_seconds = seconds_since(start);
+            unsigned false_occlusions = 0;
+
+            for (std::size_t i = 0; i < visible.size(); i++) {
+                false_occlusions += occluded[i] && probe_visible(terrain, eye, boxes[visible[i]]);
+            }
+
+            std::printf("  %12s  %8s  %8zu  %9.1f%%  %10zu  %7.3f ms  %7.3f us  %8u\n", pose.name, use_proxies ? "proxy" : "full", visible.size(), 100.0 * num_occluded / std::max<std::size_t>(visible.size(), 1), rasterized, raster_seconds * 1.0e3 / NUM_REPEATS, test_seconds * 1.0e6 / NUM_REPEATS / std::max<std::size_t>(visible.size(), 1), false_occlusions);
+
+            // culling must stay conservative: anything a probe can see has to be drawn
+            if (false_occlusions > 0) {
+                throw std::runtime_error("occlusion culling: a visible box was culled");
+            }
+        }
+    }
+}
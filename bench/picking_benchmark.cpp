@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+#include <limits>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/triangle_simd.h"
+#include "../src/graphics/camera.h"
+#include "bench.h"
+
+namespace {
+    const unsigned GRID_SAMPLES = 708; // about a million triangles
+    const unsigned NUM_PICKS = 100000;
+    const unsigned NUM_VERIFIED = 200;
+    const glm::vec2 VIEWPORT(1920.0f, 1080.0f);
+
+    CollisionMesh build_terrain()
+    {
+        const unsigned n = GRID_SAMPLES;
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+
+        auto vertex = [](unsigned column, unsigned row) {
+            float height = 12.0f * std::sin(column * 0.02f) * std::cos(row * 0.017f) + 1.5f * std::sin((column + 2 * row) * 0.15f);
+            return glm::vec3(column * 1.0f, height, row * 1.0f);
+        };
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                triangles.push_back(Triangle(vertex(column, row), vertex(column + 1, row + 1), vertex(column + 1, row)));
+                triangles.push_back(Triangle(vertex(column, row), vertex(column, row + 1), vertex(column + 1, row + 1)));
+            }
+        }
+
+        return CollisionMesh(triangles);
+    }
+
+    bool linear_pick(const CollisionMesh& mesh, const Ray& ray, float& t)
+    {
+        unsigned triangle;
+        t = std::numeric_limits<float>::max();
+        return closest_hit(mesh.triangles(), 0, mesh.triangles().size(), ray.origin, ray.direction, t, triangle);
+    }
+}
+
+void run_picking_benchmark()
+{
+    BenchClock::time_point start = BenchClock::now();
+    CollisionMesh mesh = build_terrain();
+    double build_seconds = seconds_since(start);
+    const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+
+    // an editor camera hovering over one corner of the terrain, looking across it
+    Camera camera;
+    camera.set_aspect_ratio(VIEWPORT.x / VIEWPORT.y);
+    camera.get_transform().set_position(glm::vec3(bounds.min.x, bounds.max.y + 60.0f, bounds.max.z));
+    camera.get_transform().rotate(-45.0f, { 0.0f, 1.0f, 0.0f });
+    camera.get_transform().rotate(-25.0f, camera.get_transform().right());
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Ray> rays(NUM_PICKS);
+
+    for (Ray& ray : rays) {
+        ray = camera.screen_ray(glm::vec2(unit(rng), unit(rng)) * VIEWPORT, VIEWPORT);
+    }
+
+    std::vector<double> pick_ns(NUM_PICKS);
+    std::vector<float> pick_t(NUM_PICKS, -1.0f);
+    unsigned hits = 0;
+
+    for (unsigned i = 0; i < NUM_PICKS; i++) {
+        RaycastHit hit;
+        start = BenchClock::now();
+        bool found = mesh.pick(rays[i], hit);
+        pick_ns[i] = seconds_since(start) * 1.0e9;
+
+        if (found) {
+            pick_t[i] = hit.t;
+            hits++;
+        }
+    }
+
+    unsigned mismatches = 0;
+    float max_reprojection_error = 0.0f;
+    start = BenchClock::now();
+
+    for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+        float t;
+        bool found = linear_pick(mesh, rays[i], t);
+        mismatches += found != (pick_t[i] >= 0.0f) || (found && std::abs(t - pick_t[i]) > 1.0e-3f * t);
+    }
+
+    double linear_seconds = seconds_since(start);
+
+    // the picked point should project back onto the pixel it was picked from
+    std::mt19937 verify_rng(7);
+
+    for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+        glm::vec2 cursor = glm::vec2(unit(verify_rng), unit(verify_rng)) * VIEWPORT;
+
+        if (pick_t[i] >= 0.0f) {
+            glm::vec4 clip = camera.get_projection_matrix() * camera.get_transform().get_inverse_matrix() * glm::vec4(rays[i].origin + pick_t[i] * rays[i].direction, 1.0f);
+            glm::vec2 pixel((clip.x / clip.w + 1.0f) * 0.5f * VIEWPORT.x, (1.0f - clip.y / clip.w) * 0.5f * VIEWPORT.y);
+            max_reprojection_error = std::max(max_reprojection_error, glm::length(pixel - cursor));
+        }
+    }
+
+    double total_ns = 0.0;
+
+    for (double ns : pick_ns) {
+        total_ns += ns;
+    }
+
+    std::sort(pick_ns.begin(), pick_ns.end());
+    std::printf("synthetic terrain: %zu triangles, built in %.0f ms, %u picks from a %.0fx%.0f viewport\n", mesh.triangles().size(), build_seconds * 1.0e3, NUM_PICKS, VIEWPORT.x, VIEWPORT.y);
+    std::printf("  pick         %8.3f us mean  %8.3f us p50  %8.3f us p99  (%.1f%% hit)\n", total_ns * 1.0e-3 / NUM_PICKS, pick_ns[NUM_PICKS / 2] * 1.0e-3, pick_ns[NUM_PICKS * 99 / 100] * 1.0e-3, 100.0 * hits / NUM_PICKS);
+    std::printf("  linear scan  %8.3f us mean  (%u mismatches in %u picks)\n", linear_seconds * 1.0e6 / NUM_VERIFIED, mismatches, NUM_VERIFIED);
+    std::printf("  max reprojection error %.4f pixels\n", max_reprojection_error);
+}
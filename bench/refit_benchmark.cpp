@@ -0,0 +1,74 @@
+#include <cmath>
+#include <cstdio>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const int GRID_SIZE = 224; // 224 * 224 * 2 = 100352 triangles
+    const unsigned FRAMES = 120;
+
+    // a rolling wave over a flat grid, scaled by amplitude, with the grid's corner spread by spread
+    glm::vec3 wave_point(float x, float z, float time, float amplitude, float spread)
+    {
+        float y = amplitude * std::sin(0.2f * x + time) * std::cos(0.15f * z + 0.5f * time);
+        float scale = 1.0f + spread * (x + z) / GRID_SIZE;
+        return glm::vec3(x * scale, y, z * scale);
+    }
+
+    void run_animation(const char* name, float amplitude, float spread_per_frame, ThreadPool& pool)
+    {
+        std::vector<Triangle> triangles;
+
+        for (int z = 0; z < GRID_SIZE; z++) {
+            for (int x = 0; x < GRID_SIZE; x++) {
+                glm::vec3 a = wave_point(x, z, 0.0f, amplitude, 0.0f);
+                glm::vec3 b = wave_point(x + 1, z, 0.0f, amplitude, 0.0f);
+                glm::vec3 c = wave_point(x, z + 1, 0.0f, amplitude, 0.0f);
+                glm::vec3 d = wave_point(x + 1, z + 1, 0.0f, amplitude, 0.0f);
+                triangles.push_back(Triangle(a, c, b));
+                triangles.push_back(Triangle(b, c, d));
+            }
+        }
+
+        BenchClock::time_point start = BenchClock::now();
+        CollisionMesh mesh(triangles, BVH::BEST, pool);
+        double build_seconds = seconds_since(start);
+
+        // the grid is flat in xz at time 0, so every welded vertex still knows its grid coordinates
+        std::vector<glm::vec3> grid(mesh.vertices().begin(), mesh.vertices().end());
+        std::vector<glm::vec3> vertices(grid.size());
+        double refit_seconds = 0.0, rebuild_seconds = 0.0;
+        unsigned rebuilds = 0;
+
+        for (unsigned frame = 1; frame <= FRAMES; frame++) {
+            for (std::size_t v = 0; v < grid.size(); v++) {
+                vertices[v] = wave_point(grid[v].x, grid[v].z, frame / 30.0f, amplitude, spread_per_frame * frame);
+            }
+
+            start = BenchClock::now();
+            bool rebuilt = mesh.update(vertices, pool);
+            double seconds = seconds_since(start);
+
+            if (rebuilt) {
+                rebuild_seconds += seconds;
+                rebuilds++;
+            } else {
+                refit_seconds += seconds;
+            }
+        }
+
+        unsigned refits = FRAMES - rebuilds;
+        std::printf("%-14s %zu triangles: build %.2f ms, %u refits at %.2f ms, %u rebuilds at %.2f ms\n", name, mesh.triangles().size(), build_seconds * 1.0e3,
+            refits, refits ? refit_seconds * 1.0e3 / refits : 0.0, rebuilds, rebuilds ? rebuild_seconds * 1.0e3 / rebuilds : 0.0);
+    }
+}
+
+void run_refit_benchmark()
+{
+    ThreadPool pool;
+    run_animation("gentle wave", 1.0f, 0.0f, pool);
+    run_animation("tall wave", 20.0f, 0.0f, pool);
+    run_animation("stretching", 1.0f, 0.05f, pool);
+}
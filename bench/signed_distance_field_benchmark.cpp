@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/signed_distance_field.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_QUERIES = 200000;
+    const unsigned NUM_VERIFIED = 20000;
+
+    // voxel sizes as fractions of the mesh's diagonal, and the narrow band in voxels
+    const float RESOLUTIONS[] = { 1.0f / 64.0f, 1.0f / 128.0f, 1.0f / 256.0f };
+    const float BAND_VOXELS = 4.0f;
+
+    float exact_signed_distance(const CollisionMesh& mesh, const PseudoNormals& normals, const glm::vec3& P)
+    {
+        ClosestPoint closest;
+        mesh.closest_point(P, std::numeric_limits<float>::infinity(), closest);
+        return normals.is_behind(P, closest) ? -closest.distance : closest.distance;
+    }
+}
+
+void run_signed_distance_field_benchmark()
+{
+    const char* path = "res/models/grandure.obj";
+    CollisionMesh mesh(path);
+    ThreadPool pool;
+    const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+    float diagonal = glm::length(bounds.extent());
+    std::vector<Segment> queries = random_segments(bounds, 0.0f, NUM_QUERIES);
+
+    std::vector<float> exact(NUM_VERIFIED);
+    PseudoNormals normals(mesh);
+    BenchClock::time_point start = BenchClock::now();
+
+    for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+        exact[i] = exact_signed_distance(mesh, normals, queries[i].origin);
+    }
+
+    double exact_seconds = seconds_since(start);
+
+    std::printf("%s: %zu triangles, diagonal %.1f, %u threads, exact signed distance %.3f us/query\n", path, mesh.triangles().size(), diagonal, pool.size(), exact_seconds * 1.0e6 / NUM_VERIFIED);
+    std::printf("  %7s  %4s  %10s  %16s  %10s  %8s  %10s  %7s  %11s  %9s\n", "voxel", "bits", "bake", "bricks", "memory", "B/voxel", "sample", "inside", "mean error", "<1 voxel");
+
+    for (float fraction : RESOLUTIONS) {
+        for (unsigned bits : { 8u, 16u }) {
+            float voxel_size = fraction * diagonal;
+            float band = BAND_VOXELS * voxel_size;
+
+            start = BenchClock::now();
+            SignedDistanceField field(mesh, voxel_size, band, bits, pool);
+            double bake_seconds = seconds_since(start);
+
+            unsigned inside = 0;
+            start = BenchClock::now();
+
+            for (const Segment& query : queries) {
+                float distance;
+                glm::vec3 gradient;
+                field.sample(query.origin, distance, gradient);
+                inside += distance < 0.0f;
+            }
+
+            double sample_seconds = seconds_since(start);
+            double error_sum = 0.0;
+            unsigned in_band = 0, within_voxel = 0;
+
+            // the sign flips across the plane of an open boundary edge, so a few samples
+            // interpolated across it are far off; report the typical error instead of the worst
+            for (unsigned i = 0; i < NUM_VERIFIED; i++) {
+                float distance;
+                glm::vec3 gradient;
+
+                if (field.sample(queries[i].origin, distance, gradient) && glm::abs(exact[i]) < band) {
+                    float error = glm::abs(distance - exact[i]);
+                    error_sum += error;
+                    within_voxel += error < voxel_size;
+                    in_band++;
+                }
+            }
+
+            double dense_voxels = static_cast<double>(field.num_grid_bricks()) * SignedDistanceField::BRICK_CELLS * SignedDistanceField::BRICK_CELLS * SignedDistanceField::BRICK_CELLS;
+            std::printf("  %7.3f  %4u  %7.1f ms  %7zu/%-8zu  %7.2f MB  %8.3f  %7.1f ns  %6.1f%%  %11.4f  %8.1f%%\n", voxel_size, bits, bake_seconds * 1.0e3, field.num_bricks(), field.num_grid_bricks(), field.memory_usage() / 1048576.0, field.memory_usage() / dense_voxels, sample_seconds * 1.0e9 / queries.size(), 100.0 * inside / queries.size(), error_sum / in_band, 100.0 * within_voxel / in_band);
+        }
+    }
+}
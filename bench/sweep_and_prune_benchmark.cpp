@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <iterator>
+
+#include "../src/geometry/sweep_and_prune.h"
+#include "bench.h"
+
+namespace {
+    const unsigned STEPS = 200;
+    const float BODY_SIZE = 1.0f;
+    const float BODY_SPEED = 0.05f; // per step, a small fraction of a body's size
+    const float BODIES_PER_VOLUME = 0.02f;
+    const unsigned BODY_COUNTS[] = { 500, 2000, 8000 };
+    const float MOVING_FRACTIONS[] = { 0.01f, 0.1f, 1.0f };
+
+    struct Body {
+        glm::vec3 position;
+        glm::vec3 velocity;
+    };
+
+    AABB body_bounds(const Body& body)
+    {
+        return AABB(body.position - 0.5f * BODY_SIZE, body.position + 0.5f * BODY_SIZE);
+    }
+
+    std::vector<SweepAndPrune::Pair> brute_force_pairs(const std::vector<Body>& bodies, const std::vector<unsigned>& handles)
+    {
+        std::vector<SweepAndPrune::Pair> pairs;
+
+        for (std::size_t i = 0; i < bodies.size(); i++) {
+            for (std::size_t j = i + 1; j < bodies.size(); j++) {
+                glm::vec3 d = glm::abs(bodies[i].position - bodies[j].position);
+
+                if (d.x <= BODY_SIZE && d.y <= BODY_SIZE && d.z <= BODY_SIZE) {
+                    pairs.push_back({ std::min(handles[i], handles[j]), std::max(handles[i], handles[j]) });
+                }
+            }
+        }
+
+        std::sort(pairs.begin(), pairs.end());
+        return pairs;
+    }
+}
+
+void run_sweep_and_prune_benchmark()
+{
+    std::printf("%u steps, bodies of size %.1f moving %.2f per step\n", STEPS, BODY_SIZE, BODY_SPEED);
+    std::printf("  %7s  %7s  %12s  %12s  %10s  %8s  %14s  %10s\n", "bodies", "moving", "insert", "ms/step", "swaps/step", "pairs", "brute force", "mismatches");
+
+    for (unsigned count : BODY_COUNTS) {
+        for (float fraction : MOVING_FRACTIONS) {
+            float side = std::cbrt(count / BODIES_PER_VOLUME);
+            std::mt19937 rng(11);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            std::normal_distribution<float> normal;
+            std::vector<Body> bodies(count);
+
+            for (Body& body : bodies) {
+                body.position = glm::vec3(unit(rng), unit(rng), unit(rng)) * side;
+                body.velocity = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * BODY_SPEED;
+            }
+
+            SweepAndPrune broadphase;
+            std::vector<AABB> boxes(count);
+
+            for (unsigned i = 0; i < count; i++) {
+                boxes[i] = body_bounds(bodies[i]);
+            }
+
+            BenchClock::time_point start = BenchClock::now();
+            std::vector<unsigned> handles = broadphase.add(boxes);
+
+            double insert_seconds = seconds_since(start);
+            unsigned moving = std::max(static_cast<unsigned>(fraction * count), 1u);
+            std::uint64_t swaps_before = broadphase.swaps();
+            double step_seconds = 0.0;
+
+            for (unsigned step = 0; step < STEPS; step++) {
+                // a different subset of bodies moves each step, bouncing off the walls of the volume
+                unsigned first = static_cast<unsigned>((static_cast<std::uint64_t>(step) * moving) % count);
+
+                for (unsigned k = 0; k < moving; k++) {
+                    Body& body = bodies[(first + k) % count];
+                    body.position += body.velocity;
+
+                    for (int axis = 0; axis < 3; axis++) {
+                        if (body.position[axis] < 0.0f || body.position[axis] > side) {
+                            body.velocity[axis] = -body.velocity[axis];
+                        }
+                    }
+                }
+
+                start = BenchClock::now();
+
+                for (unsigned k = 0; k < moving; k++) {
+                    unsigned i = (first + k) % count;
+                    broadphase.update(handles[i], body_bounds(bodies[i]));
+                }
+
+                step_seconds += seconds_since(start);
+            }
+
+            double swaps_per_step = static_cast<double>(broadphase.swaps() - swaps_before) / STEPS;
+            start = BenchClock::now();
+            std::vector<SweepAndPrune::Pair> expected = brute_force_pairs(bodies, handles);
+            double brute_force_seconds = seconds_since(start);
+
+            std::vector<SweepAndPrune::Pair> found = broadphase.pairs();
+            std::sort(found.begin(), found.end());
+            std::vector<SweepAndPrune::Pair> difference;
+            std::set_symmetric_difference(found.begin(), found.end(), expected.begin(), expected.end(), std::back_inserter(difference));
+
+            std::printf("  %7u  %6.0f%%  %9.3f ms  %12.4f  %10.1f  %8zu  %8.3f ms/step  %10zu\n", count, 100.0f * fraction, insert_seconds * 1.0e3, step_seconds * 1.0e3 / STEPS, swaps_per_step, found.size(), brute_force_seconds * 1.0e3, difference.size());
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../src/gameplay/player.h"
+#include "../src/gameplay/player_trace.h"
+#include "../src/geometry/convex_hull.h"
+#include "bench.h"
+
+namespace {
+    const char* TRACES[] = {
+        "res/traces/grandure_walk.trace",
+        "res/traces/grandure_climb.trace",
+        "res/traces/grandure_climb_hull.trace",
+        "res/traces/terrain_skim.trace",
+    };
+
+    const unsigned REPEATS = 5;
+
+    double percentile(std::vector<double> samples, double fraction)
+    {
+        if (samples.empty()) {
+            return 0.0;
+        }
+
+        std::size_t index = std::min(static_cast<std::size_t>(fraction * samples.size()), samples.size() - 1);
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    // paths may hold quotes, backslashes or control characters, which JSON strings must escape
+    void print_string(const char* key, const std::string& value)
+    {
+        std::printf("      \"%s\": \"", key);
+
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                std::printf("\\%c", c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                std::printf("\\u%04x", static_cast<unsigned>(c));
+            } else {
+                std::putchar(c);
+            }
+        }
+
+        std::printf("\",\n");
+    }
+}
+
+void run_trace_replay_benchmark()
+{
+    std::map<std::string, std::unique_ptr<CollisionMesh>> meshes;
+    std::map<std::string, std::unique_ptr<ConvexHull>> hulls;
+    bool first = true;
+
+    // printed as JSON so runs from different commits can be diffed or compared by a script
+    std::printf("{\n  \"benchmark\": \"trace_replay\",\n  \"repeats\": %u,\n  \"traces\": [", REPEATS);
+
+    for (const char* path : TRACES) {
+        PlayerTrace trace = load_trace(path);
+        std::unique_ptr<CollisionMesh>& mesh = meshes[trace.mesh_path];
+
+        if (!mesh) {
+            mesh.reset(new CollisionMesh(trace.mesh_path));
+        }
+
+        const ConvexHull* hull = nullptr;
+
+        if (!trace.hull_path.empty()) {
+            std::unique_ptr<ConvexHull>& cached = hulls[trace.hull_path];
+
+            if (!cached) {
+                cached.reset(new ConvexHull(CollisionMesh(trace.hull_path).vertices()));
+            }
+
+            hull = cached.get();
+        }
+
+        std::vector<double> step_ns;
+        step_ns.reserve(trace.inputs.size() * REPEATS);
+        std::uint64_t queries = 0, hits = 0, triangles_tested = 0;
+        glm::vec3 final_position(0.0f);
+
+        for (unsigned repeat = 0; repeat < REPEATS; repeat++) {
+            Player player(trace.radius);
+            player.set_hull(hull);
+            player.get_transform().set_position(trace.start_position);
+            player.get_transform().set_orientation(trace.start_orientation);
+
+            for (unsigned input : trace.inputs) {
+                BenchClock::time_point start = BenchClock::now();
+                player.step(*mesh, input, static_cast<float>(trace.step));
+                step_ns.push_back(seconds_since(start) * 1.0e9);
+            }
+
+            const ContactCache& contacts = player.get_contacts();
+            queries += contacts.queries;
+            hits += contacts.hits;
+            triangles_tested += contacts.triangles_tested;
+            final_position = player.get_transform().get_position();
+        }
+
+        double total_ns = 0.0;
+
+        for (double ns : step_ns) {
+            total_ns += ns;
+        }
+
+        std::printf("%s\n    {\n", first ? "" : ",");
+        print_string("trace", path);
+        print_string("mesh", trace.mesh_path);
+        print_string("hull", trace.hull_path);
+        std::printf("      \"triangles\": %zu,\n", mesh->triangles().size());
+        std::printf("      \"steps\": %zu,\n", trace.inputs.size());
+        // steps also resolve the hull, so they are timed whole rather than per query; an empty trace reports zeros
+        std::printf("      \"mean_step_ns\": %.1f,\n", step_ns.empty() ? 0.0 : total_ns / step_ns.size());
+        std::printf("      \"queries_per_step\": %.2f,\n", step_ns.empty() ? 0.0 : static_cast<double>(queries) / step_ns.size());
+        std::printf("      \"triangles_tested_per_query\": %.2f,\n", queries > 0 ? static_cast<double>(triangles_tested) / queries : 0.0);
+        std::printf("      \"contact_cache_hit_rate\": %.4f,\n", queries > 0 ? static_cast<double>(hits) / queries : 0.0);
+        std::printf("      \"p50_step_ns\": %.1f,\n", percentile(step_ns, 0.50));
+        std::printf("      \"p99_step_ns\": %.1f,\n", percentile(step_ns, 0.99));
+        std::printf("      \"max_step_ns\": %.1f,\n", percentile(step_ns, 1.0));
+        std::printf("      \"final_position\": [%.5f, %.5f, %.5f]\n", final_position.x, final_position.y, final_position.z);
+        std::printf("    }");
+        first = false;
+    }
+
+    std::printf("\n  ]\n}\n");
+}
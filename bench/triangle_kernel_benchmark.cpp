@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <glm/geometric.hpp>
+
+#include "../src/geometry/collision_mesh.h"
+#include "../src/geometry/triangle_simd.h"
+#include "bench.h"
+
+namespace {
+    const unsigned NUM_SEGMENTS = 2000;
+
+    // the per-triangle routine that run() used before the triangle streams existed
+    bool closest_hit_scalar(const std::vector<Triangle>& triangles, const glm::vec3& O, const glm::vec3& D, float& max_t, unsigned& triangle)
+    {
+        bool found = false;
+
+        for (unsigned i = 0; i < triangles.size(); i++) {
+            float t;
+
+            if (intersect_triangle(O, D, triangles[i].points[0], triangles[i].points[1], triangles[i].points[2], max_t, t)) {
+                max_t = t;
+                triangle = i;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    void benchmark_model(const char* path)
+    {
+        CollisionMesh mesh(path);
+        const TriangleSoA& soa = mesh.triangles();
+        std::vector<Triangle> triangles;
+
+        for (std::size_t i = 0; i < soa.size(); i++) {
+            triangles.push_back(soa.triangle(i));
+        }
+
+        const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+        std::vector<Segment> segments = random_segments(bounds, glm::length(bounds.extent()) * 0.25f, NUM_SEGMENTS);
+
+        unsigned scalar_hits = 0, simd_hits = 0, bvh_hits = 0, mismatches = 0;
+        std::vector<float> scalar_t(segments.size(), 1.0f);
+        std::vector<bool> scalar_found(segments.size());
+
+        BenchClock::time_point start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            unsigned triangle;
+            scalar_found[i] = closest_hit_scalar(triangles, segments[i].origin, segments[i].displacement, scalar_t[i], triangle);
+            scalar_hits += scalar_found[i];
+        }
+
+        double scalar_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+            float t = 1.0f;
+            unsigned triangle;
+
+            if (closest_hit(soa, 0, soa.size(), segments[i].origin, segments[i].displacement, t, triangle)) {
+                simd_hits++;
+                mismatches += !scalar_found[i] || glm::abs(t - scalar_t[i]) > 1.0e-4f;
+            } else {
+                mismatches += scalar_found[i];
+            }
+        }
+
+        double simd_seconds = seconds_since(start);
+        start = BenchClock::now();
+
+        for (const Segment& segment : segments) {
+            RaycastHit hit;
+            bvh_hits += mesh.segment_cast(segment.origin, segment.displacement, hit);
+        }
+
+        double bvh_seconds = seconds_since(start);
+        double tests = static_cast<double>(segments.size()) * soa.size();
+
+        std::printf("%s: %zu triangles, %u segments\n", path, soa.size(), NUM_SEGMENTS);
+        std::printf("  scalar brute force   %8.3f ns/triangle  %10.1f us/segment  (%u hits)\n", scalar_seconds * 1.0e9 / tests, scalar_seconds * 1.0e6 / segments.size(), scalar_hits);
+        std::printf("  %-6s brute force   %8.3f ns/triangle  %10.1f us/segment  (%u hits, %u mismatches, %.2fx)\n", triangle_kernel_name(), simd_seconds * 1.0e9 / tests, simd_seconds * 1.0e6 / segments.size(), simd_hits, mismatches, scalar_seconds / simd_seconds);
+        std::printf("  %-6s bvh           %8s              %10.3f us/segment  (%u hits, %.1fx)\n", triangle_kernel_name(), "", bvh_seconds * 1.0e6 / segments.size(), bvh_hits, scalar_seconds / bvh_seconds);
+    }
+}
+
+void run_triangle_kernel_benchmark()
+{
+    benchmark_model("res/models/grandure.obj");
+    benchmark_model("res/models/terrain.obj");
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "../src/geometry/mesh_optimizer.h"
+#include "../src/geometry/simplify.h"
+#include "../src/graphics/vertex.h"
+#include "bench.h"
+
+namespace {
+    const char* MODEL_PATHS[] = {
+        "res/models/grandure.obj",
+        "res/models/suzanne.obj",
+        "res/models/terrain.obj",
+    };
+
+    const unsigned OVERDRAW_RESOLUTION = 256; // pixels per side of each view
+
+    // pixels shaded per pixel covered, over orthographic views down the six axes with a depth test;
+    // front and back faces go to separate buffers, as if each view were drawn with culling one way and then the other
+    float overdraw(const std::vector<glm::vec3>& positions, const std::vector<unsigned>& elements)
+    {
+        AABB bounds;
+
+        for (const glm::vec3& position : positions) {
+            bounds.grow(position);
+        }
+
+        std::vector<float> depth(2 * OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+        std::size_t shaded = 0, covered = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            for (float sign : { 1.0f, -1.0f }) {
+                int u_axis = (axis + 1) % 3, v_axis = (axis + 2) % 3;
+                float scale = (OVERDRAW_RESOLUTION - 1) / std::max(std::max(bounds.extent()[u_axis], bounds.extent()[v_axis]), 1.0e-6f);
+                std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+                auto project = [&](unsigned v) {
+                    glm::vec3 p = positions[v] - bounds.min;
+                    return glm::vec3(p[u_axis] * scale, p[v_axis] * scale, sign * p[axis]);
+                };
+
+                for (std::size_t i = 0; i < elements.size(); i += 3) {
+                    glm::vec3 a = project(elements[i]), b = project(elements[i + 1]), c = project(elements[i + 2]);
+                    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+
+                    if (area == 0.0f) {
+                        continue;
+                    }
+
+                    float* buffer = &depth[area > 0.0f ? 0 : OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION];
+
+                    int min_x = std::max(static_cast<int>(std::ceil(std::min(std::min(a.x, b.x), c.x) - 0.5f)), 0);
+                    int max_x = std::min(static_cast<int>(std::floor(std::max(std::max(a.x, b.x), c.x) - 0.5f)), static_cast<int>(OVERDRAW_RESOLUTION) - 1);
+                    int min_y = std::max(static_cast<int>(std::ceil(std::min(std::min(a.y, b.y), c.y) - 0.5f)), 0);
+                    int max_y = std::min(static_cast<int>(std::floor(std::max(std::max(a.y, b.y), c.y) - 0.5f)), static_cast<int>(OVERDRAW_RESOLUTION) - 1);
+
+                    for (int y = min_y; y <= max_y; y++) {
+                        for (int x = min_x; x <= max_x; x++) {
+                            float px = x + 0.5f, py = y + 0.5f;
+                            float w0 = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) / area;
+                            float w1 = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) / area;
+                            float w2 = 1.0f - w0 - w1;
+
+                            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                                continue;
+                            }
+
+                            float z = w0 * a.z + w1 * b.z + w2 * c.z;
+                            float& stored = buffer[y * OVERDRAW_RESOLUTION + x];
+
+                            if (z < stored) {
+                                covered += stored == std::numeric_limits<float>::max();
+                                stored = z;
+                                shaded++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return covered == 0 ? 0.0f : static_cast<float>(shaded) / covered;
+    }
+
+    std::vector<glm::vec3> positions_of(const std::vector<Vertex>& vertices)
+    {
+        std::vector<glm::vec3> positions(vertices.size());
+
+        for (std::size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].m_position;
+        }
+
+        return positions;
+    }
+}
+
+void run_vertex_cache_benchmark()
+{
+    std::printf("FIFO cache of %u vertices\n", VERTEX_CACHE_SIZE);
+    std::printf("  %-26s  %9s  %20s  %20s  %20s  %9s\n", "model", "triangles", "ACMR", "ATVR", "overdraw", "optimize");
+
+    for (const char* path : MODEL_PATHS) {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned> elements;
+        import_model(path, vertices, elements);
+        std::vector<glm::vec3> positions = positions_of(vertices);
+        VertexCacheStats before = analyze_vertex_cache(elements, vertices.size());
+        float overdraw_before = overdraw(positions, elements);
+
+        // the cache order alone, to show what the overdraw pass costs the cache
+        std::vector<unsigned> cache_order = elements;
+        optimize_vertex_cache(cache_order, vertices.size());
+        VertexCacheStats cache_only = analyze_vertex_cache(cache_order, vertices.size());
+        float overdraw_cache_only = overdraw(positions, cache_order);
+
+        // the full pipeline Mesh runs at load time, on the full mesh and its levels of detail
+        std::vector<LodLevel> lods = build_lods(positions, elements);
+        BenchClock::time_point start = BenchClock::now();
+        optimize_model(vertices, elements, lods);
+        double optimize_seconds = seconds_since(start);
+
+        positions = positions_of(vertices);
+        std::vector<unsigned> full(elements.begin(), elements.begin() + lods[0].count);
+        VertexCacheStats after = analyze_vertex_cache(full, vertices.size());
+        float overdraw_after = overdraw(positions, full);
+
+        std::printf("  %-26s  %9zu  %5.3f %5.3f -> %5.3f  %5.3f %5.3f -> %5.3f  %5.3f %5.3f -> %5.3f  %6.1f ms\n", path, lods[0].count / 3,
+                    before.acmr, cache_only.acmr, after.acmr, before.atvr, cache_only.atvr, after.atvr,
+                    overdraw_before, overdraw_cache_only, overdraw_after, optimize_seconds * 1.0e3);
+
+        for (std::size_t i = 1; i < lods.size(); i++) {
+            VertexCacheStats level = analyze_vertex_cache(ArrayView<unsigned>(elements.data() + lods[i].first, lods[i].count), vertices.size());
+            std::printf("  %-26s  %9zu  %20.3f  %20.3f\n", i == 1 ? "  levels of detail" : "", lods[i].count / 3, level.acmr, level.atvr);
+        }
+    }
+
+    std::printf("  columns: file order, cache order alone, and after the overdraw pass\n");
+}
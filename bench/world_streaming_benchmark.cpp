@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "../src/gameplay/world.h"
+#include "../src/gameplay/world_streamer.h"
+#include "../src/geometry/collision_mesh.h"
+#include "../src/utility/thread_pool.h"
+#include "bench.h"
+
+namespace {
+    const unsigned GRID_SAMPLES = 708; // about a million triangles
+    const float TILE_SIZE = 32.0f;
+    const float TILE_MARGIN = 4.0f;
+    const float LOAD_RADIUS = 64.0f;
+    const std::size_t MEMORY_BUDGET = 16 << 20;
+    const unsigned NUM_THREADS = 2;
+    const std::chrono::milliseconds FRAME_IDLE(2); // the part of a frame the loaders get to themselves
+    const float PROBE_OFFSET = TILE_MARGIN - 0.5f; // how far from the focus collision is checked against the whole mesh
+
+    const char* WORLD_PATH = "world_streaming_benchmark.world";
+
+    float terrain_height(float x, float z)
+    {
+        return 40.0f * std::sin(x * 0.015f) * std::cos(z * 0.012f) + 12.0f * std::sin((x + 2.0f * z) * 0.03f);
+    }
+
+    std::vector<Triangle> terrain_triangles(unsigned n)
+    {
+        std::vector<Triangle> triangles;
+        triangles.reserve(2 * (n - 1) * (n - 1));
+        auto vertex = [](unsigned column, unsigned row) {
+            return glm::vec3(column * 1.0f, terrain_height(column * 1.0f, row * 1.0f), row * 1.0f);
+        };
+
+        for (unsigned row = 0; row < n - 1; row++) {
+            for (unsigned column = 0; column < n - 1; column++) {
+                triangles.push_back(Triangle(vertex(column, row), vertex(column + 1, row + 1), vertex(column + 1, row)));
+                triangles.push_back(Triangle(vertex(column, row), vertex(column, row + 1), vertex(column + 1, row + 1)));
+            }
+        }
+
+        return triangles;
+    }
+
+    // casts straight down at point against both meshes and reports whether they disagree
+    bool mismatch(const CollisionMesh& whole, const CollisionMesh& tile, const glm::vec3& point)
+    {
+        glm::vec3 origin(point.x, 100.0f, point.z), displacement(0.0f, -200.0f, 0.0f);
+        RaycastHit whole_hit, tile_hit;
+        bool hit_whole = whole.segment_cast(origin, displacement, whole_hit);
+        bool hit_tile = tile.segment_cast(origin, displacement, tile_hit);
+        return hit_whole != hit_tile || (hit_whole && std::abs(whole_hit.t - tile_hit.t) > 1.0e-5f);
+    }
+
+    void fly(const CollisionMesh& whole, const World& world, float speed)
+    {
+        WorldStreamer streamer(world, MEMORY_BUDGET, LOAD_RADIUS, NUM_THREADS);
+        glm::vec3 start(20.0f, 0.0f, 40.0f), end(GRID_SAMPLES - 20.0f, 0.0f, GRID_SAMPLES - 60.0f);
+        unsigned num_frames = static_cast<unsigned>(glm::length(end - start) / speed);
+
+        streamer.wait_for(start);
+        std::size_t peak_bytes = 0;
+        unsigned stalled_frames = 0, mismatches = 0;
+        double update_seconds = 0.0, max_update_seconds = 0.0;
+
+        for (unsigned frame = 0; frame <= num_frames; frame++) {
+            glm::vec3 focus = start + (end - start) * (static_cast<float>(frame) / num_frames);
+            BenchClock::time_point update_start = BenchClock::now();
+            streamer.update(focus);
+            double seconds = seconds_since(update_start);
+            update_seconds += seconds;
+            max_update_seconds = std::max(max_update_seconds, seconds);
+            peak_bytes = std::max(peak_bytes, streamer.get_resident_bytes());
+
+            // everything the player could touch must be in its tile, margin included
+            if (const CollisionMesh* tile = streamer.get_collision_at(focus)) {
+                for (float dx = -PROBE_OFFSET; dx <= PROBE_OFFSET; dx += PROBE_OFFSET) {
+                    for (float dz = -PROBE_OFFSET; dz <= PROBE_OFFSET; dz += PROBE_OFFSET) {
+                        mismatches += mismatch(whole, *tile, focus + glm::vec3(dx, 0.0f, dz));
+                    }
+                }
+            } else {
+                stalled_frames++;
+            }
+
+            for (unsigned tile : streamer.get_resident()) {
+                streamer.release_geometry(tile);
+            }
+
+            std::this_thread::sleep_for(FRAME_IDLE);
+        }
+
+        std::printf("  %6.1f  %7u  %7u  %6.1f MB  %8.1f us  %8.1f us  %6llu  %9llu  %10u\n", speed, num_frames + 1, stalled_frames, peak_bytes / 1048576.0, update_seconds * 1.0e6 / (num_frames + 1), max_update_seconds * 1.0e6, static_cast<unsigned long long>(streamer.get_num_loads()), static_cast<unsigned long long>(streamer.get_num_evictions()), mismatches);
+    }
+}
+
+void run_world_streaming_benchmark()
+{
+    ThreadPool pool;
+    CollisionMesh whole(terrain_triangles(GRID_SAMPLES), BVH::BEST, pool);
+    BenchClock::time_point start = BenchClock::now();
+    World::build(whole, WORLD_PATH, TILE_SIZE, TILE_MARGIN, 1, whole.triangles().size(), pool);
+    double build_seconds = seconds_since(start);
+
+    World world(WORLD_PATH);
+    std::size_t total_bytes = 0, max_bytes = 0;
+
+    for (const World::Tile& tile : world.get_tiles()) {
+        total_bytes += tile.collision_bytes + tile.render_bytes;
+        max_bytes = std::max<std::size_t>(max_bytes, tile.collision_bytes + tile.render_bytes);
+    }
+
+    std::printf("terrain: %zu triangles in %ux%u tiles of %.0f (margin %.0f), built in %.2f s\n", whole.triangles().size(), world.get_columns(), world.get_rows(), TILE_SIZE, TILE_MARGIN, build_seconds);
+    std::printf("  whole world %.1f MB, largest tile %.2f MB, budget %.1f MB, load radius %.0f, %u loader threads\n", total_bytes / 1048576.0, max_bytes / 1048576.0, MEMORY_BUDGET / 1048576.0, LOAD_RADIUS, NUM_THREADS);
+    std::printf("  %6s  %7s  %7s  %9s  %11s  %11s  %6s  %9s  %10s\n", "speed", "frames", "stalled", "peak", "update", "max update", "loads", "evictions", "mismatches");
+
+    for (float speed : { 1.0f, 4.0f, 16.0f }) {
+        fly(whole, world, speed);
+    }
+
+    // a focus far off the grid still gets the edge tile nearest to it, however far away that is
+    {
+        WorldStreamer streamer(world, MEMORY_BUDGET, LOAD_RADIUS, NUM_THREADS);
+        glm::vec3 outside(-4.0f * LOAD_RADIUS, 0.0f, -4.0f * LOAD_RADIUS);
+        streamer.wait_for(outside);
+        std::printf("  off the grid at (%.0f, %.0f): tile %u resident\n", outside.x, outside.z, world.get_tile_at(outside));
+    }
+
+    std::remove(WORLD_PATH);
+
+    for (unsigned tile = 0; tile < world.get_tiles().size(); tile++) {
+        std::remove((std::string(WORLD_PATH) + ".tile" + std::to_string(tile)).c_str());
+    }
+}
@@ -0,0 +1,97 @@
+#include "player.h"
+
+namespace {
+    // distance the hull is pushed past the deepest contact, so the next step starts clear of it
+    const float DEPENETRATION_SKIN = 1.0e-3f;
+}
+
+const unsigned Player::MAX_DEPENETRATION_ITERATIONS;
+
+Player::Player(float radius) :
+    m_radius(radius), m_hull(nullptr)
+{
+}
+
+void Player::step(const CollisionMesh& world, unsigned input, float dt)
+{
+    m_previous_transform = m_transform;
+
+    float movement_speed = MOVEMENT_SPEED * dt;
+    float rotation_speed = ROTATION_SPEED * dt;
+    glm::vec3 velocity = { 0.0f, 0.0f, 0.0f };
+
+    if (input & INPUT_FORWARD) velocity += m_transform.forward() * movement_speed;
+    if (input & INPUT_LEFT) velocity -= m_transform.right() * movement_speed;
+    if (input & INPUT_BACKWARD) velocity -= m_transform.forward() * movement_speed;
+    if (input & INPUT_RIGHT) velocity += m_transform.right() * movement_speed;
+    if (input & INPUT_UP) velocity += m_transform.up() * movement_speed;
+    if (input & INPUT_DOWN) velocity -= m_transform.up() * movement_speed;
+    if (input & INPUT_TURN_LEFT) m_transform.rotate(rotation_speed, { 0.0f, 1.0f, 0.0f });
+    if (input & INPUT_TURN_RIGHT) m_transform.rotate(-rotation_speed, { 0.0f, 1.0f, 0.0f });
+    if (input & INPUT_PITCH_UP) m_transform.rotate(rotation_speed, m_transform.right());
+    if (input & INPUT_PITCH_DOWN) m_transform.rotate(-rotation_speed, m_transform.right());
+
+    m_transform.set_position(world.slide_sphere(m_transform.get_position(), m_radius, velocity, m_contacts));
+
+    if (m_hull) {
+        depenetrate(world);
+    }
+}
+
+void Player::set_hull(const ConvexHull* hull)
+{
+    m_hull = hull;
+}
+
+Transform& Player::get_transform()
+{
+    return m_transform;
+}
+
+const Transform& Player::get_previous_transform() const
+{
+    return m_previous_transform;
+}
+
+ContactCache& Player::get_contacts()
+{
+    return m_contacts;
+}
+
+ConvexCache& Player::get_hull_contacts()
+{
+    return m_hull_contacts;
+}
+
+float Player::get_radius() const
+{
+    return m_radius;
+}
+
+void Player::depenetrate(const CollisionMesh& world)
+{
+    glm::vec3 position = m_transform.get_position();
+
+    // resolving the deepest overlap first usually clears the shallower ones with it
+    for (unsigned iteration = 0; iteration < MAX_DEPENETRATION_ITERATIONS; iteration++) {
+        if (!world.convex_contacts(*m_hull, m_transform.get_orientation(), position, m_hull_contacts, m_hull_overlaps)) {
+            break;
+        }
+
+        const ConvexContact* deepest = &m_hull_overlaps[0];
+
+        for (const ConvexContact& contact : m_hull_overlaps) {
+            if (contact.depth > deepest->depth) {
+                deepest = &contact;
+            }
+        }
+
+        if (deepest->depth <= 0.0f) {
+            break;
+        }
+
+        position += deepest->normal * (deepest->depth + DEPENETRATION_SKIN);
+    }
+
+    m_transform.set_position(position);
+}
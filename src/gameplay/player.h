@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "../geometry/collision_mesh.h"
+#include "../geometry/convex_hull.h"
+#include "../graphics/transform.h"
+
+/**
+ * @brief The buttons held during one simulation step, as a bit mask.
+ */
+enum PlayerInput : unsigned {
+    INPUT_FORWARD = 1 << 0,
+    INPUT_BACKWARD = 1 << 1,
+    INPUT_LEFT = 1 << 2,
+    INPUT_RIGHT = 1 << 3,
+    INPUT_UP = 1 << 4,
+    INPUT_DOWN = 1 << 5,
+    INPUT_TURN_LEFT = 1 << 6,
+    INPUT_TURN_RIGHT = 1 << 7,
+    INPUT_PITCH_UP = 1 << 8,
+    INPUT_PITCH_DOWN = 1 << 9
+};
+
+/**
+ * @brief A sphere the user flies through the world, sliding along whatever it touches.
+ *
+ * With a hull set, the sphere still sweeps the movement so fast steps cannot tunnel, and the
+ * hull is then pushed out of whatever it overlaps, so the player collides with its actual shape.
+ * Holds no graphics state, so the game and headless benchmarks run the same movement code.
+ */
+class Player {
+public:
+    Player(float radius);
+
+    /**
+     * @brief Applies one simulation step of input, remembering the previous transform for interpolation.
+     */
+    void step(const CollisionMesh& world, unsigned input, float dt);
+
+    /**
+     * @brief Collides with hull, in the player's local space, in addition to the sphere. Null turns it off.
+     *
+     * The hull is not copied and must outlive the player.
+     */
+    void set_hull(const ConvexHull* hull);
+
+    Transform& get_transform();
+    const Transform& get_previous_transform() const;
+    ContactCache& get_contacts();
+    ConvexCache& get_hull_contacts();
+    float get_radius() const;
+
+    static constexpr float MOVEMENT_SPEED = 4.0f; // units per second
+    static constexpr float ROTATION_SPEED = 180.0f; // degrees per second
+    static const unsigned MAX_DEPENETRATION_ITERATIONS = 4;
+private:
+    void depenetrate(const CollisionMesh& world);
+
+    Transform m_transform;
+    Transform m_previous_transform;
+    ContactCache m_contacts;
+    float m_radius;
+
+    const ConvexHull* m_hull;
+    ConvexCache m_hull_contacts;
+    std::vector<ConvexContact> m_hull_overlaps;
+};
@@ -0,0 +1,106 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "player_trace.h"
+
+namespace {
+    const char* TRACE_MAGIC = "playtest-trace";
+    const unsigned TRACE_VERSION = 1;
+
+    void expect(std::istream& stream, const std::string& keyword, const std::string& path)
+    {
+        std::string word;
+
+        if (!(stream >> word) || word != keyword) {
+            throw std::runtime_error("Malformed trace '" + path + "': expected '" + keyword + "'");
+        }
+    }
+}
+
+PlayerTrace load_trace(const std::string& path)
+{
+    std::ifstream file(path);
+
+    if (!file) {
+        throw std::runtime_error("Failed to open trace '" + path + "'");
+    }
+
+    PlayerTrace trace;
+    unsigned version;
+    expect(file, TRACE_MAGIC, path);
+
+    if (!(file >> version) || version != TRACE_VERSION) {
+        throw std::runtime_error("Unsupported trace version in '" + path + "'");
+    }
+
+    expect(file, "mesh", path);
+    file >> trace.mesh_path;
+    expect(file, "radius", path);
+    file >> trace.radius;
+    expect(file, "step", path);
+    file >> trace.step;
+    expect(file, "position", path);
+    file >> trace.start_position.x >> trace.start_position.y >> trace.start_position.z;
+    expect(file, "orientation", path);
+    file >> trace.start_orientation.w >> trace.start_orientation.x >> trace.start_orientation.y >> trace.start_orientation.z;
+
+    // traces recorded without a hull have no hull line
+    std::string word;
+
+    if (file >> word && word == "hull") {
+        file >> trace.hull_path;
+        expect(file, "inputs", path);
+    } else if (word != "inputs") {
+        throw std::runtime_error("Malformed trace '" + path + "': expected 'inputs'");
+    }
+
+    if (!file) {
+        throw std::runtime_error("Malformed trace header in '" + path + "'");
+    }
+
+    unsigned input, count;
+
+    while (file >> std::hex >> input >> std::dec >> count) {
+        trace.inputs.insert(trace.inputs.end(), count, input);
+    }
+
+    if (!file.eof()) {
+        throw std::runtime_error("Malformed trace inputs in '" + path + "'");
+    }
+
+    return trace;
+}
+
+void save_trace(const std::string& path, const PlayerTrace& trace)
+{
+    std::ofstream file(path);
+
+    if (!file) {
+        throw std::runtime_error("Failed to create trace '" + path + "'");
+    }
+
+    file.precision(9);
+    file << TRACE_MAGIC << ' ' << TRACE_VERSION << '\n';
+    file << "mesh " << trace.mesh_path << '\n';
+    file << "radius " << trace.radius << '\n';
+    file << "step " << trace.step << '\n';
+    file << "position " << trace.start_position.x << ' ' << trace.start_position.y << ' ' << trace.start_position.z << '\n';
+    file << "orientation " << trace.start_orientation.w << ' ' << trace.start_orientation.x << ' ' << trace.start_orientation.y << ' ' << trace.start_orientation.z << '\n';
+
+    if (!trace.hull_path.empty()) {
+        file << "hull " << trace.hull_path << '\n';
+    }
+
+    file << "inputs\n";
+
+    for (std::size_t first = 0; first < trace.inputs.size();) {
+        std::size_t last = first + 1;
+
+        while (last < trace.inputs.size() && trace.inputs[last] == trace.inputs[first]) {
+            last++;
+        }
+
+        file << std::hex << trace.inputs[first] << std::dec << ' ' << (last - first) << '\n';
+        first = last;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A recorded play session: where the player started and the PlayerInput mask of every step.
+ *
+ * Replaying the inputs through Player::step() at the same step length reproduces the session,
+ * which makes traces usable as repeatable benchmark workloads.
+ */
+struct PlayerTrace {
+    std::string mesh_path;
+    std::string hull_path; // the model whose ConvexHull the player collides with, or empty for the sphere alone
+    float radius;
+    double step;
+    glm::vec3 start_position;
+    glm::quat start_orientation;
+    std::vector<unsigned> inputs;
+};
+
+/**
+ * @brief Reads a trace written by save_trace(). Throws std::runtime_error if the file is malformed.
+ */
+PlayerTrace load_trace(const std::string& path);
+
+/**
+ * @brief Writes trace as text, storing runs of identical inputs as a single line.
+ */
+void save_trace(const std::string& path, const PlayerTrace& trace);
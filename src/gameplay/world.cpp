@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "../graphics/occlusion_buffer.h"
+#include "world.h"
+
+namespace {
+    const char INDEX_MAGIC[8] = { 'P', 'L', 'A', 'Y', 'W', 'R', 'L', 'D' };
+
+    // occluders keep one triangle in this many, but never fewer than MIN_OCCLUDER_TRIANGLES
+    const std::size_t OCCLUDER_REDUCTION = 128;
+    const std::size_t MIN_OCCLUDER_TRIANGLES = 8;
+
+    struct IndexHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t quality;
+        std::uint32_t columns;
+        std::uint32_t rows;
+        float tile_size;
+        float margin;
+        float origin_x;
+        float origin_z;
+        std::uint64_t key_hash;
+        std::uint64_t key_size;
+    };
+
+    struct TileRecord {
+        float min[3];
+        float max[3];
+        std::uint64_t collision_bytes;
+        std::uint64_t render_bytes;
+        std::uint32_t num_triangles;
+        std::uint32_t num_render_triangles;
+        std::uint32_t num_occluder_triangles;
+        std::uint32_t reserved;
+    };
+
+    std::string tile_path(const std::string& path, unsigned tile)
+    {
+        return path + ".tile" + std::to_string(tile);
+    }
+
+    // every tile is keyed by its index too, so a tile file copied from another slot is rejected
+    std::uint64_t tile_key(std::uint64_t key_hash, unsigned tile)
+    {
+        return key_hash ^ (tile + 1) * 0x9E3779B97F4A7C15ull;
+    }
+
+    unsigned grid_cell(float coordinate, float origin, float tile_size, unsigned count)
+    {
+        float cell = std::floor((coordinate - origin) / tile_size);
+        return static_cast<unsigned>(std::min(std::max(cell, 0.0f), static_cast<float>(count - 1)));
+    }
+
+    bool read_header(std::ifstream& file, IndexHeader& header)
+    {
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        return file && std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 && header.version == World::VERSION;
+    }
+}
+
+const unsigned World::VERSION;
+
+World::World(const std::string& path) : m_path(path)
+{
+    std::ifstream file(path, std::ios::binary);
+    IndexHeader header;
+
+    if (!read_header(file, header) || header.columns == 0 || header.rows == 0 || !(header.tile_size > 0.0f)) {
+        throw std::runtime_error("Failed to read world index '" + path + "'");
+    }
+
+    m_columns = header.columns;
+    m_rows = header.rows;
+    m_tile_size = header.tile_size;
+    m_margin = header.margin;
+    m_origin_x = header.origin_x;
+    m_origin_z = header.origin_z;
+    m_quality = static_cast<BVH::Quality>(header.quality);
+    m_key_hash = header.key_hash;
+    m_key_size = header.key_size;
+
+    std::vector<TileRecord> records(static_cast<std::size_t>(m_columns) * m_rows);
+    file.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TileRecord)));
+
+    if (!file) {
+        throw std::runtime_error("Failed to read world index '" + path + "': truncated");
+    }
+
+    for (const TileRecord& record : records) {
+        Tile tile;
+        tile.bounds = AABB(glm::vec3(record.min[0], record.min[1], record.min[2]), glm::vec3(record.max[0], record.max[1], record.max[2]));
+        tile.collision_bytes = record.collision_bytes;
+        tile.render_bytes = record.render_bytes;
+        tile.num_triangles = record.num_triangles;
+        tile.num_render_triangles = record.num_render_triangles;
+        tile.num_occluder_triangles = record.num_occluder_triangles;
+        m_tiles.push_back(tile);
+    }
+
+    // the occluders follow the records, three corners per triangle, tile after tile
+    for (const Tile& tile : m_tiles) {
+        std::vector<glm::vec3> corners(3 * static_cast<std::size_t>(tile.num_occluder_triangles));
+        file.read(reinterpret_cast<char*>(corners.data()), static_cast<std::streamsize>(corners.size() * sizeof(glm::vec3)));
+
+        if (!file) {
+            throw std::runtime_error("Failed to read world index '" + path + "': truncated");
+        }
+
+        m_occluders.emplace_back();
+        m_occluders.back().reserve(tile.num_occluder_triangles);
+
+        for (std::size_t i = 0; i < corners.size(); i += 3) {
+            m_occluders.back().push_back(Triangle(corners[i], corners[i + 1], corners[i + 2]));
+        }
+    }
+}
+
+void World::build(const CollisionMesh& source, const std::string& path, float tile_size, float margin,
+                  std::uint64_t key_hash, std::uint64_t key_size, ThreadPool& pool, BVH::Quality quality)
+{
+    if (!(tile_size > 0.0f) || margin < 0.0f) {
+        throw std::invalid_argument("World::build: tiles must have a positive size and a margin of at least zero");
+    }
+
+    const TriangleSoA& triangles = source.triangles();
+    AABB bounds = source.bvh().nodes().empty() ? AABB(glm::vec3(0.0f), glm::vec3(0.0f)) : source.bvh().nodes()[0].bounds;
+
+    IndexHeader header = {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = VERSION;
+    header.quality = static_cast<std::uint32_t>(quality);
+    header.columns = std::max(static_cast<unsigned>(std::ceil(bounds.extent().x / tile_size)), 1u);
+    header.rows = std::max(static_cast<unsigned>(std::ceil(bounds.extent().z / tile_size)), 1u);
+    header.tile_size = tile_size;
+    header.margin = margin;
+    header.origin_x = bounds.min.x;
+    header.origin_z = bounds.min.z;
+    header.key_hash = key_hash;
+    header.key_size = key_size;
+
+    // every triangle goes to each tile whose core, grown by the margin, its bounds overlap
+    std::vector<std::vector<Triangle>> tile_triangles(static_cast<std::size_t>(header.columns) * header.rows);
+
+    for (std::size_t i = 0; i < triangles.size(); i++) {
+        Triangle triangle = triangles.triangle(i);
+        AABB box;
+
+        for (const glm::vec3& point : triangle.points) {
+            box.grow(point);
+        }
+
+        unsigned column_begin = grid_cell(box.min.x - margin, header.origin_x, tile_size, header.columns);
+        unsigned column_end = grid_cell(box.max.x + margin, header.origin_x, tile_size, header.columns);
+        unsigned row_begin = grid_cell(box.min.z - margin, header.origin_z, tile_size, header.rows);
+        unsigned row_end = grid_cell(box.max.z + margin, header.origin_z, tile_size, header.rows);
+
+        for (unsigned row = row_begin; row <= row_end; row++) {
+            for (unsigned column = column_begin; column <= column_end; column++) {
+                tile_triangles[row * header.columns + column].push_back(triangle);
+            }
+        }
+    }
+
+    std::vector<TileRecord> records(tile_triangles.size());
+    std::vector<glm::vec3> occluders;
+
+    for (unsigned tile = 0; tile < tile_triangles.size(); tile++) {
+        CollisionMesh mesh(tile_triangles[tile], quality, pool);
+        std::vector<Triangle>().swap(tile_triangles[tile]);
+
+        if (!mesh.save(tile_path(path, tile), tile_key(key_hash, tile), key_size)) {
+            throw std::runtime_error("Failed to write world tile '" + tile_path(path, tile) + "'");
+        }
+
+        TileRecord& record = records[tile];
+        AABB tile_bounds = mesh.bvh().nodes().empty() ? AABB(glm::vec3(0.0f), glm::vec3(0.0f)) : mesh.bvh().nodes()[0].bounds;
+        std::memcpy(record.min, &tile_bounds.min[0], sizeof(record.min));
+        std::memcpy(record.max, &tile_bounds.max[0], sizeof(record.max));
+        record.collision_bytes = mesh.memory_usage();
+        record.num_triangles = static_cast<std::uint32_t>(mesh.triangles().size());
+        record.num_render_triangles = 0;
+
+        for (std::size_t i = 0; i < mesh.triangles().size(); i++) {
+            Triangle triangle = mesh.triangles().triangle(i);
+            glm::vec3 centroid = (triangle.points[0] + triangle.points[1] + triangle.points[2]) / 3.0f;
+            unsigned column = grid_cell(centroid.x, header.origin_x, tile_size, header.columns);
+            unsigned row = grid_cell(centroid.z, header.origin_z, tile_size, header.rows);
+            record.num_render_triangles += row * header.columns + column == tile;
+        }
+
+        // three flat-shaded vertices of two vec3s and three elements per triangle
+        record.render_bytes = record.num_render_triangles * 3 * (2 * sizeof(glm::vec3) + sizeof(unsigned));
+
+        std::size_t occluder_triangles = std::max(mesh.triangles().size() / OCCLUDER_REDUCTION, MIN_OCCLUDER_TRIANGLES);
+        TriangleSoA occluder = build_occluder(mesh.vertices(), mesh.indices(), occluder_triangles);
+        record.num_occluder_triangles = static_cast<std::uint32_t>(occluder.size());
+
+        for (std::size_t i = 0; i < occluder.size(); i++) {
+            Triangle triangle = occluder.triangle(i);
+            occluders.insert(occluders.end(), triangle.points.begin(), triangle.points.end());
+        }
+    }
+
+    // write next to the index and rename it into place, so a half-written index is never read
+    std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TileRecord)));
+        file.write(reinterpret_cast<const char*>(occluders.data()), static_cast<std::streamsize>(occluders.size() * sizeof(glm::vec3)));
+
+        if (!file) {
+            file.close();
+            std::remove(temporary_path.c_str());
+            throw std::runtime_error("Failed to write world index '" + path + "'");
+        }
+    }
+
+    if (!replace_file(temporary_path, path)) {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Failed to write world index '" + path + "'");
+    }
+}
+
+bool World::is_current(const std::string& path, std::uint64_t key_hash, std::uint64_t key_size, float tile_size, float margin,
+                       BVH::Quality quality)
+{
+    std::ifstream file(path, std::ios::binary);
+    IndexHeader header;
+    return read_header(file, header) && header.key_hash == key_hash && header.key_size == key_size &&
+           header.tile_size == tile_size && header.margin == margin && header.quality == static_cast<std::uint32_t>(quality);
+}
+
+std::unique_ptr<CollisionMesh> World::load_collision(unsigned tile) const
+{
+    return std::unique_ptr<CollisionMesh>(new CollisionMesh(tile_path(m_path, tile), tile_key(m_key_hash, tile), m_key_size, m_quality));
+}
+
+const TriangleSoA& World::get_occluder(unsigned tile) const
+{
+    return m_occluders[tile];
+}
+
+const std::vector<World::Tile>& World::get_tiles() const
+{
+    return m_tiles;
+}
+
+unsigned World::get_columns() const
+{
+    return m_columns;
+}
+
+unsigned World::get_rows() const
+{
+    return m_rows;
+}
+
+float World::get_tile_size() const
+{
+    return m_tile_size;
+}
+
+float World::get_margin() const
+{
+    return m_margin;
+}
+
+unsigned World::get_tile_at(const glm::vec3& position) const
+{
+    return grid_cell(position.z, m_origin_z, m_tile_size, m_rows) * m_columns + grid_cell(position.x, m_origin_x, m_tile_size, m_columns);
+}
+
+float World::get_distance(unsigned tile, const glm::vec3& position) const
+{
+    float min_x = m_origin_x + (tile % m_columns) * m_tile_size;
+    float min_z = m_origin_z + (tile / m_columns) * m_tile_size;
+    float dx = std::max(std::max(min_x - position.x, position.x - (min_x + m_tile_size)), 0.0f);
+    float dz = std::max(std::max(min_z - position.z, position.z - (min_z + m_tile_size)), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
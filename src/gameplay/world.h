@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../geometry/bvh.h"
+#include "../geometry/collision_mesh.h"
+#include "../geometry/geometry.h"
+#include "../utility/thread_pool.h"
+
+/**
+ * @brief A large mesh cut into a grid of square tiles on the xz plane, so only the tiles around the player need to be loaded.
+ *
+ * An index file lists the grid and every tile's bounds and memory cost, and each tile is a
+ * collision cache of its own next to it. Collision tiles overlap their neighbours by a margin,
+ * so a player inside a tile's core, its square of the grid, only ever collides with that tile.
+ * Each triangle is drawn by exactly one tile: the one whose core holds its centroid. The index
+ * also holds a coarse copy of every tile to draw as an occluder, which stays loaded.
+ */
+class World {
+public:
+    struct Tile {
+        AABB bounds;                       // everything in the tile's collision mesh, margin included
+        std::uint64_t collision_bytes;     // CollisionMesh::memory_usage() of the tile
+        std::uint64_t render_bytes;        // the vertices and elements of the triangles it draws
+        std::uint32_t num_triangles;       // in the collision mesh
+        std::uint32_t num_render_triangles;
+        std::uint32_t num_occluder_triangles;
+    };
+
+    /**
+     * @brief Reads the index at path.
+     *
+     * @throws std::runtime_error If the index is missing, corrupt, or was written by another VERSION.
+     */
+    World(const std::string& path);
+
+    /**
+     * @brief Cuts source into tiles tile_size wide, overlapping by margin, and saves the index at path and the tiles next to it.
+     *
+     * key_hash and key_size identify the source, usually by MappedFile::hash() and size() of
+     * the file it was loaded from, so is_current() can tell when to build again. Tiles large
+     * enough to be worth splitting are built on the threads of pool.
+     *
+     * @throws std::runtime_error If a file cannot be written.
+     */
+    static void build(const CollisionMesh& source, const std::string& path, float tile_size, float margin,
+                      std::uint64_t key_hash, std::uint64_t key_size, ThreadPool& pool, BVH::Quality quality = BVH::BEST);
+
+    /**
+     * @brief Whether path holds an index of this VERSION that build() would write again from these arguments.
+     *
+     * The source is identified by key_hash and key_size alone, as in build().
+     */
+    static bool is_current(const std::string& path, std::uint64_t key_hash, std::uint64_t key_size, float tile_size, float margin,
+                           BVH::Quality quality = BVH::BEST);
+
+    /**
+     * @brief Maps tile's collision mesh. Safe to call from any thread.
+     *
+     * @throws std::runtime_error If the tile's file is missing, corrupt, or belongs to another build.
+     */
+    std::unique_ptr<CollisionMesh> load_collision(unsigned tile) const;
+
+    /**
+     * @brief A coarse copy of tile's collision mesh, see build_occluder().
+     */
+    const TriangleSoA& get_occluder(unsigned tile) const;
+
+    const std::vector<Tile>& get_tiles() const;
+    unsigned get_columns() const;
+    unsigned get_rows() const;
+    float get_tile_size() const;
+    float get_margin() const;
+
+    /**
+     * @brief The tile whose core holds position. Positions off the grid belong to the nearest tile on its edge.
+     */
+    unsigned get_tile_at(const glm::vec3& position) const;
+
+    /**
+     * @brief The distance from position to tile's core on the xz plane.
+     */
+    float get_distance(unsigned tile, const glm::vec3& position) const;
+
+    static const unsigned VERSION = 2;
+private:
+    std::string m_path;
+    std::vector<Tile> m_tiles;
+    std::vector<TriangleSoA> m_occluders;
+    unsigned m_columns;
+    unsigned m_rows;
+    float m_tile_size;
+    float m_margin;
+    float m_origin_x;
+    float m_origin_z;
+    BVH::Quality m_quality;
+    std::uint64_t m_key_hash;
+    std::uint64_t m_key_size;
+};
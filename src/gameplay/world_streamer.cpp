@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "world_streamer.h"
+
+namespace {
+    const std::size_t PAGE_SIZE = 4096;
+}
+
+WorldStreamer::WorldStreamer(const World& world, std::size_t memory_budget, float load_radius, unsigned num_threads) :
+    m_world(world), m_memory_budget(memory_budget), m_load_radius(load_radius),
+    m_unload_radius(load_radius + 0.5f * world.get_tile_size()), m_slots(world.get_tiles().size()),
+    m_wanted(world.get_tiles().size(), 0), m_committed_bytes(0), m_resident_bytes(0), m_num_loads(0), m_num_evictions(0),
+    m_queued(world.get_tiles().size(), 0), m_stop(false)
+{
+    for (unsigned tile = 0; tile < m_slots.size(); tile++) {
+        if (cost(tile) > memory_budget) {
+            throw std::invalid_argument("WorldStreamer: a tile does not fit the memory budget");
+        }
+
+        m_slots[tile].state = UNLOADED;
+        m_slots[tile].generation = 0;
+    }
+
+    for (unsigned i = 0; i < std::max(num_threads, 1u); i++) {
+        m_threads.emplace_back(&WorldStreamer::worker_loop, this);
+    }
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorldStreamer::update(const glm::vec3& focus)
+{
+    std::vector<Load> finished;
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        finished.swap(m_finished);
+    }
+
+    for (Load& load : finished) {
+        Slot& slot = m_slots[load.tile];
+
+        if (load.error) {
+            slot.state = UNLOADED;
+            m_committed_bytes -= cost(load.tile);
+            error = load.error;
+            continue;
+        }
+
+        slot.state = RESIDENT;
+        slot.generation++;
+        slot.collision = std::move(load.collision);
+        slot.vertices = std::move(load.vertices);
+        slot.elements = std::move(load.elements);
+        m_resident_bytes += cost(load.tile);
+        m_num_loads++;
+    }
+
+    m_active.erase(std::remove_if(m_active.begin(), m_active.end(), [&](unsigned tile) {
+        return m_slots[tile].state == UNLOADED;
+    }), m_active.end());
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // tiles within the load radius are wanted, and loaded ones are kept up to the unload radius
+    unsigned columns = m_world.get_columns();
+    unsigned first = m_world.get_tile_at(focus - glm::vec3(m_unload_radius, 0.0f, m_unload_radius));
+    unsigned last = m_world.get_tile_at(focus + glm::vec3(m_unload_radius, 0.0f, m_unload_radius));
+    m_candidates.clear();
+
+    // so is the focus tile, first of all, even when the focus is off the grid and that tile is farther away
+    unsigned focus_tile = m_world.get_tile_at(focus);
+
+    for (unsigned row = first / columns; row <= last / columns; row++) {
+        for (unsigned column = first % columns; column <= last % columns; column++) {
+            unsigned tile = row * columns + column;
+            float distance = tile == focus_tile ? 0.0f : m_world.get_distance(tile, focus);
+
+            if (distance <= m_load_radius || (distance <= m_unload_radius && m_slots[tile].state != UNLOADED)) {
+                m_candidates.emplace_back(distance, tile);
+            }
+        }
+    }
+
+    std::sort(m_candidates.begin(), m_candidates.end());
+
+    // the nearest tiles that fit the budget together are wanted, the rest are not
+    std::size_t wanted_bytes = 0;
+    std::size_t num_wanted = 0;
+
+    while (num_wanted < m_candidates.size() && wanted_bytes + cost(m_candidates[num_wanted].second) <= m_memory_budget) {
+        wanted_bytes += cost(m_candidates[num_wanted].second);
+        num_wanted++;
+    }
+
+    m_candidates.resize(num_wanted);
+
+    for (const auto& candidate : m_candidates) {
+        m_wanted[candidate.second] = 1;
+    }
+
+    for (unsigned tile : m_active) {
+        Slot& slot = m_slots[tile];
+
+        if (!m_wanted[tile] && slot.state == RESIDENT) {
+            slot.state = UNLOADED;
+            slot.collision.reset();
+            std::vector<Vertex>().swap(slot.vertices);
+            std::vector<unsigned>().swap(slot.elements);
+            m_committed_bytes -= cost(tile);
+            m_resident_bytes -= cost(tile);
+            m_num_evictions++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // tiles a worker already took finish loading and are evicted by a later update
+    for (unsigned tile : m_active) {
+        if (!m_wanted[tile] && m_queued[tile]) {
+            m_slots[tile].state = UNLOADED;
+            m_queued[tile] = 0;
+            m_committed_bytes -= cost(tile);
+        }
+    }
+
+    m_active.erase(std::remove_if(m_active.begin(), m_active.end(), [&](unsigned tile) {
+        return m_slots[tile].state == UNLOADED;
+    }), m_active.end());
+
+    // requeue nearest first, so tiles the focus is heading for overtake the ones it left behind
+    m_queue.clear();
+    m_resident.clear();
+
+    for (const auto& candidate : m_candidates) {
+        unsigned tile = candidate.second;
+        Slot& slot = m_slots[tile];
+
+        if (slot.state == RESIDENT) {
+            m_resident.push_back(tile);
+        } else if (slot.state == REQUESTED) {
+            if (m_queued[tile]) {
+                m_queue.push_back(tile);
+            }
+        } else if (m_committed_bytes + cost(tile) <= m_memory_budget) {
+            slot.state = REQUESTED;
+            m_queued[tile] = 1;
+            m_queue.push_back(tile);
+            m_active.push_back(tile);
+            m_committed_bytes += cost(tile);
+        }
+    }
+
+    if (!m_queue.empty()) {
+        m_wake.notify_all();
+    }
+
+    for (const auto& candidate : m_candidates) {
+        m_wanted[candidate.second] = 0;
+    }
+}
+
+void WorldStreamer::wait_for(const glm::vec3& position)
+{
+    update(position);
+
+    while (!get_collision_at(position)) {
+        // the tile may still be waiting for other tiles to finish and free their share of the budget,
+        // but with no load requested at all nothing would ever wake this thread
+        if (std::none_of(m_active.begin(), m_active.end(), [this](unsigned tile) { return m_slots[tile].state == REQUESTED; })) {
+            throw std::runtime_error("WorldStreamer::wait_for: the tile at the position is not being loaded");
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_loaded.wait(lock, [this] { return !m_finished.empty(); });
+        }
+
+        update(position);
+    }
+}
+
+const CollisionMesh* WorldStreamer::get_collision_at(const glm::vec3& position) const
+{
+    return get_collision(m_world.get_tile_at(position));
+}
+
+const CollisionMesh* WorldStreamer::get_collision(unsigned tile) const
+{
+    return m_slots[tile].collision.get();
+}
+
+bool WorldStreamer::is_resident(unsigned tile) const
+{
+    return m_slots[tile].state == RESIDENT;
+}
+
+const std::vector<unsigned>& WorldStreamer::get_resident() const
+{
+    return m_resident;
+}
+
+unsigned WorldStreamer::get_generation(unsigned tile) const
+{
+    return m_slots[tile].generation;
+}
+
+const std::vector<Vertex>& WorldStreamer::get_vertices(unsigned tile) const
+{
+    return m_slots[tile].vertices;
+}
+
+const std::vector<unsigned>& WorldStreamer::get_elements(unsigned tile) const
+{
+    return m_slots[tile].elements;
+}
+
+void WorldStreamer::release_geometry(unsigned tile)
+{
+    std::vector<Vertex>().swap(m_slots[tile].vertices);
+    std::vector<unsigned>().swap(m_slots[tile].elements);
+}
+
+const World& WorldStreamer::get_world() const
+{
+    return m_world;
+}
+
+std::size_t WorldStreamer::get_memory_budget() const
+{
+    return m_memory_budget;
+}
+
+std::size_t WorldStreamer::get_resident_bytes() const
+{
+    return m_resident_bytes;
+}
+
+std::uint64_t WorldStreamer::get_num_loads() const
+{
+    return m_num_loads;
+}
+
+std::uint64_t WorldStreamer::get_num_evictions() const
+{
+    return m_num_evictions;
+}
+
+void WorldStreamer::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+
+        if (m_stop) {
+            return;
+        }
+
+        Load result;
+        result.tile = m_queue.front();
+        m_queue.pop_front();
+        m_queued[result.tile] = 0;
+        lock.unlock();
+
+        try {
+            load(result);
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+
+        lock.lock();
+        m_finished.push_back(std::move(result));
+        m_loaded.notify_all();
+    }
+}
+
+void WorldStreamer::load(Load& result) const
+{
+    result.collision = m_world.load_collision(result.tile);
+    const TriangleSoA& triangles = result.collision->triangles();
+    const BVH& bvh = result.collision->bvh();
+
+    // fault the mapped hierarchy in here rather than on the first query; the triangles are read below
+    volatile unsigned char sink = 0;
+    const unsigned char* nodes = reinterpret_cast<const unsigned char*>(bvh.nodes().data());
+    std::size_t node_bytes = bvh.nodes().size() * sizeof(bvh.nodes()[0]);
+
+    for (std::size_t offset = 0; offset < node_bytes; offset += PAGE_SIZE) {
+        sink = sink + nodes[offset];
+    }
+
+    // each tile draws the triangles whose centroid is in its core, runs of them at a time
+    const World::Tile& tile = m_world.get_tiles()[result.tile];
+    result.vertices.reserve(3 * tile.num_render_triangles);
+    result.elements.reserve(3 * tile.num_render_triangles);
+    std::size_t run = 0;
+
+    for (std::size_t i = 0; i < triangles.size(); i++) {
+        Triangle triangle = triangles.triangle(i);
+        glm::vec3 centroid = (triangle.points[0] + triangle.points[1] + triangle.points[2]) / 3.0f;
+
+        if (m_world.get_tile_at(centroid) != result.tile) {
+            append_flat_triangles(triangles, run, i - run, result.vertices, result.elements);
+            run = i + 1;
+        }
+    }
+
+    append_flat_triangles(triangles, run, triangles.size() - run, result.vertices, result.elements);
+}
+
+std::size_t WorldStreamer::cost(unsigned tile) const
+{
+    const World::Tile& info = m_world.get_tiles()[tile];
+    return static_cast<std::size_t>(info.collision_bytes + info.render_bytes);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../geometry/collision_mesh.h"
+#include "../graphics/vertex.h"
+#include "world.h"
+
+/**
+ * @brief Keeps the tiles of a World around a moving focus loaded, reading them on background threads.
+ *
+ * Every update() collects the tiles the workers finished, then wants the tile holding the focus
+ * and the tiles within the load radius of it, nearest first, as far as they fit the memory
+ * budget. Tiles that are no longer wanted are evicted or, if still queued, dropped. A tile stays
+ * until the focus is half a tile past the load radius, so walking along a tile's edge does not
+ * reload it every frame.
+ *
+ * A tile costs World::Tile::collision_bytes plus render_bytes, whether it is resident or still
+ * loading, and the total never exceeds the budget. Loaded tiles also hold their render geometry
+ * until the renderer has uploaded it and calls release_geometry().
+ */
+class WorldStreamer {
+public:
+    /**
+     * @throws std::invalid_argument If a single tile costs more than memory_budget.
+     */
+    WorldStreamer(const World& world, std::size_t memory_budget, float load_radius, unsigned num_threads = 2);
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    /**
+     * @brief Takes in finished loads and queues or evicts tiles around focus.
+     *
+     * @throws std::runtime_error If a tile failed to load since the last update.
+     */
+    void update(const glm::vec3& focus);
+
+    /**
+     * @brief Updates around position until its tile is resident, for when there is nothing to show yet.
+     *
+     * @throws std::runtime_error If a load fails, or nothing is left loading while the tile is still not resident.
+     */
+    void wait_for(const glm::vec3& position);
+
+    /**
+     * @brief The collision mesh of the tile holding position, or nullptr if it is not resident yet.
+     */
+    const CollisionMesh* get_collision_at(const glm::vec3& position) const;
+
+    const CollisionMesh* get_collision(unsigned tile) const;
+    bool is_resident(unsigned tile) const;
+
+    /**
+     * @brief The resident tiles, nearest to the last focus first.
+     */
+    const std::vector<unsigned>& get_resident() const;
+
+    /**
+     * @brief Counts the times tile became resident, so users can tell a reloaded tile from the one they knew.
+     */
+    unsigned get_generation(unsigned tile) const;
+
+    /**
+     * @brief The triangles a resident tile draws, flat-shaded, until release_geometry() is called.
+     */
+    const std::vector<Vertex>& get_vertices(unsigned tile) const;
+    const std::vector<unsigned>& get_elements(unsigned tile) const;
+    void release_geometry(unsigned tile);
+
+    const World& get_world() const;
+    std::size_t get_memory_budget() const;
+
+    /**
+     * @brief The cost of the resident tiles, which with the tiles still loading stays within the budget.
+     */
+    std::size_t get_resident_bytes() const;
+
+    std::uint64_t get_num_loads() const;
+    std::uint64_t get_num_evictions() const;
+private:
+    enum State {
+        UNLOADED,
+        REQUESTED, // queued or being loaded
+        RESIDENT,
+    };
+
+    struct Slot {
+        State state;
+        unsigned generation;
+        std::unique_ptr<CollisionMesh> collision;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned> elements;
+    };
+
+    struct Load {
+        unsigned tile;
+        std::unique_ptr<CollisionMesh> collision;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned> elements;
+        std::exception_ptr error;
+    };
+
+    void worker_loop();
+    void load(Load& result) const;
+    std::size_t cost(unsigned tile) const;
+
+    const World& m_world;
+    std::size_t m_memory_budget;
+    float m_load_radius;
+    float m_unload_radius;
+
+    // only touched by the thread calling update()
+    std::vector<Slot> m_slots;
+    std::vector<unsigned> m_active; // tiles that are not UNLOADED
+    std::vector<unsigned> m_resident;
+    std::vector<std::pair<float, unsigned>> m_candidates; // scratch
+    std::vector<unsigned char> m_wanted; // scratch, all zero between updates
+    std::size_t m_committed_bytes; // resident and requested tiles
+    std::size_t m_resident_bytes;
+    std::uint64_t m_num_loads;
+    std::uint64_t m_num_evictions;
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_loaded;
+    std::deque<unsigned> m_queue;
+    std::vector<unsigned char> m_queued; // tiles in m_queue that no worker took yet
+    std::vector<Load> m_finished;
+    bool m_stop;
+};
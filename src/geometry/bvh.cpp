@@ -0,0 +1,688 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "bvh.h"
+
+namespace {
+    const int NUM_BINS = 12;
+    const float TRAVERSAL_COST = 1.0f;
+    const float INTERSECTION_COST = 1.0f;
+
+    // bits per axis of the Morton codes
+    const unsigned MORTON_BITS = 10;
+
+    // the top levels stop splitting at subtrees of about 1 / TARGET_SUBTREES of the primitives,
+    // which leaves enough subtrees to balance between threads and no fewer than MIN_SUBTREE_SIZE
+    const unsigned TARGET_SUBTREES = 64;
+    const unsigned MIN_SUBTREE_SIZE = 1024;
+
+    // primitives per chunk when the threads share the work on a single node or pass
+    const std::size_t SPLIT_GRAIN = 16384;
+
+    struct Bin {
+        AABB bounds;
+        unsigned count = 0;
+    };
+
+    using AxisBins = std::array<std::array<Bin, NUM_BINS>, 3>;
+
+    struct Split {
+        int axis; // -1 if no bin boundary separates the primitives
+        int bin; // the first bin on the right
+        float cost;
+    };
+
+    int bin_index(float centroid, float axis_min, float scale)
+    {
+        return std::min(NUM_BINS - 1, static_cast<int>((centroid - axis_min) * scale));
+    }
+
+    float bin_scale(const AABB& centroid_bounds, int axis)
+    {
+        float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        return extent > 0.0f ? NUM_BINS / extent : 0.0f;
+    }
+
+    std::uint32_t spread_bits(std::uint32_t x)
+    {
+        x = (x | (x << 16)) & 0x030000FFu;
+        x = (x | (x << 8)) & 0x0300F00Fu;
+        x = (x | (x << 4)) & 0x030C30C3u;
+        x = (x | (x << 2)) & 0x09249249u;
+        return x;
+    }
+
+    std::uint32_t highest_bit(std::uint32_t x)
+    {
+        x |= x >> 1;
+        x |= x >> 2;
+        x |= x >> 4;
+        x |= x >> 8;
+        x |= x >> 16;
+        return x ^ (x >> 1);
+    }
+
+    /**
+     * Splits nodes for one build. The top levels pass the pool to share each split between
+     * the threads; subtrees pass null and run on whichever thread claimed them.
+     */
+    class Builder {
+    public:
+        Builder(const std::vector<AABB>& primitive_bounds, std::vector<unsigned>& primitives, unsigned max_leaf_size) :
+            m_bounds(primitive_bounds), m_primitives(primitives), m_max_leaf_size(max_leaf_size)
+        {
+        }
+
+        std::vector<glm::vec3> centroids;
+        std::vector<std::uint32_t> codes; // per primitive, empty for Quality::BEST
+        std::vector<unsigned> scratch;
+
+        /**
+         * Splits node with the binned SAH. stable keeps the primitives on each side in
+         * their order, which Morton-code splits further down rely on.
+         */
+        bool split_sah(const BVH::Node& node, unsigned depth, bool stable, ThreadPool* pool, BVH::Node& left, BVH::Node& right)
+        {
+            // traversal keeps a fixed-size stack, so the tree must not grow deeper than MAX_DEPTH
+            if (node.count <= 1 || depth + 1 >= BVH::MAX_DEPTH) {
+                return false;
+            }
+
+            unsigned* begin = m_primitives.data() + node.first;
+            unsigned* end = begin + node.count;
+            bool parallel = pool && node.count > SPLIT_GRAIN;
+            std::size_t num_chunks = (node.count + SPLIT_GRAIN - 1) / SPLIT_GRAIN;
+            AABB centroid_bounds;
+            AxisBins bins;
+
+            if (parallel) {
+                std::vector<AABB> chunk_bounds(num_chunks);
+                std::vector<AxisBins> chunk_bins(num_chunks);
+
+                pool->parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t c = first; c < last; c++) {
+                        for (unsigned* it = begin + c * SPLIT_GRAIN; it != std::min(end, begin + (c + 1) * SPLIT_GRAIN); it++) {
+                            chunk_bounds[c].grow(centroids[*it]);
+                        }
+                    }
+                });
+
+                for (const AABB& bounds : chunk_bounds) {
+                    centroid_bounds.grow(bounds);
+                }
+
+                pool->parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t c = first; c < last; c++) {
+                        fill_bins(begin + c * SPLIT_GRAIN, std::min(end, begin + (c + 1) * SPLIT_GRAIN), centroid_bounds, chunk_bins[c]);
+                    }
+                });
+
+                for (const AxisBins& partial : chunk_bins) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        for (int b = 0; b < NUM_BINS; b++) {
+                            bins[axis][b].bounds.grow(partial[axis][b].bounds);
+                            bins[axis][b].count += partial[axis][b].count;
+                        }
+                    }
+                }
+            } else {
+                for (unsigned* it = begin; it != end; it++) {
+                    centroid_bounds.grow(centroids[*it]);
+                }
+
+                fill_bins(begin, end, centroid_bounds, bins);
+            }
+
+            Split split = find_split(bins, centroid_bounds, node.count);
+            float node_area = node.bounds.surface_area();
+            float leaf_cost = INTERSECTION_COST * node.count * node_area;
+            float split_cost = TRAVERSAL_COST * node_area + INTERSECTION_COST * split.cost;
+
+            if (node.count <= m_max_leaf_size && (split.axis < 0 || split_cost >= leaf_cost)) {
+                return false;
+            }
+
+            left = BVH::Node();
+            right = BVH::Node();
+            left.first = node.first;
+            left.count = 0;
+
+            if (split.axis >= 0) {
+                float axis_min = centroid_bounds.min[split.axis];
+                float scale = bin_scale(centroid_bounds, split.axis);
+                auto goes_left = [&](unsigned primitive) {
+                    return bin_index(centroids[primitive][split.axis], axis_min, scale) < split.bin;
+                };
+
+                if (parallel) {
+                    left.count = static_cast<unsigned>(parallel_partition(begin, end, num_chunks, goes_left, *pool));
+                } else if (stable) {
+                    left.count = static_cast<unsigned>(std::stable_partition(begin, end, goes_left) - begin);
+                } else {
+                    left.count = static_cast<unsigned>(std::partition(begin, end, goes_left) - begin);
+                }
+
+                // the bins already hold the bounds of either side
+                for (int b = 0; b < NUM_BINS; b++) {
+                    (b < split.bin ? left : right).bounds.grow(bins[split.axis][b].bounds);
+                }
+            } else {
+                // every centroid coincides, so any split is as good as another
+                left.count = node.count / 2;
+
+                for (unsigned* it = begin; it != end; it++) {
+                    (it - begin < left.count ? left : right).bounds.grow(m_bounds[*it]);
+                }
+            }
+
+            right.first = node.first + left.count;
+            right.count = node.count - left.count;
+            return true;
+        }
+
+        /**
+         * Splits node at the highest bit in which its first and last Morton codes differ. The
+         * primitives must be sorted by code. Bounds are left empty for fill_bounds().
+         */
+        bool split_morton(const BVH::Node& node, unsigned depth, BVH::Node& left, BVH::Node& right) const
+        {
+            if (node.count <= m_max_leaf_size || depth + 1 >= BVH::MAX_DEPTH) {
+                return false;
+            }
+
+            const unsigned* begin = m_primitives.data() + node.first;
+            const unsigned* end = begin + node.count;
+            std::uint32_t first_code = codes[begin[0]];
+            std::uint32_t last_code = codes[end[-1]];
+            unsigned left_count = node.count / 2;
+
+            // identical codes carry no more order, so fall back to splitting the range in half
+            if (first_code != last_code) {
+                std::uint32_t bit = highest_bit(first_code ^ last_code);
+
+                left_count = static_cast<unsigned>(std::partition_point(begin, end, [&](unsigned primitive) {
+                    return (codes[primitive] & bit) == 0;
+                }) - begin);
+            }
+
+            left = BVH::Node();
+            right = BVH::Node();
+            left.first = node.first;
+            left.count = left_count;
+            right.first = node.first + left_count;
+            right.count = node.count - left_count;
+            return true;
+        }
+
+        /**
+         * Builds the subtree below nodes[0] into nodes, on the calling thread.
+         */
+        void build_subtree(std::vector<BVH::Node>& nodes, unsigned depth, BVH::Quality quality)
+        {
+            std::vector<std::pair<unsigned, unsigned>> stack = { { 0, depth } };
+
+            while (!stack.empty()) {
+                std::pair<unsigned, unsigned> entry = stack.back();
+                stack.pop_back();
+
+                BVH::Node left, right;
+                bool split = quality == BVH::BEST
+                    ? split_sah(nodes[entry.first], entry.second, false, nullptr, left, right)
+                    : split_morton(nodes[entry.first], entry.second, left, right);
+
+                if (!split) {
+                    continue;
+                }
+
+                unsigned left_index = static_cast<unsigned>(nodes.size());
+                nodes[entry.first].first = left_index;
+                nodes[entry.first].count = 0;
+                nodes.push_back(left);
+                nodes.push_back(right);
+                stack.push_back({ left_index, entry.second + 1 });
+                stack.push_back({ left_index + 1, entry.second + 1 });
+            }
+
+            if (quality != BVH::BEST) {
+                fill_bounds(nodes, 0);
+            }
+        }
+
+        /**
+         * Computes the bounds of nodes[first, end) bottom-up. Children are always stored after
+         * their parent, and children before first must already have their bounds.
+         */
+        void fill_bounds(std::vector<BVH::Node>& nodes, std::size_t first) const
+        {
+            for (std::size_t i = nodes.size(); i-- > first;) {
+                BVH::Node& node = nodes[i];
+                node.bounds = AABB();
+
+                if (node.count > 0) {
+                    for (unsigned k = node.first; k < node.first + node.count; k++) {
+                        node.bounds.grow(m_bounds[m_primitives[k]]);
+                    }
+                } else {
+                    node.bounds.grow(nodes[node.first].bounds);
+                    node.bounds.grow(nodes[node.first + 1].bounds);
+                }
+            }
+        }
+    private:
+        void fill_bins(const unsigned* begin, const unsigned* end, const AABB& centroid_bounds, AxisBins& bins) const
+        {
+            glm::vec3 scale;
+
+            for (int axis = 0; axis < 3; axis++) {
+                scale[axis] = bin_scale(centroid_bounds, axis);
+            }
+
+            // axes whose centroids all coincide still get binned, but find_split() skips them
+            for (const unsigned* it = begin; it != end; it++) {
+                const AABB& bounds = m_bounds[*it];
+                const glm::vec3& centroid = centroids[*it];
+
+                for (int axis = 0; axis < 3; axis++) {
+                    Bin& bin = bins[axis][bin_index(centroid[axis], centroid_bounds.min[axis], scale[axis])];
+                    bin.bounds.grow(bounds);
+                    bin.count++;
+                }
+            }
+        }
+
+        Split find_split(const AxisBins& bins, const AABB& centroid_bounds, unsigned count) const
+        {
+            Split best = { -1, 0, std::numeric_limits<float>::max() };
+
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroid_bounds.max[axis] - centroid_bounds.min[axis] <= 0.0f) {
+                    continue;
+                }
+
+                // sweep from the right to gather the cost of every right-hand partition
+                std::array<float, NUM_BINS> right_cost;
+                AABB right_bounds;
+                unsigned right_count = 0;
+
+                for (int b = NUM_BINS - 1; b > 0; b--) {
+                    right_bounds.grow(bins[axis][b].bounds);
+                    right_count += bins[axis][b].count;
+                    right_cost[b] = right_count ? right_bounds.surface_area() * right_count : 0.0f;
+                }
+
+                AABB left_bounds;
+                unsigned left_count = 0;
+
+                for (int b = 0; b < NUM_BINS - 1; b++) {
+                    left_bounds.grow(bins[axis][b].bounds);
+                    left_count += bins[axis][b].count;
+                    float cost = (left_count ? left_bounds.surface_area() * left_count : 0.0f) + right_cost[b + 1];
+
+                    if (left_count > 0 && left_count < count && cost < best.cost) {
+                        best = { axis, b + 1, cost };
+                    }
+                }
+            }
+
+            return best;
+        }
+
+        /**
+         * Moves the primitives for which goes_left holds to the front, keeping their order on
+         * both sides: every chunk counts its own, then scatters them to its share of scratch.
+         */
+        template <typename Predicate>
+        std::size_t parallel_partition(unsigned* begin, unsigned* end, std::size_t num_chunks, const Predicate& goes_left, ThreadPool& pool)
+        {
+            std::size_t count = end - begin;
+            std::vector<std::size_t> left_counts(num_chunks + 1, 0);
+            scratch.resize(std::max(scratch.size(), count));
+
+            pool.parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t c = first; c < last; c++) {
+                    left_counts[c + 1] = std::count_if(begin + c * SPLIT_GRAIN, std::min(end, begin + (c + 1) * SPLIT_GRAIN), goes_left);
+                }
+            });
+
+            for (std::size_t c = 0; c < num_chunks; c++) {
+                left_counts[c + 1] += left_counts[c];
+            }
+
+            std::size_t total_left = left_counts[num_chunks];
+
+            pool.parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t c = first; c < last; c++) {
+                    std::size_t chunk_begin = c * SPLIT_GRAIN;
+                    std::size_t next_left = left_counts[c];
+                    std::size_t next_right = total_left + chunk_begin - left_counts[c];
+
+                    for (unsigned* it = begin + chunk_begin; it != std::min(end, begin + chunk_begin + SPLIT_GRAIN); it++) {
+                        scratch[goes_left(*it) ? next_left++ : next_right++] = *it;
+                    }
+                }
+            });
+
+            pool.parallel_for(count, SPLIT_GRAIN, [&](std::size_t first, std::size_t last) {
+                std::copy(scratch.begin() + first, scratch.begin() + last, begin + first);
+            });
+
+            return total_left;
+        }
+
+        const std::vector<AABB>& m_bounds;
+        std::vector<unsigned>& m_primitives;
+        unsigned m_max_leaf_size;
+    };
+
+    /**
+     * Sorts primitives by their Morton codes with a least-significant-digit radix sort. Every
+     * chunk histograms and scatters its own primitives, so the passes spread over the threads.
+     */
+    void sort_by_code(std::vector<unsigned>& primitives, const std::vector<std::uint32_t>& codes, ThreadPool& pool)
+    {
+        const unsigned RADIX_BITS = 8;
+        const unsigned NUM_BUCKETS = 1 << RADIX_BITS;
+        std::size_t count = primitives.size();
+        std::size_t num_chunks = (count + SPLIT_GRAIN - 1) / SPLIT_GRAIN;
+        std::vector<unsigned> sorted(count);
+        std::vector<std::array<std::size_t, NUM_BUCKETS>> offsets(num_chunks);
+
+        for (unsigned shift = 0; shift < 3 * MORTON_BITS; shift += RADIX_BITS) {
+            pool.parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t c = first; c < last; c++) {
+                    offsets[c].fill(0);
+
+                    for (std::size_t i = c * SPLIT_GRAIN; i < std::min(count, (c + 1) * SPLIT_GRAIN); i++) {
+                        offsets[c][(codes[primitives[i]] >> shift) & (NUM_BUCKETS - 1)]++;
+                    }
+                }
+            });
+
+            // bucket by bucket, each chunk writes after the chunks before it
+            std::size_t next = 0;
+
+            for (unsigned bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+                for (std::size_t c = 0; c < num_chunks; c++) {
+                    std::size_t chunk_count = offsets[c][bucket];
+                    offsets[c][bucket] = next;
+                    next += chunk_count;
+                }
+            }
+
+            pool.parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t c = first; c < last; c++) {
+                    for (std::size_t i = c * SPLIT_GRAIN; i < std::min(count, (c + 1) * SPLIT_GRAIN); i++) {
+                        sorted[offsets[c][(codes[primitives[i]] >> shift) & (NUM_BUCKETS - 1)]++] = primitives[i];
+                    }
+                }
+            });
+
+            primitives.swap(sorted);
+        }
+    }
+}
+
+BVH::BVH()
+{
+}
+
+BVH::BVH(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size)
+{
+    ThreadPool pool(1);
+    build(primitive_bounds, max_leaf_size, BEST, pool);
+}
+
+BVH::BVH(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size, Quality quality, ThreadPool& pool)
+{
+    build(primitive_bounds, max_leaf_size, quality, pool);
+}
+
+BVH::BVH(ArrayView<Node> nodes, ArrayView<unsigned> primitives) :
+    m_stored_nodes(nodes), m_stored_primitives(primitives)
+{
+}
+
+ArrayView<BVH::Node> BVH::nodes() const
+{
+    return m_stored_nodes.empty() ? ArrayView<Node>(m_nodes) : m_stored_nodes;
+}
+
+ArrayView<unsigned> BVH::primitives() const
+{
+    return m_stored_primitives.empty() ? ArrayView<unsigned>(m_primitives) : m_stored_primitives;
+}
+
+void BVH::primitive_range(unsigned node, unsigned& first, unsigned& count) const
+{
+    ArrayView<Node> nodes = this->nodes();
+    unsigned leftmost = node, rightmost = node;
+
+    // every subtree covers a contiguous range, from its leftmost leaf to its rightmost one
+    while (nodes[leftmost].count == 0) leftmost = nodes[leftmost].first;
+    while (nodes[rightmost].count == 0) rightmost = nodes[rightmost].first + 1;
+
+    first = nodes[leftmost].first;
+    count = nodes[rightmost].first + nodes[rightmost].count - first;
+}
+
+std::vector<unsigned> BVH::subtrees(unsigned max_primitives) const
+{
+    std::vector<unsigned> roots;
+
+    if (nodes().empty()) {
+        return roots;
+    }
+
+    std::vector<unsigned> stack(1, 0);
+
+    while (!stack.empty()) {
+        unsigned node = stack.back();
+        stack.pop_back();
+        unsigned first, count;
+        primitive_range(node, first, count);
+
+        if (count <= max_primitives || nodes()[node].count > 0) {
+            roots.push_back(node);
+        } else {
+            // right first, so the left subtree comes out first
+            stack.push_back(nodes()[node].first + 1);
+            stack.push_back(nodes()[node].first);
+        }
+    }
+
+    return roots;
+}
+
+float BVH::refit(const std::function<AABB(unsigned first, unsigned count)>& leaf_bounds)
+{
+    if (!m_stored_nodes.empty()) {
+        m_nodes.assign(m_stored_nodes.begin(), m_stored_nodes.end());
+        m_primitives.assign(m_stored_primitives.begin(), m_stored_primitives.end());
+        m_stored_nodes = ArrayView<Node>();
+        m_stored_primitives = ArrayView<unsigned>();
+    }
+
+    // Children are always stored after their parent, so a reverse sweep visits them first.
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        Node& node = m_nodes[i];
+
+        if (node.count > 0) {
+            node.bounds = leaf_bounds(node.first, node.count);
+        } else {
+            node.bounds = m_nodes[node.first].bounds;
+            node.bounds.grow(m_nodes[node.first + 1].bounds);
+        }
+    }
+
+    return sah_cost();
+}
+
+float BVH::sah_cost() const
+{
+    ArrayView<Node> nodes = this->nodes();
+
+    if (nodes.empty()) {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+
+    for (const Node& node : nodes) {
+        float area = node.bounds.surface_area();
+
+        if (node.count > 0) {
+            cost += area * INTERSECTION_COST * node.count;
+        } else {
+            cost += area * TRAVERSAL_COST;
+        }
+    }
+
+    float root_area = nodes[0].bounds.surface_area();
+    return root_area > 0.0f ? cost / root_area : 0.0f;
+}
+
+void BVH::build(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size, Quality quality, ThreadPool& pool)
+{
+    unsigned num_primitives = static_cast<unsigned>(primitive_bounds.size());
+
+    if (num_primitives == 0) {
+        return;
+    }
+
+    Builder builder(primitive_bounds, m_primitives, max_leaf_size);
+    builder.centroids.resize(num_primitives);
+    m_primitives.resize(num_primitives);
+
+    std::size_t num_chunks = (num_primitives + SPLIT_GRAIN - 1) / SPLIT_GRAIN;
+    std::vector<AABB> chunk_bounds(num_chunks), chunk_centroid_bounds(num_chunks);
+
+    pool.parallel_for(num_chunks, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t c = first; c < last; c++) {
+            for (unsigned i = static_cast<unsigned>(c * SPLIT_GRAIN); i < std::min<std::size_t>(num_primitives, (c + 1) * SPLIT_GRAIN); i++) {
+                builder.centroids[i] = primitive_bounds[i].center();
+                m_primitives[i] = i;
+                chunk_bounds[c].grow(primitive_bounds[i]);
+                chunk_centroid_bounds[c].grow(builder.centroids[i]);
+            }
+        }
+    });
+
+    Node root;
+    root.first = 0;
+    root.count = num_primitives;
+    AABB centroid_bounds;
+
+    for (std::size_t c = 0; c < num_chunks; c++) {
+        root.bounds.grow(chunk_bounds[c]);
+        centroid_bounds.grow(chunk_centroid_bounds[c]);
+    }
+
+    // Morton codes quantize the centroids on a grid over their bounds
+    if (quality != BEST) {
+        glm::vec3 extent = centroid_bounds.extent();
+        glm::vec3 scale;
+
+        for (int axis = 0; axis < 3; axis++) {
+            scale[axis] = extent[axis] > 0.0f ? ((1u << MORTON_BITS) - 1) / extent[axis] : 0.0f;
+        }
+
+        builder.codes.resize(num_primitives);
+
+        pool.parallel_for(num_primitives, SPLIT_GRAIN, [&](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i < last; i++) {
+                glm::uvec3 cell((builder.centroids[i] - centroid_bounds.min) * scale);
+                builder.codes[i] = spread_bits(cell.x) << 2 | spread_bits(cell.y) << 1 | spread_bits(cell.z);
+            }
+        });
+
+        sort_by_code(m_primitives, builder.codes, pool);
+    }
+
+    m_nodes.clear();
+    m_nodes.push_back(root);
+
+    // split the top levels one node at a time, sharing each split between the threads
+    unsigned subtree_size = std::max(MIN_SUBTREE_SIZE, num_primitives / TARGET_SUBTREES);
+    std::vector<std::pair<unsigned, unsigned>> stack = { { 0, 0 } };
+    std::vector<std::pair<unsigned, unsigned>> subtrees;
+
+    while (!stack.empty()) {
+        std::pair<unsigned, unsigned> entry = stack.back();
+        stack.pop_back();
+
+        Node left, right;
+        bool split = m_nodes[entry.first].count > subtree_size && (quality == FAST
+            ? builder.split_morton(m_nodes[entry.first], entry.second, left, right)
+            : builder.split_sah(m_nodes[entry.first], entry.second, quality == BALANCED, &pool, left, right));
+
+        // small nodes, and any the top levels leave unsplit, finish as subtrees on a single thread
+        if (!split) {
+            subtrees.push_back(entry);
+            continue;
+        }
+
+        unsigned left_index = static_cast<unsigned>(m_nodes.size());
+        m_nodes[entry.first].first = left_index;
+        m_nodes[entry.first].count = 0;
+        m_nodes.push_back(left);
+        m_nodes.push_back(right);
+        stack.push_back({ left_index, entry.second + 1 });
+        stack.push_back({ left_index + 1, entry.second + 1 });
+    }
+
+    // the largest subtrees go first, so the small ones fill in the gaps at the end
+    std::stable_sort(subtrees.begin(), subtrees.end(), [&](const std::pair<unsigned, unsigned>& a, const std::pair<unsigned, unsigned>& b) {
+        return m_nodes[a.first].count > m_nodes[b.first].count;
+    });
+
+    std::vector<std::vector<Node>> subtree_nodes(subtrees.size());
+
+    pool.parallel_for(subtrees.size(), 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t k = first; k < last; k++) {
+            subtree_nodes[k].reserve(2 * m_nodes[subtrees[k].first].count);
+            subtree_nodes[k].push_back(m_nodes[subtrees[k].first]);
+            builder.build_subtree(subtree_nodes[k], subtrees[k].second, quality);
+        }
+    });
+
+    // each subtree's root replaces its top-level leaf, and the rest is appended after the top levels
+    std::size_t top_count = m_nodes.size();
+    std::vector<std::size_t> offsets(subtrees.size() + 1, top_count);
+
+    for (std::size_t k = 0; k < subtrees.size(); k++) {
+        offsets[k + 1] = offsets[k] + subtree_nodes[k].size() - 1;
+    }
+
+    m_nodes.resize(offsets.back());
+
+    pool.parallel_for(subtrees.size(), 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t k = first; k < last; k++) {
+            const std::vector<Node>& nodes = subtree_nodes[k];
+            unsigned base = static_cast<unsigned>(offsets[k]) - 1;
+
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                Node node = nodes[i];
+
+                if (node.count == 0) {
+                    node.first += base;
+                }
+
+                m_nodes[i == 0 ? subtrees[k].first : base + i] = node;
+            }
+        }
+    });
+
+    // Morton-code splits leave the top levels without bounds
+    if (quality == FAST) {
+        for (std::size_t i = top_count; i-- > 0;) {
+            if (m_nodes[i].count == 0) {
+                m_nodes[i].bounds = m_nodes[m_nodes[i].first].bounds;
+                m_nodes[i].bounds.grow(m_nodes[m_nodes[i].first + 1].bounds);
+            }
+        }
+    }
+
+    m_nodes.shrink_to_fit();
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <functional>
+#include <glm/common.hpp>
+#include <utility>
+#include <vector>
+
+#include "../utility/array_view.h"
+#include "../utility/thread_pool.h"
+#include "geometry.h"
+
+/**
+ * @brief Whether the ray O + tD, given inv_D = 1 / D, passes through box for some 0 <= t <= max_t.
+ *
+ * @param t_enter Receives where the ray enters the box, or 0 if it starts inside.
+ */
+inline bool intersect_aabb(const glm::vec3& O, const glm::vec3& inv_D, const AABB& box, float max_t, float& t_enter)
+{
+    glm::vec3 t0 = (box.min - O) * inv_D;
+    glm::vec3 t1 = (box.max - O) * inv_D;
+    glm::vec3 t_min = glm::min(t0, t1);
+    glm::vec3 t_max = glm::max(t0, t1);
+    t_enter = glm::max(glm::max(t_min.x, t_min.y), glm::max(t_min.z, 0.0f));
+    float t_exit = glm::min(glm::min(t_max.x, t_max.y), glm::min(t_max.z, max_t));
+    return t_enter <= t_exit;
+}
+
+inline bool overlaps(const AABB& a, const AABB& b)
+{
+    return a.min.x <= b.max.x && a.min.y <= b.max.y && a.min.z <= b.max.z &&
+           b.min.x <= a.max.x && b.min.y <= a.max.y && b.min.z <= a.max.z;
+}
+
+/**
+ * @brief A bounding volume hierarchy built top-down with a binned surface area heuristic.
+ *
+ * The hierarchy only knows about the bounds of its primitives. Owners reorder their
+ * primitives to match primitives() so that every leaf refers to a contiguous range.
+ */
+class BVH {
+public:
+    struct Node {
+        AABB bounds;
+        unsigned first; // index of the left child, or of the first primitive in a leaf
+        unsigned count; // number of primitives in a leaf, 0 for interior nodes
+    };
+
+    /**
+     * @brief How much build time to spend on query speed.
+     */
+    enum Quality {
+        FAST,     // split at Morton-code bits everywhere, like a linear BVH
+        BALANCED, // binned SAH for the top levels, Morton-code splits below them
+        BEST      // binned SAH everywhere
+    };
+
+    static const unsigned MAX_DEPTH = 64;
+
+    BVH();
+
+    /**
+     * @brief Builds with Quality::BEST on the calling thread.
+     */
+    BVH(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size = 4);
+
+    /**
+     * @brief Builds on the threads of pool.
+     *
+     * The top levels are split one node at a time, with every thread binning and partitioning
+     * a share of the node's primitives. Once there are enough subtrees to keep the threads busy,
+     * each subtree is built on a single thread, largest first. The hierarchy does not depend
+     * on the number of threads.
+     */
+    BVH(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size, Quality quality, ThreadPool& pool);
+
+    /**
+     * @brief Refers to a hierarchy stored elsewhere, such as in a mapped cache file.
+     *
+     * The arrays must outlive the BVH, or its first refit(), which copies them.
+     */
+    BVH(ArrayView<Node> nodes, ArrayView<unsigned> primitives);
+
+    ArrayView<Node> nodes() const;
+    ArrayView<unsigned> primitives() const;
+
+    /**
+     * @brief The range [first, first + count) of primitives() under node.
+     */
+    void primitive_range(unsigned node, unsigned& first, unsigned& count) const;
+
+    /**
+     * @brief The roots of the largest subtrees with at most max_primitives primitives each, in primitives() order.
+     *
+     * Together they cover every primitive once. A leaf with more primitives is a subtree of its own.
+     */
+    std::vector<unsigned> subtrees(unsigned max_primitives) const;
+
+    /**
+     * @brief Recomputes every node's bounds bottom-up in O(n) without changing the tree's topology.
+     *
+     * @param leaf_bounds Returns the bounds of the primitives at [first, first + count) in primitives() order.
+     * It is called exactly once per leaf, so it may also update the primitives themselves.
+     * @return The sah_cost() of the refitted tree.
+     */
+    float refit(const std::function<AABB(unsigned first, unsigned count)>& leaf_bounds);
+
+    /**
+     * @brief The expected cost of a random ray query under the surface area heuristic.
+     *
+     * Grows as refitting stretches nodes over primitives that have moved apart,
+     * so it can be compared with the cost right after building to judge tree quality.
+     */
+    float sah_cost() const;
+
+    /**
+     * @brief Calls visit_leaf(first, count, max_t) for every leaf the ray O + tD reaches with 0 <= t <= max_t.
+     *
+     * The nearer child is visited first, and visit_leaf may lower max_t to its closest hit so that
+     * nodes beyond it are skipped. Every box is grown by inflate on all sides, which turns the walk
+     * into one for a sphere of that radius swept along the ray.
+     */
+    template <typename LeafVisitor>
+    void traverse_ray(const glm::vec3& O, const glm::vec3& D, float& max_t, float inflate, LeafVisitor visit_leaf) const;
+
+    /**
+     * @brief Calls visit_leaf(first, count) for every leaf whose box overlaps region, until it returns false.
+     *
+     * @return Whether every such leaf was visited.
+     */
+    template <typename LeafVisitor>
+    bool traverse_region(const AABB& region, LeafVisitor visit_leaf) const;
+private:
+    void build(const std::vector<AABB>& primitive_bounds, unsigned max_leaf_size, Quality quality, ThreadPool& pool);
+
+    std::vector<Node> m_nodes;
+    std::vector<unsigned> m_primitives;
+    ArrayView<Node> m_stored_nodes; // used instead of m_nodes when not empty
+    ArrayView<unsigned> m_stored_primitives;
+};
+
+template <typename LeafVisitor>
+void BVH::traverse_ray(const glm::vec3& O, const glm::vec3& D, float& max_t, float inflate, LeafVisitor visit_leaf) const
+{
+    ArrayView<Node> nodes = this->nodes();
+    glm::vec3 inv_D = 1.0f / D;
+    glm::vec3 grow(inflate);
+    float entry;
+
+    if (nodes.empty() || !intersect_aabb(O, inv_D, AABB(nodes[0].bounds.min - grow, nodes[0].bounds.max + grow), max_t, entry)) {
+        return;
+    }
+
+    unsigned stack[MAX_DEPTH + 1];
+    unsigned stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const Node& node = nodes[stack[--stack_size]];
+
+        if (node.count > 0) {
+            visit_leaf(node.first, node.count, max_t);
+            continue;
+        }
+
+        unsigned near_child = node.first;
+        unsigned far_child = node.first + 1;
+        float near_t, far_t;
+        bool near_hit = intersect_aabb(O, inv_D, AABB(nodes[near_child].bounds.min - grow, nodes[near_child].bounds.max + grow), max_t, near_t);
+        bool far_hit = intersect_aabb(O, inv_D, AABB(nodes[far_child].bounds.min - grow, nodes[far_child].bounds.max + grow), max_t, far_t);
+
+        if (near_hit && far_hit && far_t < near_t) {
+            std::swap(near_child, far_child);
+        }
+
+        // push the far child first so the near child is visited first and shrinks max_t early
+        if (far_hit && near_hit) stack[stack_size++] = far_child;
+        if (near_hit || far_hit) stack[stack_size++] = near_hit ? near_child : far_child;
+    }
+}
+
+template <typename LeafVisitor>
+bool BVH::traverse_region(const AABB& region, LeafVisitor visit_leaf) const
+{
+    ArrayView<Node> nodes = this->nodes();
+
+    if (nodes.empty() || !overlaps(nodes[0].bounds, region)) {
+        return true;
+    }
+
+    unsigned stack[MAX_DEPTH + 1];
+    unsigned stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const Node& node = nodes[stack[--stack_size]];
+
+        if (node.count > 0) {
+            if (!visit_leaf(node.first, node.count)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (overlaps(nodes[node.first].bounds, region)) stack[stack_size++] = node.first;
+        if (overlaps(nodes[node.first + 1].bounds, region)) stack[stack_size++] = node.first + 1;
+    }
+
+    return true;
+}
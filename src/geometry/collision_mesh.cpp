@@ -1,37 +1,1319 @@
+#include <algorithm>
+#include <atomic>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
+#include <limits>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 
 #include "collision_mesh.h"
+#include "triangle_simd.h"
 
-CollisionMesh::CollisionMesh(const std::string& path)
+namespace {
+    bool contains(const AABB& outer, const AABB& inner)
+    {
+        return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+               inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+    }
+
+    float distance_squared(const AABB& box, const glm::vec3& P)
+    {
+        glm::vec3 offset = glm::max(glm::max(box.min - P, P - box.max), 0.0f);
+        return glm::dot(offset, offset);
+    }
+
+    // every mesh and every update() gets a new revision, so a contact cache is never reused with another mesh's triangles
+    std::atomic<unsigned> next_revision(1);
+
+    // agents per chunk handed to a worker thread by slide_spheres()
+    const std::size_t SLIDE_BATCH_GRAIN = 64;
+
+    // distance the sphere is kept away from a surface after sliding, so the next cast starts clear of it
+    const float SLIDE_SKIN = 1.0e-3f;
+
+    // triangles slide_sphere() gathers around its path before falling back to a full query per iteration
+    const unsigned MAX_SLIDE_CANDIDATES = 64;
+
+    // sliding never travels farther than displacement, so every iteration stays within this box;
+    // margin grows it by that many more displacements for contact caches
+    AABB slide_region(const glm::vec3& C, float radius, const glm::vec3& displacement, float margin)
+    {
+        glm::vec3 reach(radius + (1.0f + margin) * glm::length(displacement) + SLIDE_SKIN * CollisionMesh::MAX_SLIDE_ITERATIONS);
+        return AABB(C - reach, C + reach);
+    }
+
+    // vertices closer than this fraction of the mesh's size are welded together
+    const float WELD_TOLERANCE = 1.0e-6f;
+
+    // welding hashes vertices into a fixed number of buckets, so the result does not depend on the thread count
+    const unsigned NUM_WELD_BUCKETS = 256;
+
+    // triangles whose height is below this fraction of their longest edge are dropped
+    const float DEGENERATE_RATIO = 1.0e-6f;
+
+    // edges bent by less than about this many radians count as flat
+    const float FLAT_EDGE_TOLERANCE = 1.0e-3f;
+
+    const std::uint8_t ALL_FEATURES = 0x3F;
+
+    struct WeldKeyHash {
+        std::size_t operator()(const glm::ivec3& key) const
+        {
+            return static_cast<std::uint32_t>(key.x) * 73856093u ^ static_cast<std::uint32_t>(key.y) * 19349663u ^ static_cast<std::uint32_t>(key.z) * 83492791u;
+        }
+    };
+
+    /**
+     * Merges the corners of triangles that snap to the same point of a fine lattice.
+     * Corners are hashed into buckets in parallel, each bucket is welded independently,
+     * and the buckets' vertices are concatenated in bucket order.
+     */
+    void weld(const std::vector<Triangle>& triangles, ThreadPool& pool, std::vector<glm::vec3>& vertices, std::vector<unsigned>& corner_vertices)
+    {
+        std::size_t num_corners = triangles.size() * 3;
+        AABB bounds;
+
+        for (const Triangle& triangle : triangles) {
+            bounds.grow(triangle.points[0]);
+            bounds.grow(triangle.points[1]);
+            bounds.grow(triangle.points[2]);
+        }
+
+        glm::vec3 extent = bounds.extent();
+        float step = WELD_TOLERANCE * glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1.0e-6f));
+        std::vector<glm::ivec3> keys(num_corners);
+        std::vector<unsigned> buckets(num_corners);
+
+        pool.parallel_for(num_corners, 4096, [&](std::size_t begin, std::size_t end) {
+            WeldKeyHash hash;
+
+            for (std::size_t c = begin; c < end; c++) {
+                keys[c] = glm::ivec3(glm::floor((triangles[c / 3].points[c % 3] - bounds.min) / step + 0.5f));
+                buckets[c] = static_cast<unsigned>((static_cast<std::uint32_t>(hash(keys[c])) * 0x9E3779B1u) >> 24) % NUM_WELD_BUCKETS;
+            }
+        });
+
+        // group the corners by bucket, keeping their original order within each bucket
+        std::vector<std::size_t> bucket_start(NUM_WELD_BUCKETS + 1, 0);
+
+        for (unsigned bucket : buckets) {
+            bucket_start[bucket + 1]++;
+        }
+
+        for (unsigned b = 0; b < NUM_WELD_BUCKETS; b++) {
+            bucket_start[b + 1] += bucket_start[b];
+        }
+
+        std::vector<std::size_t> bucket_corners(num_corners);
+        std::vector<std::size_t> next(bucket_start.begin(), bucket_start.end() - 1);
+
+        for (std::size_t c = 0; c < num_corners; c++) {
+            bucket_corners[next[buckets[c]]++] = c;
+        }
+
+        // the first corner of every welded vertex, stored from the start of its bucket's range
+        std::vector<std::size_t> representatives(num_corners);
+        std::vector<std::size_t> bucket_vertices(NUM_WELD_BUCKETS + 1, 0);
+        corner_vertices.resize(num_corners);
+
+        pool.parallel_for(NUM_WELD_BUCKETS, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                std::unordered_map<glm::ivec3, unsigned, WeldKeyHash> local;
+                local.reserve(bucket_start[b + 1] - bucket_start[b]);
+
+                for (std::size_t k = bucket_start[b]; k < bucket_start[b + 1]; k++) {
+                    std::size_t c = bucket_corners[k];
+                    auto inserted = local.insert({ keys[c], static_cast<unsigned>(local.size()) });
+
+                    if (inserted.second) {
+                        representatives[bucket_start[b] + inserted.first->second] = c;
+                    }
+
+                    corner_vertices[c] = inserted.first->second;
+                }
+
+                bucket_vertices[b + 1] = local.size();
+            }
+        });
+
+        for (unsigned b = 0; b < NUM_WELD_BUCKETS; b++) {
+            bucket_vertices[b + 1] += bucket_vertices[b];
+        }
+
+        vertices.resize(bucket_vertices[NUM_WELD_BUCKETS]);
+
+        pool.parallel_for(NUM_WELD_BUCKETS, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                std::size_t count = bucket_vertices[b + 1] - bucket_vertices[b];
+
+                for (std::size_t v = 0; v < count; v++) {
+                    std::size_t c = representatives[bucket_start[b] + v];
+                    vertices[bucket_vertices[b] + v] = triangles[c / 3].points[c % 3];
+                }
+
+                for (std::size_t k = bucket_start[b]; k < bucket_start[b + 1]; k++) {
+                    corner_vertices[bucket_corners[k]] += static_cast<unsigned>(bucket_vertices[b]);
+                }
+            }
+        });
+    }
+
+    bool degenerate(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        float double_area = glm::length(glm::cross(b - a, c - a));
+        float longest = glm::max(glm::max(glm::dot(b - a, b - a), glm::dot(c - b, c - b)), glm::dot(a - c, a - c));
+        return !(double_area > DEGENERATE_RATIO * longest);
+    }
+
+    /**
+     * Finds the first t in [0, max_t] with at^2 + bt + c = 0, where c < 0 means
+     * the sphere already overlaps the feature at t = 0.
+     */
+    bool lowest_root(float a, float b, float c, float max_t, float& root)
+    {
+        if (a < 1.0e-12f) {
+            return false;
+        }
+
+        if (c < 0.0f) {
+            root = 0.0f;
+            return b < 0.0f;
+        }
+
+        float discriminant = b * b - 4.0f * a * c;
+
+        if (discriminant < 0.0f) {
+            return false;
+        }
+
+        root = (-b - glm::sqrt(discriminant)) / (2.0f * a);
+        return root >= 0.0f && root <= max_t;
+    }
+
+    bool sweep_sphere_vertex(const glm::vec3& C, float radius, const glm::vec3& V, const glm::vec3& P, float& max_t, glm::vec3& contact)
+    {
+        glm::vec3 w = C - P;
+        float t;
+
+        if (lowest_root(glm::dot(V, V), 2.0f * glm::dot(w, V), glm::dot(w, w) - radius * radius, max_t, t)) {
+            max_t = t;
+            contact = P;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool sweep_sphere_edge(const glm::vec3& C, float radius, const glm::vec3& V, const glm::vec3& P, const glm::vec3& E, float& max_t, glm::vec3& contact)
+    {
+        glm::vec3 w = C - P;
+        float EE = glm::dot(E, E);
+        float EV = glm::dot(E, V);
+        float Ew = glm::dot(E, w);
+        float a = EE * glm::dot(V, V) - EV * EV;
+        float b = 2.0f * (EE * glm::dot(w, V) - Ew * EV);
+        float c = EE * (glm::dot(w, w) - radius * radius) - Ew * Ew;
+        float t;
+
+        if (lowest_root(a, b, c, max_t, t)) {
+            float f = (Ew + t * EV) / EE;
+
+            if (f >= 0.0f && f <= 1.0f) {
+                max_t = t;
+                contact = P + f * E;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Sweeps a sphere against the front face of triangle i, in the style of Fauerby's
+     * "Improved Collision detection and Response": the sphere first touches either the
+     * interior of the face, or failing that one of its three vertices or edges.
+     */
+    bool sweep_sphere_triangle(const TriangleSoA& triangles, std::size_t i, std::uint8_t features, const glm::vec3& C, float radius, const glm::vec3& V, float& max_t, glm::vec3& contact)
+    {
+        glm::vec3 n = triangles.normal(i);
+        float s = glm::dot(n, C) - triangles.plane_offset(i);
+        float n_dot_V = glm::dot(n, V);
+
+        if (s < 0.0f || (n_dot_V >= 0.0f && s >= radius)) {
+            return false;
+        }
+
+        glm::vec3 v0 = triangles.vertex(i);
+        glm::vec3 e1 = triangles.edge1(i);
+        glm::vec3 e2 = triangles.edge2(i);
+
+        // a sphere moving away from the plane can still run into an edge or vertex from the side,
+        // but it can only touch the interior of the face while moving towards it
+        if (n_dot_V < 0.0f) {
+            float t_plane = glm::max((radius - s) / n_dot_V, 0.0f);
+
+            if (t_plane > max_t) {
+                return false;
+            }
+
+            glm::vec3 P = C + t_plane * V - glm::min(s, radius) * n;
+            glm::vec3 w = P - v0;
+            float d00 = glm::dot(e1, e1);
+            float d01 = glm::dot(e1, e2);
+            float d11 = glm::dot(e2, e2);
+            float d20 = glm::dot(w, e1);
+            float d21 = glm::dot(w, e2);
+            float u = d11 * d20 - d01 * d21;
+            float v = d00 * d21 - d01 * d20;
+
+            if (u >= 0.0f && v >= 0.0f && u + v <= d00 * d11 - d01 * d01) {
+                max_t = t_plane;
+                contact = P;
+                return true;
+            }
+        }
+
+        // flat and concave features are never touched before the faces around them
+        glm::vec3 v1 = v0 + e1;
+        glm::vec3 v2 = v0 + e2;
+        bool hit = false;
+        if (features & 0x08) hit |= sweep_sphere_vertex(C, radius, V, v0, max_t, contact);
+        if (features & 0x10) hit |= sweep_sphere_vertex(C, radius, V, v1, max_t, contact);
+        if (features & 0x20) hit |= sweep_sphere_vertex(C, radius, V, v2, max_t, contact);
+        if (features & 0x01) hit |= sweep_sphere_edge(C, radius, V, v0, e1, max_t, contact);
+        if (features & 0x02) hit |= sweep_sphere_edge(C, radius, V, v1, v2 - v1, max_t, contact);
+        if (features & 0x04) hit |= sweep_sphere_edge(C, radius, V, v2, -e2, max_t, contact);
+        return hit;
+    }
+
+    std::vector<Triangle> import_triangles(const std::string& path)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+
+        if (!scene) {
+            throw std::runtime_error(std::string("Failed to read '") + path + "': " + importer.GetErrorString());
+        }
+
+        std::vector<Triangle> triangles;
+
+        for (unsigned i = 0; i < scene->mNumMeshes; i++) {
+            const aiMesh* mesh = scene->mMeshes[i];
+
+            for (unsigned j = 0; j < mesh->mNumFaces; j++) {
+                aiFace face = mesh->mFaces[j];
+
+                aiVector3D v0 = mesh->mVertices[face.mIndices[0]];
+                aiVector3D v1 = mesh->mVertices[face.mIndices[1]];
+                aiVector3D v2 = mesh->mVertices[face.mIndices[2]];
+
+                Triangle triangle({ v0.x, v0.y, v0.z }, { v1.x, v1.y, v1.z }, {v2.x, v2.y, v2.z });
+                triangles.push_back(triangle);
+            }
+        }
+
+        return triangles;
+    }
+
+    const char CACHE_MAGIC[8] = { 'C', 'O', 'L', 'L', 'M', 'E', 'S', 'H' };
+
+    // every section starts at a multiple of this, which covers TriangleSoA::ALIGNMENT
+    const std::uint64_t CACHE_ALIGNMENT = 64;
+
+    enum CacheSection {
+        VERTEX_SECTION,
+        INDEX_SECTION,
+        NEIGHBOUR_SECTION,
+        FEATURE_SECTION,
+        NODE_SECTION,
+        PRIMITIVE_SECTION,
+        FIRST_STREAM_SECTION, // one section per TriangleSoA stream
+        NUM_SECTIONS = FIRST_STREAM_SECTION + TriangleSoA::NUM_STREAMS
+    };
+
+    const std::uint64_t SECTION_ELEMENT_SIZES[FIRST_STREAM_SECTION] = {
+        sizeof(glm::vec3), sizeof(unsigned), sizeof(unsigned), sizeof(std::uint8_t), sizeof(BVH::Node), sizeof(unsigned)
+    };
+
+    /**
+     * The file starts with this header, followed by the sections at the recorded offsets.
+     * Everything is stored in the native byte order and refers to other data by index,
+     * so the file can be used wherever it is mapped.
+     */
+    struct CacheHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t quality;
+        std::uint64_t source_hash;
+        std::uint64_t source_size;
+        std::uint32_t node_size; // rejects files written by a build with a different layout
+        std::uint32_t lane_width;
+        std::uint64_t num_triangles;
+        float build_cost;
+        std::uint32_t reserved;
+        std::uint64_t offsets[NUM_SECTIONS]; // bytes from the start of the file
+        std::uint64_t sizes[NUM_SECTIONS];   // bytes
+    };
+
+    template <typename T>
+    ArrayView<T> cache_section(const MappedFile& file, const CacheHeader& header, unsigned section)
+    {
+        return ArrayView<T>(reinterpret_cast<const T*>(file.data() + header.offsets[section]), header.sizes[section] / sizeof(T));
+    }
+
+    std::uint64_t align_offset(std::uint64_t offset)
+    {
+        return (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    }
+
+    // whether every index in a cache stays inside the section it points into, and the nodes form a
+    // tree shallow enough for the traversal stacks, so a corrupt file cannot send a query out of bounds
+    bool cache_references_valid(ArrayView<BVH::Node> nodes, ArrayView<unsigned> primitives, ArrayView<unsigned> indices,
+                                ArrayView<unsigned> neighbours, std::size_t num_vertices)
+    {
+        std::size_t num_triangles = primitives.size();
+
+        if (num_triangles > 0 && nodes.empty()) {
+            return false;
+        }
+
+        for (unsigned i : primitives) {
+            if (i >= num_triangles) {
+                return false;
+            }
+        }
+
+        for (unsigned v : indices) {
+            if (v >= num_vertices) {
+                return false;
+            }
+        }
+
+        for (unsigned j : neighbours) {
+            if (j >= num_triangles && j != CollisionMesh::NO_NEIGHBOUR) {
+                return false;
+            }
+        }
+
+        // the builder puts children after their parent, which rules out cycles and settles every depth in one pass
+        std::vector<unsigned> depth(nodes.size(), 0);
+
+        for (std::size_t n = 0; n < nodes.size(); n++) {
+            const BVH::Node& node = nodes[n];
+
+            if (node.count > 0) {
+                if (node.first > num_triangles || node.count > num_triangles - node.first) {
+                    return false;
+                }
+            } else {
+                if (node.first <= n || node.first >= nodes.size() - 1 || depth[n] + 1 >= BVH::MAX_DEPTH) {
+                    return false;
+                }
+
+                depth[node.first] = std::max(depth[node.first], depth[n] + 1);
+                depth[node.first + 1] = std::max(depth[node.first + 1], depth[n] + 1);
+            }
+        }
+
+        return true;
+    }
+}
+
+const unsigned CollisionMesh::NO_NEIGHBOUR;
+const unsigned CollisionMesh::MAX_CACHED_TRIANGLES;
+const std::size_t CollisionMesh::MIN_PARALLEL_TRIANGLES;
+
+ContactCache::ContactCache() :
+    revision(0), valid(false), queries(0), hits(0), triangles_tested(0)
+{
+}
+
+float ContactCache::hit_rate() const
+{
+    return queries > 0 ? static_cast<float>(hits) / queries : 0.0f;
+}
+
+float ContactCache::triangles_per_query() const
+{
+    return queries > 0 ? static_cast<float>(triangles_tested) / queries : 0.0f;
+}
+
+void ContactCache::reset_stats()
+{
+    queries = 0;
+    hits = 0;
+    triangles_tested = 0;
+}
+
+ConvexCache::ConvexCache() :
+    revision(0), queries(0), triangles_tested(0), iterations(0)
+{
+}
+
+float ConvexCache::iterations_per_test() const
+{
+    return triangles_tested > 0 ? static_cast<float>(iterations) / triangles_tested : 0.0f;
+}
+
+float ConvexCache::triangles_per_query() const
+{
+    return queries > 0 ? static_cast<float>(triangles_tested) / queries : 0.0f;
+}
+
+void ConvexCache::reset_stats()
+{
+    queries = 0;
+    triangles_tested = 0;
+    iterations = 0;
+}
+
+CollisionMesh::CollisionMesh(const std::string& path, BVH::Quality quality) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    ThreadPool serial(1);
+    load(import_triangles(path), serial);
+}
+
+CollisionMesh::CollisionMesh(const std::vector<Triangle>& triangles, BVH::Quality quality) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    ThreadPool serial(1);
+    load(triangles, serial);
+}
+
+CollisionMesh::CollisionMesh(const std::string& path, BVH::Quality quality, ThreadPool& pool) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    load(import_triangles(path), pool);
+}
+
+CollisionMesh::CollisionMesh(const std::vector<Triangle>& triangles, BVH::Quality quality, ThreadPool& pool) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    load(triangles, pool);
+}
+
+CollisionMesh::CollisionMesh(const std::string& path, const std::string& cache_path, BVH::Quality quality) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    ThreadPool serial(1);
+    load_cached(path, cache_path, serial);
+}
+
+CollisionMesh::CollisionMesh(const std::string& path, const std::string& cache_path, BVH::Quality quality, ThreadPool& pool) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    load_cached(path, cache_path, pool);
+}
+
+CollisionMesh::CollisionMesh(const std::string& cache_path, std::uint64_t key_hash, std::uint64_t key_size, BVH::Quality quality) :
+    m_build_cost(0.0f), m_quality(quality), m_revision(next_revision++)
+{
+    if (!map_cache(cache_path, key_hash, key_size)) {
+        throw std::runtime_error("Failed to map '" + cache_path + "': missing, corrupt or stale");
+    }
+}
+
+bool CollisionMesh::save(const std::string& cache_path, std::uint64_t key_hash, std::uint64_t key_size) const
+{
+    return save_cache(cache_path, key_hash, key_size);
+}
+
+void CollisionMesh::load_cached(const std::string& path, const std::string& cache_path, ThreadPool& pool)
+{
+    std::uint64_t source_hash, source_size;
+
+    {
+        MappedFile source(path);
+        source_hash = source.hash();
+        source_size = source.size();
+    }
+
+    if (!map_cache(cache_path, source_hash, source_size)) {
+        load(import_triangles(path), pool);
+        save_cache(cache_path, source_hash, source_size);
+    }
+}
+
+void CollisionMesh::load(const std::vector<Triangle>& triangles, ThreadPool& pool)
+{
+    // waking other threads costs more than a small mesh takes to build
+    ThreadPool serial(1);
+    ThreadPool& builder = triangles.size() < MIN_PARALLEL_TRIANGLES ? serial : pool;
+    std::vector<unsigned> corner_vertices;
+
+    if (!triangles.empty()) {
+        weld(triangles, builder, m_vertices, corner_vertices);
+    }
+
+    std::vector<unsigned> indices;
+    indices.reserve(corner_vertices.size());
+
+    for (std::size_t i = 0; i < corner_vertices.size(); i += 3) {
+        unsigned a = corner_vertices[i], b = corner_vertices[i + 1], c = corner_vertices[i + 2];
+
+        if (a != b && b != c && c != a && !degenerate(m_vertices[a], m_vertices[b], m_vertices[c])) {
+            indices.insert(indices.end(), { a, b, c });
+        }
+    }
+
+    build(indices, builder);
+}
+
+void CollisionMesh::build(const std::vector<unsigned>& indices, ThreadPool& pool)
+{
+    std::size_t num_triangles = indices.size() / 3;
+    std::vector<AABB> triangle_bounds(num_triangles);
+
+    pool.parallel_for(num_triangles, 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            triangle_bounds[i].grow(m_vertices[indices[i * 3]]);
+            triangle_bounds[i].grow(m_vertices[indices[i * 3 + 1]]);
+            triangle_bounds[i].grow(m_vertices[indices[i * 3 + 2]]);
+        }
+    });
+
+    m_bvh = BVH(triangle_bounds, TriangleSoA::LANE_WIDTH, m_quality, pool);
+    m_build_cost = m_bvh.sah_cost();
+
+    // store triangles in leaf order so every leaf covers a contiguous range
+    m_triangles = TriangleSoA();
+    m_triangles.reserve(num_triangles);
+    m_indices.clear();
+    m_indices.reserve(indices.size());
+
+    for (unsigned index : m_bvh.primitives()) {
+        const unsigned* corners = &indices[index * 3];
+        m_indices.insert(m_indices.end(), corners, corners + 3);
+        m_triangles.push_back(Triangle(m_vertices[corners[0]], m_vertices[corners[1]], m_vertices[corners[2]]));
+    }
+
+    find_neighbours();
+    classify_features();
+}
+
+void CollisionMesh::find_neighbours()
+{
+    // sort the edges by their vertices so that the two sides of every edge end up next to each other
+    std::vector<std::pair<std::uint64_t, unsigned>> edges(m_indices.size());
+
+    for (std::size_t e = 0; e < m_indices.size(); e++) {
+        std::uint64_t a = m_indices[e];
+        std::uint64_t b = m_indices[e % 3 == 2 ? e - 2 : e + 1];
+        edges[e] = { std::min(a, b) << 32 | std::max(a, b), static_cast<unsigned>(e) };
+    }
+
+    std::sort(edges.begin(), edges.end());
+    m_neighbours.assign(m_indices.size(), NO_NEIGHBOUR);
+
+    for (std::size_t first = 0; first < edges.size();) {
+        std::size_t last = first + 1;
+
+        while (last < edges.size() && edges[last].first == edges[first].first) {
+            last++;
+        }
+
+        if (last - first == 2) {
+            m_neighbours[edges[first].second] = edges[first + 1].second / 3;
+            m_neighbours[edges[first + 1].second] = edges[first].second / 3;
+        }
+
+        first = last;
+    }
+}
+
+void CollisionMesh::classify_features()
+{
+    std::size_t num_triangles = m_indices.size() / 3;
+    std::vector<std::uint8_t> sharp_vertices(m_vertices.size(), 0);
+    m_features.assign(num_triangles, 0);
+
+    for (std::size_t i = 0; i < num_triangles; i++) {
+        const unsigned* corners = &m_indices[i * 3];
+        glm::vec3 n = m_triangles.normal(i);
+
+        for (unsigned k = 0; k < 3; k++) {
+            unsigned a = corners[k];
+            unsigned b = corners[(k + 1) % 3];
+            unsigned j = m_neighbours[i * 3 + k];
+            bool sharp = true;
+
+            if (j != NO_NEIGHBOUR) {
+                const unsigned* other = &m_indices[j * 3];
+                unsigned k_other = other[0] == b ? 0 : (other[1] == b ? 1 : 2);
+
+                // a neighbour wound the other way along the edge faces the opposite side, so its edge stays sharp
+                if (other[(k_other + 1) % 3] == a) {
+                    glm::vec3 apex = m_vertices[other[(k_other + 2) % 3]];
+                    glm::vec3 offset = apex - m_vertices[a];
+                    sharp = glm::dot(n, offset) < -FLAT_EDGE_TOLERANCE * glm::length(offset);
+                }
+            }
+
+            if (sharp) {
+                m_features[i] |= 1 << k;
+                sharp_vertices[a] = 1;
+                sharp_vertices[b] = 1;
+            }
+        }
+    }
+
+    // a vertex can only be touched before its faces if one of the edges around it is sharp
+    for (std::size_t i = 0; i < num_triangles; i++) {
+        for (unsigned k = 0; k < 3; k++) {
+            if (sharp_vertices[m_indices[i * 3 + k]]) {
+                m_features[i] |= 1 << (3 + k);
+            }
+        }
+    }
+}
+
+bool CollisionMesh::map_cache(const std::string& cache_path, std::uint64_t source_hash, std::uint64_t source_size)
+{
+    std::unique_ptr<MappedFile> file;
+
+    try {
+        file.reset(new MappedFile(cache_path));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    CacheHeader header;
+
+    if (file->size() < sizeof(header)) {
+        return false;
+    }
+
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.quality != static_cast<std::uint32_t>(m_quality) || header.source_hash != source_hash || header.source_size != source_size ||
+        header.node_size != sizeof(BVH::Node) || header.lane_width != TriangleSoA::LANE_WIDTH) {
+        return false;
+    }
+
+    std::uint64_t num_triangles = header.num_triangles;
+    std::uint64_t stream_size = header.sizes[FIRST_STREAM_SECTION];
+
+    for (unsigned s = 0; s < NUM_SECTIONS; s++) {
+        std::uint64_t element_size = s < FIRST_STREAM_SECTION ? SECTION_ELEMENT_SIZES[s] : sizeof(float);
+
+        if (header.offsets[s] % CACHE_ALIGNMENT != 0 || header.offsets[s] > file->size() || header.sizes[s] > file->size() - header.offsets[s] ||
+            header.sizes[s] % element_size != 0 || (s >= FIRST_STREAM_SECTION && header.sizes[s] != stream_size)) {
+            return false;
+        }
+    }
+
+    // the sections must agree on the number of triangles, and the streams must carry their padding
+    std::uint64_t padded_size = stream_size / sizeof(float);
+
+    if (header.sizes[INDEX_SECTION] != 3 * num_triangles * sizeof(unsigned) || header.sizes[NEIGHBOUR_SECTION] != header.sizes[INDEX_SECTION] ||
+        header.sizes[FEATURE_SECTION] != num_triangles || header.sizes[PRIMITIVE_SECTION] != num_triangles * sizeof(unsigned) ||
+        padded_size % TriangleSoA::LANE_WIDTH != 0 || (num_triangles > 0 && padded_size < num_triangles + TriangleSoA::LANE_WIDTH - 1)) {
+        return false;
+    }
+
+    if (!cache_references_valid(cache_section<BVH::Node>(*file, header, NODE_SECTION), cache_section<unsigned>(*file, header, PRIMITIVE_SECTION),
+                                cache_section<unsigned>(*file, header, INDEX_SECTION), cache_section<unsigned>(*file, header, NEIGHBOUR_SECTION),
+                                cache_section<glm::vec3>(*file, header, VERTEX_SECTION).size())) {
+        return false;
+    }
+
+    TriangleSoA::StreamPointers streams;
+
+    for (unsigned s = 0; s < TriangleSoA::NUM_STREAMS; s++) {
+        streams[s] = cache_section<float>(*file, header, FIRST_STREAM_SECTION + s).data();
+    }
+
+    m_triangles = TriangleSoA(streams, static_cast<std::size_t>(num_triangles), static_cast<std::size_t>(padded_size));
+    m_bvh = BVH(cache_section<BVH::Node>(*file, header, NODE_SECTION), cache_section<unsigned>(*file, header, PRIMITIVE_SECTION));
+    m_build_cost = header.build_cost;
+    m_cached_vertices = cache_section<glm::vec3>(*file, header, VERTEX_SECTION);
+    m_cached_indices = cache_section<unsigned>(*file, header, INDEX_SECTION);
+    m_cached_neighbours = cache_section<unsigned>(*file, header, NEIGHBOUR_SECTION);
+    m_cached_features = cache_section<std::uint8_t>(*file, header, FEATURE_SECTION);
+    m_cache = std::move(file);
+    return true;
+}
+
+bool CollisionMesh::save_cache(const std::string& cache_path, std::uint64_t source_hash, std::uint64_t source_size) const
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.quality = static_cast<std::uint32_t>(m_quality);
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.node_size = sizeof(BVH::Node);
+    header.lane_width = TriangleSoA::LANE_WIDTH;
+    header.num_triangles = m_triangles.size();
+    header.build_cost = m_build_cost;
+
+    const void* sections[NUM_SECTIONS] = {
+        vertices().data(), indices().data(), neighbours().data(), features().data(), m_bvh.nodes().data(), m_bvh.primitives().data()
+    };
+
+    header.sizes[VERTEX_SECTION] = vertices().size() * sizeof(glm::vec3);
+    header.sizes[INDEX_SECTION] = indices().size() * sizeof(unsigned);
+    header.sizes[NEIGHBOUR_SECTION] = neighbours().size() * sizeof(unsigned);
+    header.sizes[FEATURE_SECTION] = features().size();
+    header.sizes[NODE_SECTION] = m_bvh.nodes().size() * sizeof(BVH::Node);
+    header.sizes[PRIMITIVE_SECTION] = m_bvh.primitives().size() * sizeof(unsigned);
+
+    for (unsigned s = 0; s < TriangleSoA::NUM_STREAMS; s++) {
+        sections[FIRST_STREAM_SECTION + s] = m_triangles.stream(static_cast<TriangleSoA::Stream>(s));
+        header.sizes[FIRST_STREAM_SECTION + s] = m_triangles.padded_size() * sizeof(float);
+    }
+
+    std::uint64_t offset = sizeof(header);
 
-    if (!scene) {
-        throw std::runtime_error(std::string("Failed to read '") + path + "': " + importer.GetErrorString());
+    for (unsigned s = 0; s < NUM_SECTIONS; s++) {
+        header.offsets[s] = offset = align_offset(offset);
+        offset += header.sizes[s];
     }
 
-    for (unsigned i = 0; i < scene->mNumMeshes; i++) {
-        const aiMesh* mesh = scene->mMeshes[i];
+    // write next to the cache and rename it into place, so a half-written file is never mapped
+    std::string temporary_path = cache_path + ".tmp";
 
-        for (unsigned j = 0; j < mesh->mNumFaces; j++) {
-            aiFace face = mesh->mFaces[j];
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        const char padding[CACHE_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        offset = sizeof(header);
 
-            aiVector3D v0 = mesh->mVertices[face.mIndices[0]];
-            aiVector3D v1 = mesh->mVertices[face.mIndices[1]];
-            aiVector3D v2 = mesh->mVertices[face.mIndices[2]];
+        for (unsigned s = 0; s < NUM_SECTIONS; s++) {
+            file.write(padding, static_cast<std::streamsize>(header.offsets[s] - offset));
+            file.write(static_cast<const char*>(sections[s]), static_cast<std::streamsize>(header.sizes[s]));
+            offset = header.offsets[s] + header.sizes[s];
+        }
 
-            Triangle triangle({ v0.x, v0.y, v0.z }, { v1.x, v1.y, v1.z }, {v2.x, v2.y, v2.z });
-            m_triangles.push_back(triangle);
+        if (!file) {
+            file.close();
+            std::remove(temporary_path.c_str());
+            return false;
         }
     }
+
+    if (!replace_file(temporary_path, cache_path)) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+
+    return true;
 }
 
-const std::vector<Triangle>& CollisionMesh::triangles() const
+const TriangleSoA& CollisionMesh::triangles() const
 {
     return m_triangles;
-}
\ No newline at end of file
+}
+
+const BVH& CollisionMesh::bvh() const
+{
+    return m_bvh;
+}
+
+bool CollisionMesh::is_cached() const
+{
+    return m_cache != nullptr;
+}
+
+ArrayView<glm::vec3> CollisionMesh::vertices() const
+{
+    return m_cache ? m_cached_vertices : ArrayView<glm::vec3>(m_vertices);
+}
+
+ArrayView<unsigned> CollisionMesh::indices() const
+{
+    return m_cache ? m_cached_indices : ArrayView<unsigned>(m_indices);
+}
+
+ArrayView<unsigned> CollisionMesh::neighbours() const
+{
+    return m_cache ? m_cached_neighbours : ArrayView<unsigned>(m_neighbours);
+}
+
+ArrayView<std::uint8_t> CollisionMesh::features() const
+{
+    return m_cache ? m_cached_features : ArrayView<std::uint8_t>(m_features);
+}
+
+std::size_t CollisionMesh::memory_usage() const
+{
+    return m_triangles.memory_usage() + m_bvh.nodes().size() * sizeof(BVH::Node) +
+        (indices().size() + neighbours().size()) * sizeof(unsigned) + features().size() + vertices().size() * sizeof(glm::vec3);
+}
+
+bool CollisionMesh::raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const
+{
+    if (D == glm::vec3(0.0f)) {
+        return false;
+    }
+
+    bool found = false;
+
+    m_bvh.traverse_ray(O, D, max_t, 0.0f, [&](unsigned first, unsigned count, float& closest_t) {
+        if (closest_hit(m_triangles, first, count, O, D, closest_t, hit.triangle)) {
+            hit.t = closest_t;
+            found = true;
+        }
+    });
+
+    if (found) {
+        hit.point = O + hit.t * D;
+        hit.normal = m_triangles.normal(hit.triangle);
+    }
+
+    return found;
+}
+
+bool CollisionMesh::segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const
+{
+    return raycast(P, displacement, 1.0f, hit);
+}
+
+bool CollisionMesh::pick(const Ray& ray, RaycastHit& hit) const
+{
+    return raycast(ray.origin, ray.direction, std::numeric_limits<float>::max(), hit);
+}
+
+bool CollisionMesh::sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, RaycastHit& hit) const
+{
+    std::uint64_t tested = 0;
+    return sphere_cast(C, radius, displacement, hit, tested);
+}
+
+bool CollisionMesh::sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, RaycastHit& hit, std::uint64_t& tested) const
+{
+    ArrayView<std::uint8_t> features = this->features();
+
+    if (displacement == glm::vec3(0.0f)) {
+        return false;
+    }
+
+    // a sphere touches a node exactly when its center ray hits the node grown by the radius
+    float max_t = 1.0f;
+    bool found = false;
+
+    m_bvh.traverse_ray(C, displacement, max_t, radius, [&](unsigned first, unsigned count, float& closest_t) {
+        tested += count;
+
+        for (unsigned i = first; i < first + count; i++) {
+            if (sweep_sphere_triangle(m_triangles, i, features[i], C, radius, displacement, closest_t, hit.point)) {
+                hit.triangle = i;
+                found = true;
+            }
+        }
+    });
+
+    if (found) {
+        hit.t = max_t;
+        glm::vec3 offset = C + max_t * displacement - hit.point;
+        float distance = glm::length(offset);
+        hit.normal = distance > 0.0f ? offset / distance : m_triangles.normal(hit.triangle);
+    }
+
+    return found;
+}
+
+bool CollisionMesh::closest_point(const glm::vec3& P, float radius, ClosestPoint& result) const
+{
+    ArrayView<BVH::Node> nodes = m_bvh.nodes();
+    float max_distance_squared = radius * radius;
+
+    if (nodes.empty() || distance_squared(nodes[0].bounds, P) > max_distance_squared) {
+        return false;
+    }
+
+    bool found = false;
+    unsigned stack[BVH::MAX_DEPTH + 1];
+    unsigned stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BVH::Node& node = nodes[stack[--stack_size]];
+
+        // the search radius may have shrunk since this node was pushed
+        if (distance_squared(node.bounds, P) > max_distance_squared) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (unsigned i = node.first; i < node.first + node.count; i++) {
+                glm::vec3 v0 = m_triangles.vertex(i);
+                glm::vec3 Q = closest_point_on_triangle(P, v0, v0 + m_triangles.edge1(i), v0 + m_triangles.edge2(i));
+                float d = glm::dot(Q - P, Q - P);
+
+                if (d <= max_distance_squared) {
+                    max_distance_squared = d;
+                    result.triangle = i;
+                    result.point = Q;
+                    found = true;
+                }
+            }
+
+            continue;
+        }
+
+        unsigned near_child = node.first;
+        unsigned far_child = node.first + 1;
+        float near_d = distance_squared(nodes[near_child].bounds, P);
+        float far_d = distance_squared(nodes[far_child].bounds, P);
+
+        if (far_d < near_d) {
+            std::swap(near_child, far_child);
+            std::swap(near_d, far_d);
+        }
+
+        if (far_d <= max_distance_squared) stack[stack_size++] = far_child;
+        if (near_d <= max_distance_squared) stack[stack_size++] = near_child;
+    }
+
+    if (found) {
+        result.distance = glm::sqrt(max_distance_squared);
+    }
+
+    return found;
+}
+
+bool CollisionMesh::within_distance(const glm::vec3& P, float distance) const
+{
+    ArrayView<BVH::Node> nodes = m_bvh.nodes();
+    float max_distance_squared = distance * distance;
+
+    if (nodes.empty() || distance_squared(nodes[0].bounds, P) > max_distance_squared) {
+        return false;
+    }
+
+    unsigned stack[BVH::MAX_DEPTH + 1];
+    unsigned stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BVH::Node& node = nodes[stack[--stack_size]];
+
+        if (node.count > 0) {
+            for (unsigned i = node.first; i < node.first + node.count; i++) {
+                glm::vec3 v0 = m_triangles.vertex(i);
+                glm::vec3 Q = closest_point_on_triangle(P, v0, v0 + m_triangles.edge1(i), v0 + m_triangles.edge2(i));
+
+                if (glm::dot(Q - P, Q - P) <= max_distance_squared) {
+                    return true;
+                }
+            }
+
+            continue;
+        }
+
+        if (distance_squared(nodes[node.first].bounds, P) <= max_distance_squared) stack[stack_size++] = node.first;
+        if (distance_squared(nodes[node.first + 1].bounds, P) <= max_distance_squared) stack[stack_size++] = node.first + 1;
+    }
+
+    return false;
+}
+
+glm::vec3 CollisionMesh::slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement) const
+{
+    // the triangles the sphere can touch only need to be looked up once
+    unsigned candidates[MAX_SLIDE_CANDIDATES];
+    unsigned count = gather_triangles(slide_region(C, radius, displacement, 0.0f), candidates, MAX_SLIDE_CANDIDATES);
+    std::uint64_t tested = 0;
+
+    if (count > MAX_SLIDE_CANDIDATES) {
+        return slide_sphere(C, radius, displacement, nullptr, 0, tested);
+    }
+
+    return slide_sphere(C, radius, displacement, candidates, count, tested);
+}
+
+glm::vec3 CollisionMesh::slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement, ContactCache& cache) const
+{
+    AABB reach = slide_region(C, radius, displacement, 0.0f);
+    cache.queries++;
+
+    if (cache.valid && cache.revision == m_revision && contains(cache.region, reach)) {
+        cache.hits++;
+    } else {
+        AABB region = slide_region(C, radius, displacement, CONTACT_CACHE_MARGIN);
+
+        // too crowded for a margin, so only cache what this call needs, and if even that does not fit, nothing
+        if (!gather_cached(region, cache.triangles)) {
+            region = reach;
+
+            if (!gather_cached(region, cache.triangles)) {
+                cache.valid = false;
+                return slide_sphere(C, radius, displacement, nullptr, 0, cache.triangles_tested);
+            }
+        }
+
+        cache.region = region;
+        cache.revision = m_revision;
+        cache.valid = true;
+    }
+
+    return slide_sphere(C, radius, displacement, cache.triangles.data(), static_cast<unsigned>(cache.triangles.size()), cache.triangles_tested);
+}
+
+bool CollisionMesh::convex_contacts(const ConvexHull& hull, const glm::quat& orientation, const glm::vec3& position, ConvexCache& cache, std::vector<ConvexContact>& contacts) const
+{
+    contacts.clear();
+    cache.queries++;
+
+    // triangle indices change when update() rebuilds the hierarchy
+    if (cache.revision != m_revision) {
+        cache.simplices.clear();
+        cache.revision = m_revision;
+    }
+
+    glm::vec3 center = orientation * hull.center() + position;
+    AABB region(center - hull.radius(), center + hull.radius());
+
+    auto test = [&](unsigned i, GjkSimplex& simplex) {
+        glm::vec3 a = m_triangles.vertex(i);
+        glm::vec3 b = a + m_triangles.edge1(i);
+        glm::vec3 c = a + m_triangles.edge2(i);
+        glm::vec3 offset = closest_point_on_triangle(center, a, b, c) - center;
+
+        // the hull's bounding sphere is a much cheaper first test than GJK
+        if (glm::dot(offset, offset) > hull.radius() * hull.radius()) {
+            return false;
+        }
+
+        ConvexContact contact;
+        unsigned iterations = 0;
+        cache.triangles_tested++;
+
+        if (convex_triangle_contact(hull, orientation, position, a, b, c, simplex, contact, iterations) &&
+            glm::dot(contact.normal, m_triangles.normal(i)) > 0.0f) {
+            contact.triangle = i;
+            contacts.push_back(contact);
+        }
+
+        cache.iterations += iterations;
+        return true;
+    };
+
+    // more triangles than a cache holds are tested cold, straight from the hierarchy
+    if (!gather_cached(region, cache.triangles)) {
+        cache.simplices.clear();
+
+        m_bvh.traverse_region(region, [&](unsigned first, unsigned count) {
+            for (unsigned i = first; i < first + count; i++) {
+                GjkSimplex simplex;
+                test(i, simplex);
+            }
+
+            return true;
+        });
+
+        return !contacts.empty();
+    }
+
+    std::sort(cache.triangles.begin(), cache.triangles.end());
+    cache.next.clear();
+
+    // both lists are sorted by triangle, so one pass pairs every triangle with its last simplex
+    std::size_t previous = 0;
+
+    for (unsigned i : cache.triangles) {
+        while (previous < cache.simplices.size() && cache.simplices[previous].first < i) {
+            previous++;
+        }
+
+        GjkSimplex simplex;
+
+        if (previous < cache.simplices.size() && cache.simplices[previous].first == i) {
+            simplex = cache.simplices[previous].second;
+        }
+
+        if (test(i, simplex)) {
+            cache.next.push_back({ i, simplex });
+        }
+    }
+
+    cache.simplices.swap(cache.next);
+    return !contacts.empty();
+}
+
+void CollisionMesh::slide_spheres(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& displacements, float radius, std::vector<glm::vec3>& results, ThreadPool& pool) const
+{
+    if (positions.size() != displacements.size()) {
+        throw std::invalid_argument("slide_spheres: positions and displacements differ in size");
+    }
+
+    results.resize(positions.size());
+
+    pool.parallel_for(positions.size(), SLIDE_BATCH_GRAIN, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            results[i] = slide_sphere(positions[i], radius, displacements[i]);
+        }
+    });
+}
+
+void CollisionMesh::slide_spheres(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& displacements, float radius, std::vector<ContactCache>& caches, std::vector<glm::vec3>& results, ThreadPool& pool) const
+{
+    if (positions.size() != displacements.size()) {
+        throw std::invalid_argument("slide_spheres: positions and displacements differ in size");
+    }
+
+    caches.resize(positions.size());
+    results.resize(positions.size());
+
+    pool.parallel_for(positions.size(), SLIDE_BATCH_GRAIN, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            results[i] = slide_sphere(positions[i], radius, displacements[i], caches[i]);
+        }
+    });
+}
+
+glm::vec3 CollisionMesh::slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement, const unsigned* candidates, unsigned count, std::uint64_t& tested) const
+{
+    glm::vec3 position = C;
+    glm::vec3 remaining = displacement;
+    glm::vec3 last_normal(0.0f);
+
+    for (unsigned iteration = 0; iteration < MAX_SLIDE_ITERATIONS; iteration++) {
+        RaycastHit hit;
+        bool touched;
+
+        if (candidates) {
+            touched = sphere_cast(position, radius, remaining, candidates, count, hit);
+            tested += count;
+        } else {
+            touched = sphere_cast(position, radius, remaining, hit, tested);
+        }
+
+        if (!touched) {
+            return position + remaining;
+        }
+
+        position += remaining * hit.t + hit.normal * SLIDE_SKIN;
+        remaining *= 1.0f - hit.t;
+        remaining -= hit.normal * glm::dot(remaining, hit.normal);
+
+        // sliding off this surface would push back into the previous one, so follow the crease between them
+        if (iteration > 0 && glm::dot(remaining, last_normal) < 0.0f) {
+            glm::vec3 crease = glm::cross(last_normal, hit.normal);
+            float length = glm::length(crease);
+            remaining = length > 1.0e-6f ? crease * (glm::dot(remaining, crease) / (length * length)) : glm::vec3(0.0f);
+        }
+
+        last_normal = hit.normal;
+    }
+
+    return position;
+}
+
+unsigned CollisionMesh::gather_triangles(const AABB& region, unsigned* triangles, unsigned capacity) const
+{
+    unsigned count = 0;
+
+    bool complete = m_bvh.traverse_region(region, [&](unsigned first, unsigned leaf_count) {
+        for (unsigned i = first; i < first + leaf_count; i++) {
+            AABB bounds;
+            bounds.grow(m_triangles.vertex(i));
+            bounds.grow(m_triangles.vertex(i) + m_triangles.edge1(i));
+            bounds.grow(m_triangles.vertex(i) + m_triangles.edge2(i));
+
+            if (overlaps(bounds, region)) {
+                if (count == capacity) {
+                    return false;
+                }
+
+                triangles[count++] = i;
+            }
+        }
+
+        return true;
+    });
+
+    return complete ? count : capacity + 1;
+}
+
+bool CollisionMesh::gather_cached(const AABB& region, std::vector<unsigned>& triangles) const
+{
+    triangles.resize(MAX_CACHED_TRIANGLES);
+    unsigned count = gather_triangles(region, triangles.data(), MAX_CACHED_TRIANGLES);
+    triangles.resize(count > MAX_CACHED_TRIANGLES ? 0 : count);
+    return count <= MAX_CACHED_TRIANGLES;
+}
+
+bool CollisionMesh::sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, const unsigned* candidates, unsigned count, RaycastHit& hit) const
+{
+    ArrayView<std::uint8_t> features = this->features();
+    float max_t = 1.0f;
+    bool found = false;
+
+    for (unsigned k = 0; k < count; k++) {
+        if (sweep_sphere_triangle(m_triangles, candidates[k], features[candidates[k]], C, radius, displacement, max_t, hit.point)) {
+            hit.triangle = candidates[k];
+            found = true;
+        }
+    }
+
+    if (found) {
+        hit.t = max_t;
+        glm::vec3 offset = C + max_t * displacement - hit.point;
+        float distance = glm::length(offset);
+        hit.normal = distance > 0.0f ? offset / distance : m_triangles.normal(hit.triangle);
+    }
+
+    return found;
+}
+
+bool CollisionMesh::update(const std::vector<glm::vec3>& vertices)
+{
+    ThreadPool serial(1);
+    return update(vertices, serial);
+}
+
+bool CollisionMesh::update(const std::vector<glm::vec3>& vertices, ThreadPool& pool)
+{
+    if (vertices.size() != this->vertices().size()) {
+        throw std::invalid_argument("CollisionMesh::update: expected one position per vertex");
+    }
+
+    if (m_cache) {
+        m_indices.assign(m_cached_indices.begin(), m_cached_indices.end());
+        m_neighbours.assign(m_cached_neighbours.begin(), m_cached_neighbours.end());
+        m_features.assign(m_cached_features.begin(), m_cached_features.end());
+    }
+
+    m_vertices = vertices;
+    m_revision = next_revision++;
+
+    float cost = m_bvh.refit([&](unsigned first, unsigned count) {
+        AABB bounds;
+
+        for (unsigned i = first; i < first + count; i++) {
+            const unsigned* corners = &m_indices[i * 3];
+            Triangle triangle(m_vertices[corners[0]], m_vertices[corners[1]], m_vertices[corners[2]]);
+            m_triangles.set(i, triangle);
+            bounds.grow(triangle.points[0]);
+            bounds.grow(triangle.points[1]);
+            bounds.grow(triangle.points[2]);
+        }
+
+        return bounds;
+    });
+
+    // refitting copied the triangles and the hierarchy out of the cache, so nothing refers to it anymore
+    m_cache.reset();
+
+    if (cost <= REBUILD_THRESHOLD * m_build_cost) {
+        classify_features();
+        return false;
+    }
+
+    std::vector<unsigned> indices = m_indices;
+    ThreadPool serial(1);
+    build(indices, m_triangles.size() < MIN_PARALLEL_TRIANGLES ? serial : pool);
+    return true;
+}
@@ -1,17 +1,360 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../utility/array_view.h"
+#include "../utility/mapped_file.h"
+#include "../utility/thread_pool.h"
+#include "bvh.h"
+#include "convex_hull.h"
 #include "geometry.h"
+#include "gjk.h"
+#include "triangle_soa.h"
 
+struct RaycastHit {
+    unsigned triangle; // index into CollisionMesh::triangles()
+    float t;
+    glm::vec3 point;
+    glm::vec3 normal;
+};
+
+struct ClosestPoint {
+    unsigned triangle; // index into CollisionMesh::triangles()
+    float distance;
+    glm::vec3 point;
+};
+
+/**
+ * @brief The triangles around one agent, kept between frames so slide_sphere() can skip the hierarchy.
+ *
+ * While the agent's path stays inside region, queries only test the cached triangles and
+ * skip the hierarchy. Once it leaves, the triangles are gathered again. Querying another
+ * CollisionMesh, or the same one after CollisionMesh::update(), invalidates it.
+ */
+struct ContactCache {
+    ContactCache();
+
+    float hit_rate() const;
+    float triangles_per_query() const;
+    void reset_stats();
+
+    AABB region; // every triangle overlapping this box is in triangles
+    unsigned revision; // the mesh's revision when the triangles were gathered
+    bool valid;
+    std::vector<unsigned> triangles;
+
+    std::uint64_t queries;
+    std::uint64_t hits;
+    std::uint64_t triangles_tested;
+};
+
+/**
+ * @brief The GJK simplices one convex body ended with against each nearby triangle, for warm-starting its next query.
+ *
+ * A cache belongs to a single body and CollisionMesh. CollisionMesh::update() invalidates it.
+ */
+struct ConvexCache {
+    ConvexCache();
+
+    float iterations_per_test() const;
+    float triangles_per_query() const;
+    void reset_stats();
+
+    unsigned revision; // the mesh's revision when the simplices were stored
+    std::vector<std::pair<unsigned, GjkSimplex>> simplices; // sorted by triangle
+    std::vector<std::pair<unsigned, GjkSimplex>> next; // scratch, swapped with simplices after a query
+    std::vector<unsigned> triangles; // scratch for the gathered triangles
+
+    std::uint64_t queries;
+    std::uint64_t triangles_tested;
+    std::uint64_t iterations;
+};
+
+/**
+ * @brief An indexed triangle mesh with a bounding volume hierarchy for collision queries.
+ *
+ * On construction, coincident vertices are welded and zero-area or sliver triangles are
+ * dropped. Edge adjacency then marks which edges and vertices can be touched before the
+ * faces around them: edges between coplanar or concave neighbours are skipped by sphere
+ * sweeps, which also keeps spheres from catching on the seams of flat ground.
+ *
+ * All of that can be saved to a cache file, which later runs map and query in place.
+ */
 class CollisionMesh {
 public:
-    CollisionMesh(const std::string& path);
+    /**
+     * @brief Builds the mesh on the calling thread.
+     *
+     * @param quality Trades the time to build the hierarchy against query speed.
+     * update() rebuilds with the same quality.
+     */
+    CollisionMesh(const std::string& path, BVH::Quality quality = BVH::BEST);
+    CollisionMesh(const std::vector<Triangle>& triangles, BVH::Quality quality = BVH::BEST);
+
+    /**
+     * @brief Builds the mesh on the threads of pool, or on the calling thread alone if it is too small to be worth splitting.
+     */
+    CollisionMesh(const std::string& path, BVH::Quality quality, ThreadPool& pool);
+    CollisionMesh(const std::vector<Triangle>& triangles, BVH::Quality quality, ThreadPool& pool);
+
+    /**
+     * @brief Maps cache_path if it was saved from the current contents of path with the same quality, or loads path and saves it there.
+     *
+     * The cache is keyed by a hash of path's contents, so editing the source invalidates it,
+     * as does a cache written by a different CACHE_VERSION. A mapped mesh queries the file's
+     * pages in place, with no parsing or building. If cache_path cannot be written, the mesh
+     * still loads; it is just built again next time.
+     */
+    CollisionMesh(const std::string& path, const std::string& cache_path, BVH::Quality quality = BVH::BEST);
+    CollisionMesh(const std::string& path, const std::string& cache_path, BVH::Quality quality, ThreadPool& pool);
+
+    /**
+     * @brief Maps a cache written by save() with the same key and quality, for meshes that have no source file of their own.
+     *
+     * @throws std::runtime_error If cache_path is missing, corrupt, or was saved with another key.
+     */
+    CollisionMesh(const std::string& cache_path, std::uint64_t key_hash, std::uint64_t key_size, BVH::Quality quality = BVH::BEST);
+
+    /**
+     * @brief Saves the mesh in the cache format, keyed by key_hash and key_size instead of a source file's hash and size.
+     *
+     * @return Whether the file was written.
+     */
+    bool save(const std::string& cache_path, std::uint64_t key_hash, std::uint64_t key_size) const;
+
+    const TriangleSoA& triangles() const;
+    const BVH& bvh() const;
+
+    /**
+     * @brief Whether the mesh refers to a mapped cache file rather than data it built itself.
+     *
+     * update() copies everything out of the file first, so it no longer is afterwards.
+     */
+    bool is_cached() const;
+
+    /**
+     * @brief The welded vertices. update() takes new positions in the same order.
+     */
+    ArrayView<glm::vec3> vertices() const;
+
+    /**
+     * @brief Three indices into vertices() per triangle, in triangles() order.
+     */
+    ArrayView<unsigned> indices() const;
+
+    /**
+     * @brief Three entries per triangle: the triangles across its edges v0v1, v1v2 and v2v0.
+     *
+     * Boundary edges and edges shared by more than two triangles have NO_NEIGHBOUR.
+     */
+    ArrayView<unsigned> neighbours() const;
 
-    const std::vector<Triangle>& triangles() const;
+    /**
+     * @brief The number of bytes used by the triangle streams, the hierarchy, and the indexed mesh.
+     *
+     * This is TriangleSoA::BYTES_PER_TRIANGLE per (padded) triangle, sizeof(BVH::Node) per node,
+     * 25 bytes per triangle for indices, neighbours and feature flags, and 12 bytes per vertex.
+     */
+    std::size_t memory_usage() const;
+
+    /**
+     * @brief Finds the closest front-facing triangle hit by the ray O + tD with 0 <= t <= max_t.
+     *
+     * @param O The origin of the ray.
+     * @param D The direction of the ray. It does not need to be normalized; t is measured in multiples of D.
+     * @param max_t The largest parameter value that counts as a hit.
+     * @param hit Receives the closest hit, if any.
+     * @return Whether the ray hit any triangle.
+     */
+    bool raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const;
+
+    /**
+     * @brief Finds the closest front-facing triangle hit by the segment from P to P + displacement.
+     *
+     * Equivalent to raycast(P, displacement, 1.0f, hit).
+     */
+    bool segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const;
+
+    /**
+     * @brief Finds the closest front-facing triangle along ray, at any distance.
+     *
+     * Meant for picking with Camera::screen_ray(). Walks the hierarchy like raycast(),
+     * so its cost grows with the depth of the tree rather than the number of triangles.
+     *
+     * @param hit Receives the closest hit, with t measured in world units along the ray.
+     */
+    bool pick(const Ray& ray, RaycastHit& hit) const;
+
+    /**
+     * @brief Sweeps a sphere from C to C + displacement and finds its first contact with a front-facing triangle.
+     *
+     * A sphere that already overlaps a triangle only collides with it while moving further in.
+     *
+     * @param hit Receives the time of impact as a fraction of displacement, the contact point on
+     * the triangle, and the contact normal pointing from the contact point towards the sphere.
+     * @return Whether the sphere touched any triangle.
+     */
+    bool sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, RaycastHit& hit) const;
+
+    /**
+     * @brief Finds the point on the mesh closest to P, if it lies within radius of P.
+     *
+     * Both sides of every triangle count. Nodes farther than the closest point found so far
+     * are skipped, so a small radius only touches the triangles near P.
+     *
+     * @return Whether any triangle lies within radius of P.
+     */
+    bool closest_point(const glm::vec3& P, float radius, ClosestPoint& result) const;
+
+    /**
+     * @brief Whether any triangle lies within distance of P.
+     *
+     * Cheaper than closest_point(), since it stops at the first such triangle.
+     */
+    bool within_distance(const glm::vec3& P, float distance) const;
+
+    /**
+     * @brief Moves a sphere by displacement, sliding along every surface it touches.
+     *
+     * Performs at most MAX_SLIDE_ITERATIONS sphere casts, so the cost per call is bounded.
+     * The triangles near the sphere's path are gathered once and shared by all the casts.
+     * Any displacement left after the last iteration is discarded.
+     *
+     * @return The new center of the sphere.
+     */
+    glm::vec3 slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement) const;
+
+    /**
+     * @brief Like slide_sphere(), but reuses the triangles cached on the agent's earlier calls.
+     *
+     * The cached region reaches CONTACT_CACHE_MARGIN displacements past the sphere's path, so an
+     * agent moving steadily refreshes its cache every few frames. Where even the path alone overlaps
+     * more than MAX_CACHED_TRIANGLES, the call walks the hierarchy and leaves the cache invalid.
+     * The result matches slide_sphere().
+     */
+    glm::vec3 slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement, ContactCache& cache) const;
+
+    /**
+     * @brief Finds every front-facing triangle that overlaps hull, rotated by orientation and moved to position.
+     *
+     * Triangles are gathered around the hull's bounding sphere and tested with GJK, starting
+     * from the simplex the same triangle ended with on the previous call with cache. When more than
+     * MAX_CACHED_TRIANGLES are near the hull, they are tested cold straight from the hierarchy. EPA then
+     * measures each overlap. Contacts whose normal points behind their triangle are dropped,
+     * like the back faces that every other query ignores.
+     *
+     * @param contacts Cleared, then receives one contact per overlapping triangle.
+     * @return Whether any triangle overlaps the hull.
+     */
+    bool convex_contacts(const ConvexHull& hull, const glm::quat& orientation, const glm::vec3& position, ConvexCache& cache, std::vector<ConvexContact>& contacts) const;
+
+    /**
+     * @brief Calls slide_sphere() for every agent, spreading the agents over the threads of pool.
+     *
+     * The mesh is only read, and each agent writes only its own entry of results,
+     * so the threads share no mutable state.
+     *
+     * @param positions The sphere centers before moving.
+     * @param displacements The desired displacement of each agent. Must be the same size as positions.
+     * @param results Resized to match positions and receives the new sphere centers.
+     */
+    void slide_spheres(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& displacements, float radius, std::vector<glm::vec3>& results, ThreadPool& pool) const;
+
+    /**
+     * @brief Like slide_spheres(), with one ContactCache per agent.
+     *
+     * @param caches Resized to match positions. Each agent only touches its own cache.
+     */
+    void slide_spheres(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& displacements, float radius, std::vector<ContactCache>& caches, std::vector<glm::vec3>& results, ThreadPool& pool) const;
+
+    /**
+     * @brief Moves every vertex and refits the hierarchy to the new positions in O(n).
+     *
+     * If refitting leaves the hierarchy's SAH cost more than REBUILD_THRESHOLD times its cost
+     * right after the last build, the hierarchy is rebuilt from scratch instead.
+     * Triangle indices reported by queries may change when that happens.
+     *
+     * @param vertices The new position of every vertex in vertices().
+     * @return Whether the hierarchy was rebuilt.
+     */
+    bool update(const std::vector<glm::vec3>& vertices);
+
+    /**
+     * @brief Like update(), but rebuilds on the threads of pool, which a deforming mesh can keep for its whole life.
+     */
+    bool update(const std::vector<glm::vec3>& vertices, ThreadPool& pool);
+
+    static const unsigned MAX_SLIDE_ITERATIONS = 4;
+    static constexpr float REBUILD_THRESHOLD = 1.5f;
+    static const unsigned NO_NEIGHBOUR = 0xFFFFFFFFu;
+    static const unsigned MAX_CACHED_TRIANGLES = 256;
+    static constexpr float CONTACT_CACHE_MARGIN = 4.0f;
+    static const unsigned CACHE_VERSION = 1;
+    static const std::size_t MIN_PARALLEL_TRIANGLES = 16384; // smaller meshes build on the calling thread even when given a pool
 private:
-    std::vector<Triangle> m_triangles;
+    void load(const std::vector<Triangle>& triangles, ThreadPool& pool);
+    void load_cached(const std::string& path, const std::string& cache_path, ThreadPool& pool);
+
+    /**
+     * @brief Points every array at its section of cache_path, if that file matches the source.
+     */
+    bool map_cache(const std::string& cache_path, std::uint64_t source_hash, std::uint64_t source_size);
+    bool save_cache(const std::string& cache_path, std::uint64_t source_hash, std::uint64_t source_size) const;
+    ArrayView<std::uint8_t> features() const;
+
+    void build(const std::vector<unsigned>& indices, ThreadPool& pool);
+    void find_neighbours();
+    void classify_features();
+
+    /**
+     * @brief Collects the triangles whose bounds overlap region.
+     *
+     * @return The number of triangles found, or capacity + 1 if they did not fit.
+     */
+    unsigned gather_triangles(const AABB& region, unsigned* triangles, unsigned capacity) const;
+
+    /**
+     * @brief Gathers the triangles overlapping region into a cache's list, which never grows past MAX_CACHED_TRIANGLES.
+     *
+     * @return Whether they fit. If not, triangles is left empty.
+     */
+    bool gather_cached(const AABB& region, std::vector<unsigned>& triangles) const;
+    bool sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, const unsigned* candidates, unsigned count, RaycastHit& hit) const;
+
+    /**
+     * @brief Like sphere_cast(), and adds the number of triangles swept in the leaves it reaches to tested.
+     */
+    bool sphere_cast(const glm::vec3& C, float radius, const glm::vec3& displacement, RaycastHit& hit, std::uint64_t& tested) const;
+
+    /**
+     * @brief Slides a sphere against candidates, or against the whole hierarchy if candidates is null.
+     *
+     * @param tested Incremented by the number of triangles swept.
+     */
+    glm::vec3 slide_sphere(const glm::vec3& C, float radius, const glm::vec3& displacement, const unsigned* candidates, unsigned count, std::uint64_t& tested) const;
+
+    TriangleSoA m_triangles;
+    BVH m_bvh;
+    float m_build_cost;
+    BVH::Quality m_quality;
+    unsigned m_revision; // unique across meshes and renewed by update(), so contact caches know their triangles changed
+
+    std::vector<glm::vec3> m_vertices;
+    std::vector<unsigned> m_indices;
+    std::vector<unsigned> m_neighbours;
+    std::vector<std::uint8_t> m_features; // per triangle, bit k: edge k is sharp, bit 3 + k: vertex k is sharp
+
+    // when m_cache is set, the arrays above are empty and these refer to its sections instead
+    std::unique_ptr<MappedFile> m_cache;
+    ArrayView<glm::vec3> m_cached_vertices;
+    ArrayView<unsigned> m_cached_indices;
+    ArrayView<unsigned> m_cached_neighbours;
+    ArrayView<std::uint8_t> m_cached_features;
 };
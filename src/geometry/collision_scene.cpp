@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp>
+#include <limits>
+#include <stdexcept>
+
+#include "collision_scene.h"
+
+namespace {
+    // every instance costs a whole bottom-level traversal, so leaves hold just one
+    const unsigned MAX_INSTANCES_PER_LEAF = 1;
+
+    void place(CollisionScene::Instance& instance, const Transform& transform)
+    {
+        instance.to_world = transform.get_matrix();
+        instance.to_local = transform.get_inverse_matrix();
+        ArrayView<BVH::Node> nodes = instance.mesh->bvh().nodes();
+
+        // an empty mesh still needs a box for the top-level build, so it gets a point at its origin
+        if (nodes.empty()) {
+            glm::vec3 origin(instance.to_world[3]);
+            instance.bounds = AABB(origin, origin);
+        } else {
+            instance.bounds = transform_aabb(instance.to_world, nodes[0].bounds);
+        }
+    }
+}
+
+CollisionScene::CollisionScene()
+{
+}
+
+unsigned CollisionScene::add_instance(const CollisionMesh& mesh, const Transform& transform)
+{
+    Instance instance;
+    instance.mesh = &mesh;
+    place(instance, transform);
+    m_instances.push_back(instance);
+    return static_cast<unsigned>(m_instances.size() - 1);
+}
+
+void CollisionScene::set_transform(unsigned instance, const Transform& transform)
+{
+    if (instance >= m_instances.size()) {
+        throw std::out_of_range("CollisionScene::set_transform: no such instance");
+    }
+
+    place(m_instances[instance], transform);
+}
+
+void CollisionScene::build()
+{
+    std::vector<AABB> bounds(m_instances.size());
+
+    for (std::size_t i = 0; i < m_instances.size(); i++) {
+        bounds[i] = m_instances[i].bounds;
+    }
+
+    m_bvh = BVH(bounds, MAX_INSTANCES_PER_LEAF);
+}
+
+const std::vector<CollisionScene::Instance>& CollisionScene::instances() const
+{
+    return m_instances;
+}
+
+const BVH& CollisionScene::bvh() const
+{
+    return m_bvh;
+}
+
+std::size_t CollisionScene::memory_usage() const
+{
+    std::vector<const CollisionMesh*> meshes;
+
+    for (const Instance& instance : m_instances) {
+        meshes.push_back(instance.mesh);
+    }
+
+    std::sort(meshes.begin(), meshes.end());
+    meshes.erase(std::unique(meshes.begin(), meshes.end()), meshes.end());
+    std::size_t bytes = m_instances.size() * sizeof(Instance) + m_bvh.nodes().size() * sizeof(BVH::Node) + m_bvh.primitives().size() * sizeof(unsigned);
+
+    for (const CollisionMesh* mesh : meshes) {
+        bytes += mesh->memory_usage();
+    }
+
+    return bytes;
+}
+
+bool CollisionScene::raycast(const glm::vec3& O, const glm::vec3& D, float max_t, SceneHit& hit) const
+{
+    ArrayView<unsigned> primitives = m_bvh.primitives();
+
+    if (D == glm::vec3(0.0f)) {
+        return false;
+    }
+
+    bool found = false;
+
+    m_bvh.traverse_ray(O, D, max_t, 0.0f, [&](unsigned first, unsigned count, float& closest_t) {
+        for (unsigned k = first; k < first + count; k++) {
+            // the transforms are affine, so t measures the same point along both rays
+            const Instance& instance = m_instances[primitives[k]];
+            glm::vec3 local_O(instance.to_local * glm::vec4(O, 1.0f));
+            glm::vec3 local_D(glm::mat3(instance.to_local) * D);
+            RaycastHit local_hit;
+
+            if (instance.mesh->raycast(local_O, local_D, closest_t, local_hit)) {
+                closest_t = local_hit.t;
+                hit.instance = primitives[k];
+                hit.hit = local_hit;
+                found = true;
+            }
+        }
+    });
+
+    if (found) {
+        // normals transform by the inverse transpose, which keeps them perpendicular to scaled surfaces
+        const Instance& instance = m_instances[hit.instance];
+        hit.hit.point = O + hit.hit.t * D;
+        hit.hit.normal = glm::normalize(glm::transpose(glm::mat3(instance.to_local)) * hit.hit.normal);
+    }
+
+    return found;
+}
+
+bool CollisionScene::segment_cast(const glm::vec3& P, const glm::vec3& displacement, SceneHit& hit) const
+{
+    return raycast(P, displacement, 1.0f, hit);
+}
+
+bool CollisionScene::pick(const Ray& ray, SceneHit& hit) const
+{
+    return raycast(ray.origin, ray.direction, std::numeric_limits<float>::max(), hit);
+}
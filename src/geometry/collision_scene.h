@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../graphics/transform.h"
+#include "bvh.h"
+#include "collision_mesh.h"
+#include "geometry.h"
+
+struct SceneHit {
+    unsigned instance; // index into CollisionScene::instances()
+    RaycastHit hit;    // triangle indexes the instance's mesh; t, point and normal are in world space
+};
+
+/**
+ * @brief Many placed copies of a few CollisionMeshes, with a hierarchy over the copies.
+ *
+ * Every instance refers to a shared mesh and a transform, so memory grows with the unique
+ * geometry plus a small fixed amount per instance. Queries walk the top-level hierarchy
+ * over the instances' world-space bounds, then transform the ray into each instance's
+ * space and walk that mesh's own hierarchy.
+ */
+class CollisionScene {
+public:
+    struct Instance {
+        const CollisionMesh* mesh;
+        glm::mat4 to_world;
+        glm::mat4 to_local;
+        AABB bounds; // the mesh's bounds transformed into world space
+    };
+
+    CollisionScene();
+
+    /**
+     * @brief Places mesh in the scene. The mesh is not copied and must outlive the scene.
+     *
+     * Mirroring transforms turn the mesh inside out, so its front faces become back faces.
+     *
+     * @return The new instance's index.
+     */
+    unsigned add_instance(const CollisionMesh& mesh, const Transform& transform);
+    void set_transform(unsigned instance, const Transform& transform);
+
+    /**
+     * @brief Rebuilds the top-level hierarchy. Must be called after adding or moving instances, before the next query.
+     */
+    void build();
+
+    const std::vector<Instance>& instances() const;
+    const BVH& bvh() const;
+
+    /**
+     * @brief The number of bytes used by the instances, the top-level hierarchy, and each distinct mesh once.
+     */
+    std::size_t memory_usage() const;
+
+    /**
+     * @brief Same as CollisionMesh::raycast(), over every instance.
+     */
+    bool raycast(const glm::vec3& O, const glm::vec3& D, float max_t, SceneHit& hit) const;
+    bool segment_cast(const glm::vec3& P, const glm::vec3& displacement, SceneHit& hit) const;
+    bool pick(const Ray& ray, SceneHit& hit) const;
+private:
+    std::vector<Instance> m_instances;
+    BVH m_bvh;
+};
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "compressed_collision_mesh.h"
+
+struct CompressedCollisionMesh::BuildNode {
+    AABB bounds;         // exact bounds of the snapped vertices, filled in once the lattice is known
+    unsigned child[2];
+    unsigned first;      // first triangle of a leaf
+    unsigned count;      // 0 for interior nodes
+};
+
+namespace {
+    const int QUANTIZED_MAX = 65535;
+
+    struct LatticeHash {
+        std::size_t operator()(const glm::ivec3& L) const
+        {
+            std::hash<int> hash;
+            return hash(L.x) ^ (hash(L.y) * 0x9E3779B1u) ^ (hash(L.z) * 0x85EBCA77u);
+        }
+    };
+
+    float decode_coordinate(std::uint16_t q, float parent_min, float parent_max)
+    {
+        // the end points decode exactly, so a child touching its parent's face stays inside it
+        if (q == 0) return parent_min;
+        if (q == QUANTIZED_MAX) return parent_max;
+        return parent_min + q * ((parent_max - parent_min) / QUANTIZED_MAX);
+    }
+
+    std::uint16_t quantize_min(float value, float parent_min, float parent_max)
+    {
+        float scale = (parent_max - parent_min) / QUANTIZED_MAX;
+        int q = scale > 0.0f ? static_cast<int>(std::floor((value - parent_min) / scale)) : 0;
+        q = glm::clamp(q, 0, QUANTIZED_MAX);
+
+        while (q > 0 && decode_coordinate(static_cast<std::uint16_t>(q), parent_min, parent_max) > value) {
+            q--;
+        }
+
+        return static_cast<std::uint16_t>(q);
+    }
+
+    std::uint16_t quantize_max(float value, float parent_min, float parent_max)
+    {
+        float scale = (parent_max - parent_min) / QUANTIZED_MAX;
+        int q = scale > 0.0f ? static_cast<int>(std::ceil((value - parent_min) / scale)) : QUANTIZED_MAX;
+        q = glm::clamp(q, 0, QUANTIZED_MAX);
+
+        while (q < QUANTIZED_MAX && decode_coordinate(static_cast<std::uint16_t>(q), parent_min, parent_max) < value) {
+            q++;
+        }
+
+        return static_cast<std::uint16_t>(q);
+    }
+
+    AABB decode_child(const CompressedCollisionMesh::Node& node, int c, const AABB& parent)
+    {
+        AABB child;
+
+        for (int axis = 0; axis < 3; axis++) {
+            child.min[axis] = decode_coordinate(node.child_min[c][axis], parent.min[axis], parent.max[axis]);
+            child.max[axis] = decode_coordinate(node.child_max[c][axis], parent.min[axis], parent.max[axis]);
+        }
+
+        return child;
+    }
+}
+
+CompressedCollisionMesh::CompressedCollisionMesh(const CollisionMesh& mesh) :
+    m_lattice_origin(0.0f),
+    m_lattice_step(1.0f),
+    m_num_triangles(mesh.triangles().size()),
+    m_num_welded_vertices(0)
+{
+    const TriangleSoA& triangles = mesh.triangles();
+    ArrayView<BVH::Node> bvh_nodes = mesh.bvh().nodes();
+
+    if (bvh_nodes.empty()) {
+        return;
+    }
+
+    m_lattice_origin = bvh_nodes[0].bounds.min;
+
+    std::vector<BuildNode> build_nodes;
+    unsigned root = build(mesh, 0, build_nodes);
+
+    // pick the finest lattice on which every leaf still spans at most 65534 steps
+    float max_leaf_extent = 0.0f;
+
+    for (const BuildNode& node : build_nodes) {
+        if (node.count > 0) {
+            AABB bounds;
+
+            for (unsigned i = node.first; i < node.first + node.count; i++) {
+                Triangle triangle = triangles.triangle(i);
+                bounds.grow(triangle.points[0]);
+                bounds.grow(triangle.points[1]);
+                bounds.grow(triangle.points[2]);
+            }
+
+            glm::vec3 extent = bounds.extent();
+            max_leaf_extent = std::max(max_leaf_extent, std::max(extent.x, std::max(extent.y, extent.z)));
+        }
+    }
+
+    if (max_leaf_extent > 0.0f) {
+        m_lattice_step = max_leaf_extent / (QUANTIZED_MAX - 1);
+    }
+
+    std::vector<glm::ivec3> lattice(triangles.size() * 3);
+    std::unordered_set<glm::ivec3, LatticeHash> welded;
+
+    for (std::size_t i = 0; i < triangles.size(); i++) {
+        Triangle triangle = triangles.triangle(i);
+
+        for (int corner = 0; corner < 3; corner++) {
+            glm::vec3 L = glm::round((triangle.points[corner] - m_lattice_origin) / m_lattice_step);
+            lattice[i * 3 + corner] = glm::ivec3(L);
+            welded.insert(lattice[i * 3 + corner]);
+        }
+    }
+
+    m_num_welded_vertices = welded.size();
+
+    // children always precede their parents, so one pass computes the bounds bottom-up
+    for (BuildNode& node : build_nodes) {
+        if (node.count > 0) {
+            for (unsigned i = node.first * 3; i < (node.first + node.count) * 3; i++) {
+                node.bounds.grow(lattice_to_world(lattice[i]));
+            }
+        } else {
+            node.bounds = build_nodes[node.child[0]].bounds;
+            node.bounds.grow(build_nodes[node.child[1]].bounds);
+        }
+    }
+
+    m_bounds = build_nodes[root].bounds;
+
+    if (build_nodes[root].count > 0) {
+        Node node;
+        node.child[0] = LEAF_BIT | encode_leaf(build_nodes[root], lattice);
+        node.child[1] = EMPTY_CHILD;
+
+        for (int axis = 0; axis < 3; axis++) {
+            node.child_min[0][axis] = node.child_min[1][axis] = 0;
+            node.child_max[0][axis] = node.child_max[1][axis] = QUANTIZED_MAX;
+        }
+
+        m_nodes.push_back(node);
+    } else {
+        encode(root, m_bounds, lattice, build_nodes);
+    }
+
+    m_nodes.shrink_to_fit();
+    m_leaves.shrink_to_fit();
+    m_vertices.shrink_to_fit();
+    m_indices.shrink_to_fit();
+}
+
+std::size_t CompressedCollisionMesh::num_triangles() const
+{
+    return m_num_triangles;
+}
+
+std::size_t CompressedCollisionMesh::num_welded_vertices() const
+{
+    return m_num_welded_vertices;
+}
+
+std::size_t CompressedCollisionMesh::num_stored_vertices() const
+{
+    return m_vertices.size() / 3;
+}
+
+std::size_t CompressedCollisionMesh::memory_usage() const
+{
+    return m_nodes.size() * sizeof(Node) + m_leaves.size() * sizeof(Leaf) +
+        m_vertices.size() * sizeof(std::uint16_t) + m_indices.size() * sizeof(std::uint8_t);
+}
+
+unsigned CompressedCollisionMesh::build(const CollisionMesh& mesh, unsigned bvh_node, std::vector<BuildNode>& build_nodes) const
+{
+    ArrayView<BVH::Node> bvh_nodes = mesh.bvh().nodes();
+    const BVH::Node& node = bvh_nodes[bvh_node];
+
+    if (node.count > 0) {
+        return build_range(node.first, node.count, build_nodes);
+    }
+
+    // every subtree covers a contiguous triangle range, so small subtrees collapse into one leaf
+    unsigned first = bvh_node, last = bvh_node;
+
+    while (bvh_nodes[first].count == 0) first = bvh_nodes[first].first;
+    while (bvh_nodes[last].count == 0) last = bvh_nodes[last].first + 1;
+
+    unsigned first_triangle = bvh_nodes[first].first;
+    unsigned num_triangles = bvh_nodes[last].first + bvh_nodes[last].count - first_triangle;
+
+    if (num_triangles <= MAX_LEAF_SIZE) {
+        return build_range(first_triangle, num_triangles, build_nodes);
+    }
+
+    unsigned left = build(mesh, node.first, build_nodes);
+    unsigned right = build(mesh, node.first + 1, build_nodes);
+
+    BuildNode interior;
+    interior.child[0] = left;
+    interior.child[1] = right;
+    interior.first = 0;
+    interior.count = 0;
+    build_nodes.push_back(interior);
+    return static_cast<unsigned>(build_nodes.size() - 1);
+}
+
+unsigned CompressedCollisionMesh::build_range(unsigned first, unsigned count, std::vector<BuildNode>& build_nodes) const
+{
+    BuildNode node;
+    node.first = first;
+    node.count = count;
+
+    // leaves index their vertices with a byte, so oversized leaves are split in half
+    if (count > MAX_LEAF_SIZE) {
+        unsigned half = count / 2;
+        node.child[0] = build_range(first, half, build_nodes);
+        node.child[1] = build_range(first + half, count - half, build_nodes);
+        node.first = 0;
+        node.count = 0;
+    }
+
+    build_nodes.push_back(node);
+    return static_cast<unsigned>(build_nodes.size() - 1);
+}
+
+std::uint32_t CompressedCollisionMesh::encode(unsigned build_node, const AABB& bounds, const std::vector<glm::ivec3>& lattice, const std::vector<BuildNode>& build_nodes)
+{
+    std::uint32_t index = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    for (int c = 0; c < 2; c++) {
+        const BuildNode& child = build_nodes[build_nodes[build_node].child[c]];
+
+        for (int axis = 0; axis < 3; axis++) {
+            m_nodes[index].child_min[c][axis] = quantize_min(child.bounds.min[axis], bounds.min[axis], bounds.max[axis]);
+            m_nodes[index].child_max[c][axis] = quantize_max(child.bounds.max[axis], bounds.min[axis], bounds.max[axis]);
+        }
+
+        std::uint32_t ref;
+
+        if (child.count > 0) {
+            ref = LEAF_BIT | encode_leaf(child, lattice);
+        } else {
+            ref = encode(build_nodes[build_node].child[c], decode_child(m_nodes[index], c, bounds), lattice, build_nodes);
+        }
+
+        m_nodes[index].child[c] = ref;
+    }
+
+    return index;
+}
+
+std::uint32_t CompressedCollisionMesh::encode_leaf(const BuildNode& node, const std::vector<glm::ivec3>& lattice)
+{
+    Leaf leaf;
+    leaf.first_triangle = node.first;
+    leaf.first_vertex = static_cast<std::uint32_t>(m_vertices.size() / 3);
+    leaf.first_index = static_cast<std::uint32_t>(m_indices.size());
+    leaf.num_triangles = static_cast<std::uint16_t>(node.count);
+
+    std::vector<glm::ivec3> local;
+    glm::ivec3 origin = lattice[node.first * 3];
+
+    for (unsigned i = node.first * 3; i < (node.first + node.count) * 3; i++) {
+        unsigned local_index = static_cast<unsigned>(std::find(local.begin(), local.end(), lattice[i]) - local.begin());
+
+        if (local_index == local.size()) {
+            local.push_back(lattice[i]);
+            origin = glm::min(origin, lattice[i]);
+        }
+
+        m_indices.push_back(static_cast<std::uint8_t>(local_index));
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        leaf.origin[axis] = origin[axis];
+    }
+
+    for (const glm::ivec3& L : local) {
+        glm::ivec3 offset = L - origin;
+
+        if (glm::any(glm::greaterThan(offset, glm::ivec3(QUANTIZED_MAX)))) {
+            throw std::logic_error("CompressedCollisionMesh: leaf does not fit in 16-bit lattice offsets");
+        }
+
+        m_vertices.push_back(static_cast<std::uint16_t>(offset.x));
+        m_vertices.push_back(static_cast<std::uint16_t>(offset.y));
+        m_vertices.push_back(static_cast<std::uint16_t>(offset.z));
+    }
+
+    leaf.num_vertices = static_cast<std::uint16_t>(local.size());
+    m_leaves.push_back(leaf);
+    return static_cast<std::uint32_t>(m_leaves.size() - 1);
+}
+
+glm::vec3 CompressedCollisionMesh::lattice_to_world(const glm::ivec3& L) const
+{
+    return m_lattice_origin + glm::vec3(L) * m_lattice_step;
+}
+
+glm::vec3 CompressedCollisionMesh::vertex(const Leaf& leaf, unsigned local_index) const
+{
+    const std::uint16_t* offset = &m_vertices[(leaf.first_vertex + local_index) * 3];
+    glm::ivec3 L(leaf.origin[0] + offset[0], leaf.origin[1] + offset[1], leaf.origin[2] + offset[2]);
+    return lattice_to_world(L);
+}
+
+bool CompressedCollisionMesh::intersect_leaf(const Leaf& leaf, const glm::vec3& O, const glm::vec3& D, float& max_t, RaycastHit& hit) const
+{
+    bool found = false;
+    const std::uint8_t* indices = &m_indices[leaf.first_index];
+
+    for (unsigned i = 0; i < leaf.num_triangles; i++) {
+        glm::vec3 a = vertex(leaf, indices[i * 3]);
+        glm::vec3 b = vertex(leaf, indices[i * 3 + 1]);
+        glm::vec3 c = vertex(leaf, indices[i * 3 + 2]);
+        float t;
+
+        if (intersect_triangle(O, D, a, b, c, max_t, t)) {
+            max_t = t;
+            hit.triangle = leaf.first_triangle + i;
+            hit.t = t;
+            hit.normal = glm::normalize(glm::cross(b - a, c - a));
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool CompressedCollisionMesh::raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const
+{
+    if (m_nodes.empty() || D == glm::vec3(0.0f)) {
+        return false;
+    }
+
+    glm::vec3 inv_D = 1.0f / D;
+    bool found = false;
+    float entry;
+
+    if (!intersect_aabb(O, inv_D, m_bounds, max_t, entry)) {
+        return false;
+    }
+
+    struct StackEntry {
+        std::uint32_t node;
+        AABB bounds;
+    };
+
+    // oversized leaves split in build_range() can add up to 32 levels below the BVH's own depth limit
+    StackEntry stack[BVH::MAX_DEPTH + 32 + 1];
+    unsigned stack_size = 0;
+    stack[stack_size++] = { 0, m_bounds };
+
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        const Node& node = m_nodes[entry.node];
+
+        AABB child_bounds[2];
+        float child_t[2];
+        bool child_hit[2];
+
+        for (int c = 0; c < 2; c++) {
+            child_hit[c] = node.child[c] != EMPTY_CHILD;
+
+            if (child_hit[c]) {
+                child_bounds[c] = decode_child(node, c, entry.bounds);
+                child_hit[c] = intersect_aabb(O, inv_D, child_bounds[c], max_t, child_t[c]);
+            }
+        }
+
+        int near = (child_hit[0] && child_hit[1] && child_t[1] < child_t[0]) ? 1 : 0;
+
+        // leaves are tested right away, near one first; interior children are pushed far one first
+        for (int k = 0; k < 2; k++) {
+            int c = k == 0 ? near : 1 - near;
+
+            if (child_hit[c] && (node.child[c] & LEAF_BIT)) {
+                found |= intersect_leaf(m_leaves[node.child[c] & ~LEAF_BIT], O, D, max_t, hit);
+            }
+        }
+
+        for (int k = 0; k < 2; k++) {
+            int c = k == 0 ? 1 - near : near;
+
+            if (child_hit[c] && !(node.child[c] & LEAF_BIT)) {
+                stack[stack_size++] = { node.child[c], child_bounds[c] };
+            }
+        }
+    }
+
+    if (found) {
+        hit.point = O + hit.t * D;
+    }
+
+    return found;
+}
+
+bool CompressedCollisionMesh::segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const
+{
+    return raycast(P, displacement, 1.0f, hit);
+}
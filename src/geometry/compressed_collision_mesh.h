@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "collision_mesh.h"
+#include "geometry.h"
+
+/**
+ * @brief A read-only, memory-compact copy of a CollisionMesh for large worlds.
+ *
+ * The hierarchy is stored as 32-byte nodes holding both children's bounds as 16-bit
+ * offsets within the parent's bounds. Vertices are snapped to a global lattice, and
+ * welding happens per leaf: every leaf stores the distinct vertices of its triangles
+ * as 16-bit lattice offsets from the leaf's corner, with 8-bit indices per triangle.
+ * A vertex shared by several leaves is stored once in each, since a global index
+ * would need wider indices than it saves. Shared vertices snap to the same lattice
+ * point in every leaf, so the surface stays watertight.
+ */
+class CompressedCollisionMesh {
+public:
+    struct Node {
+        std::uint16_t child_min[2][3];
+        std::uint16_t child_max[2][3];
+        std::uint32_t child[2]; // node index, LEAF_BIT | leaf index, or EMPTY_CHILD
+    };
+
+    struct Leaf {
+        std::int32_t origin[3];        // lattice coordinates the vertex offsets are relative to
+        std::uint32_t first_triangle;  // index of the first triangle in the source CollisionMesh
+        std::uint32_t first_vertex;
+        std::uint32_t first_index;
+        std::uint16_t num_triangles;
+        std::uint16_t num_vertices;
+    };
+
+    static const std::uint32_t LEAF_BIT = 0x80000000u;
+    static const std::uint32_t EMPTY_CHILD = 0xFFFFFFFFu;
+    static const unsigned MAX_LEAF_SIZE = 8;
+
+    CompressedCollisionMesh(const CollisionMesh& mesh);
+
+    std::size_t num_triangles() const;
+    /**
+     * @brief The distinct lattice points across the whole mesh, each of which is stored at least once.
+     */
+    std::size_t num_welded_vertices() const;
+
+    /**
+     * @brief The vertices actually stored, one per leaf using each lattice point.
+     */
+    std::size_t num_stored_vertices() const;
+    std::size_t memory_usage() const;
+
+    /**
+     * @brief Same as CollisionMesh::raycast(). hit.triangle indexes the source CollisionMesh.
+     */
+    bool raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const;
+    bool segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const;
+private:
+    struct BuildNode;
+
+    unsigned build(const CollisionMesh& mesh, unsigned bvh_node, std::vector<BuildNode>& build_nodes) const;
+    unsigned build_range(unsigned first, unsigned count, std::vector<BuildNode>& build_nodes) const;
+    std::uint32_t encode(unsigned build_node, const AABB& bounds, const std::vector<glm::ivec3>& lattice, const std::vector<BuildNode>& build_nodes);
+    std::uint32_t encode_leaf(const BuildNode& node, const std::vector<glm::ivec3>& lattice);
+
+    glm::vec3 lattice_to_world(const glm::ivec3& L) const;
+    glm::vec3 vertex(const Leaf& leaf, unsigned local_index) const;
+    bool intersect_leaf(const Leaf& leaf, const glm::vec3& O, const glm::vec3& D, float& max_t, RaycastHit& hit) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Leaf> m_leaves;
+    std::vector<std::uint16_t> m_vertices; // three lattice offsets per vertex
+    std::vector<std::uint8_t> m_indices;   // three leaf-local vertex indices per triangle
+
+    AABB m_bounds;
+    glm::vec3 m_lattice_origin;
+    float m_lattice_step;
+    std::size_t m_num_triangles;
+    std::size_t m_num_welded_vertices;
+};
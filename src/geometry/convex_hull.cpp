@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "convex_hull.h"
+
+namespace {
+    // points closer to a face's plane than this fraction of the hull's size count as on it
+    const float HULL_TOLERANCE = 1.0e-5f;
+
+    struct Face {
+        unsigned v[3];
+        glm::vec3 normal;
+        float offset;
+        bool alive;
+        std::vector<unsigned> outside; // points above this face that no earlier face claimed
+    };
+
+    // which cell of the support map direction falls in
+    unsigned support_cell(const glm::vec3& direction)
+    {
+        const unsigned n = ConvexHull::SUPPORT_MAP_CELLS;
+        glm::vec3 magnitude = glm::abs(direction);
+        unsigned axis = magnitude.x >= magnitude.y ? (magnitude.x >= magnitude.z ? 0 : 2) : (magnitude.y >= magnitude.z ? 1 : 2);
+
+        if (!(magnitude[axis] > 0.0f)) {
+            return 0;
+        }
+
+        float u = direction[(axis + 1) % 3] / magnitude[axis];
+        float v = direction[(axis + 2) % 3] / magnitude[axis];
+        unsigned face = axis * 2 + (direction[axis] < 0.0f);
+        unsigned column = glm::min(static_cast<unsigned>((u + 1.0f) * 0.5f * n), n - 1);
+        unsigned row = glm::min(static_cast<unsigned>((v + 1.0f) * 0.5f * n), n - 1);
+        return (face * n + row) * n + column;
+    }
+
+    std::uint64_t edge_key(unsigned a, unsigned b)
+    {
+        return static_cast<std::uint64_t>(a) << 32 | b;
+    }
+
+    Face make_face(ArrayView<glm::vec3> points, unsigned a, unsigned b, unsigned c)
+    {
+        Face face;
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        face.normal = glm::normalize(glm::cross(points[b] - points[a], points[c] - points[a]));
+        face.offset = glm::dot(face.normal, points[a]);
+        face.alive = true;
+        return face;
+    }
+
+    float distance(const Face& face, const glm::vec3& P)
+    {
+        return glm::dot(face.normal, P) - face.offset;
+    }
+
+    // picks four points spanning as much volume as possible to start the hull from
+    std::array<unsigned, 4> initial_simplex(ArrayView<glm::vec3> points, float tolerance)
+    {
+        unsigned lowest = 0, highest = 0;
+
+        for (unsigned i = 1; i < points.size(); i++) {
+            if (points[i].x < points[lowest].x) lowest = i;
+            if (points[i].x > points[highest].x) highest = i;
+        }
+
+        glm::vec3 axis = points[highest] - points[lowest];
+        unsigned third = 0, fourth = 0;
+        float best = 0.0f;
+
+        for (unsigned i = 0; i < points.size(); i++) {
+            float d = glm::length(glm::cross(axis, points[i] - points[lowest]));
+
+            if (d > best) {
+                best = d;
+                third = i;
+            }
+        }
+
+        glm::vec3 normal = glm::cross(axis, points[third] - points[lowest]);
+        best = 0.0f;
+
+        for (unsigned i = 0; i < points.size(); i++) {
+            float d = glm::abs(glm::dot(normal, points[i] - points[lowest]));
+
+            if (d > best) {
+                best = d;
+                fourth = i;
+            }
+        }
+
+        if (glm::length(axis) <= tolerance || glm::length(normal) <= tolerance * glm::length(axis) || best <= tolerance * glm::length(normal)) {
+            throw std::invalid_argument("ConvexHull: the points do not span a volume");
+        }
+
+        return { lowest, highest, third, fourth };
+    }
+}
+
+const unsigned ConvexHull::SUPPORT_MAP_CELLS;
+
+ConvexHull::ConvexHull(ArrayView<glm::vec3> points)
+{
+    if (points.size() < 4) {
+        throw std::invalid_argument("ConvexHull: at least four points are needed");
+    }
+
+    glm::vec3 low = points[0], high = points[0];
+
+    for (const glm::vec3& point : points) {
+        low = glm::min(low, point);
+        high = glm::max(high, point);
+    }
+
+    float tolerance = HULL_TOLERANCE * glm::max(glm::length(high - low), 1.0e-6f);
+    std::array<unsigned, 4> simplex = initial_simplex(points, tolerance);
+    std::vector<Face> faces;
+    std::unordered_map<std::uint64_t, unsigned> edges; // directed edge -> face on its left
+
+    auto add_face = [&](unsigned a, unsigned b, unsigned c) {
+        faces.push_back(make_face(points, a, b, c));
+        unsigned index = static_cast<unsigned>(faces.size() - 1);
+        edges[edge_key(a, b)] = index;
+        edges[edge_key(b, c)] = index;
+        edges[edge_key(c, a)] = index;
+        return index;
+    };
+
+    // wind the tetrahedron so its faces point away from the fourth vertex
+    if (glm::dot(glm::cross(points[simplex[1]] - points[simplex[0]], points[simplex[2]] - points[simplex[0]]), points[simplex[3]] - points[simplex[0]]) > 0.0f) {
+        std::swap(simplex[1], simplex[2]);
+    }
+
+    add_face(simplex[0], simplex[1], simplex[2]);
+    add_face(simplex[0], simplex[3], simplex[1]);
+    add_face(simplex[1], simplex[3], simplex[2]);
+    add_face(simplex[2], simplex[3], simplex[0]);
+
+    for (unsigned i = 0; i < points.size(); i++) {
+        for (Face& face : faces) {
+            if (distance(face, points[i]) > tolerance) {
+                face.outside.push_back(i);
+                break;
+            }
+        }
+    }
+
+    std::vector<unsigned> visible, horizon, orphans;
+
+    for (unsigned current = 0; current < faces.size(); current++) {
+        if (!faces[current].alive || faces[current].outside.empty()) {
+            continue;
+        }
+
+        // the farthest outside point is certain to be a hull vertex
+        unsigned eye = faces[current].outside[0];
+
+        for (unsigned i : faces[current].outside) {
+            if (distance(faces[current], points[i]) > distance(faces[current], points[eye])) {
+                eye = i;
+            }
+        }
+
+        // flood out from the current face to every face the eye can see
+        visible.assign(1, current);
+        faces[current].alive = false;
+
+        for (std::size_t k = 0; k < visible.size(); k++) {
+            const Face& face = faces[visible[k]];
+
+            for (unsigned e = 0; e < 3; e++) {
+                unsigned neighbour = edges[edge_key(face.v[(e + 1) % 3], face.v[e])];
+
+                if (faces[neighbour].alive && distance(faces[neighbour], points[eye]) > tolerance) {
+                    faces[neighbour].alive = false;
+                    visible.push_back(neighbour);
+                }
+            }
+        }
+
+        // the horizon is every edge between a visible face and a hidden one
+        horizon.clear();
+        orphans.clear();
+
+        for (unsigned index : visible) {
+            const Face& face = faces[index];
+
+            for (unsigned e = 0; e < 3; e++) {
+                unsigned a = face.v[e], b = face.v[(e + 1) % 3];
+
+                if (faces[edges[edge_key(b, a)]].alive) {
+                    horizon.push_back(a);
+                    horizon.push_back(b);
+                }
+            }
+
+            for (unsigned i : face.outside) {
+                if (i != eye) {
+                    orphans.push_back(i);
+                }
+            }
+        }
+
+        for (unsigned index : visible) {
+            faces[index].outside.clear();
+            faces[index].outside.shrink_to_fit();
+        }
+
+        std::size_t first_new = faces.size();
+
+        for (std::size_t e = 0; e < horizon.size(); e += 2) {
+            add_face(horizon[e], horizon[e + 1], eye);
+        }
+
+        for (unsigned i : orphans) {
+            for (std::size_t f = first_new; f < faces.size(); f++) {
+                if (distance(faces[f], points[i]) > tolerance) {
+                    faces[f].outside.push_back(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    // keep only the vertices the surviving faces use, and connect the ones sharing an edge
+    std::vector<unsigned> remap(points.size(), 0xFFFFFFFFu);
+
+    for (const Face& face : faces) {
+        if (!face.alive) {
+            continue;
+        }
+
+        std::array<unsigned, 3> triangle;
+
+        for (unsigned k = 0; k < 3; k++) {
+            if (remap[face.v[k]] == 0xFFFFFFFFu) {
+                remap[face.v[k]] = static_cast<unsigned>(m_vertices.size());
+                m_vertices.push_back(points[face.v[k]]);
+            }
+
+            triangle[k] = remap[face.v[k]];
+        }
+
+        m_faces.push_back(triangle);
+    }
+
+    // every hull edge appears in exactly two faces, once in each direction, so collecting
+    // the directed edges of all faces gives each vertex its neighbours exactly once
+    std::vector<std::pair<unsigned, unsigned>> directed;
+
+    for (const std::array<unsigned, 3>& face : m_faces) {
+        for (unsigned k = 0; k < 3; k++) {
+            directed.push_back({ face[k], face[(k + 1) % 3] });
+        }
+    }
+
+    std::sort(directed.begin(), directed.end());
+    m_neighbour_offsets.assign(m_vertices.size() + 1, 0);
+    m_neighbours.reserve(directed.size());
+
+    for (const std::pair<unsigned, unsigned>& edge : directed) {
+        m_neighbour_offsets[edge.first + 1]++;
+        m_neighbours.push_back(edge.second);
+    }
+
+    for (std::size_t i = 0; i < m_vertices.size(); i++) {
+        m_neighbour_offsets[i + 1] += m_neighbour_offsets[i];
+    }
+
+    // seed the support map with exact answers for the center of every cell
+    const unsigned n = SUPPORT_MAP_CELLS;
+    m_support_map.resize(6 * n * n);
+
+    for (unsigned face = 0; face < 6; face++) {
+        for (unsigned row = 0; row < n; row++) {
+            for (unsigned column = 0; column < n; column++) {
+                glm::vec3 direction;
+                unsigned axis = face / 2;
+                direction[axis] = face % 2 ? -1.0f : 1.0f;
+                direction[(axis + 1) % 3] = (column + 0.5f) * 2.0f / n - 1.0f;
+                direction[(axis + 2) % 3] = (row + 0.5f) * 2.0f / n - 1.0f;
+                m_support_map[(face * n + row) * n + column] = climb(direction, 0);
+            }
+        }
+    }
+
+    m_center = 0.5f * (low + high);
+    m_radius = 0.0f;
+
+    for (const glm::vec3& vertex : m_vertices) {
+        m_radius = glm::max(m_radius, glm::length(vertex - m_center));
+    }
+}
+
+const std::vector<glm::vec3>& ConvexHull::vertices() const
+{
+    return m_vertices;
+}
+
+const std::vector<std::array<unsigned, 3>>& ConvexHull::faces() const
+{
+    return m_faces;
+}
+
+const glm::vec3& ConvexHull::center() const
+{
+    return m_center;
+}
+
+float ConvexHull::radius() const
+{
+    return m_radius;
+}
+
+unsigned ConvexHull::support(const glm::vec3& direction) const
+{
+    return climb(direction, m_support_map[support_cell(direction)]);
+}
+
+unsigned ConvexHull::climb(const glm::vec3& direction, unsigned start) const
+{
+    unsigned best = start;
+    float best_distance = glm::dot(m_vertices[best], direction);
+    bool improved = true;
+
+    // a local maximum of a linear function over a convex polytope's vertex graph is a global one
+    while (improved) {
+        improved = false;
+        unsigned current = best;
+
+        for (unsigned k = m_neighbour_offsets[current]; k < m_neighbour_offsets[current + 1]; k++) {
+            float d = glm::dot(m_vertices[m_neighbours[k]], direction);
+
+            if (d > best_distance) {
+                best_distance = d;
+                best = m_neighbours[k];
+                improved = true;
+            }
+        }
+    }
+
+    return best;
+}
+
+std::size_t ConvexHull::memory_usage() const
+{
+    return m_vertices.size() * sizeof(glm::vec3) + m_faces.size() * sizeof(std::array<unsigned, 3>) +
+           (m_neighbour_offsets.size() + m_neighbours.size() + m_support_map.size()) * sizeof(unsigned);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../utility/array_view.h"
+
+/**
+ * @brief The convex hull of a point set, stored for fast support queries.
+ *
+ * Every hull vertex keeps a list of its neighbours along hull edges, so support() can
+ * hill-climb instead of scanning all of them. The climb starts from the answer for the
+ * center of the query direction's cell in a small cube map, usually a step or two away.
+ */
+class ConvexHull {
+public:
+    /**
+     * @brief Builds the hull of points with an incremental quickhull.
+     *
+     * Points within a small tolerance of a face are treated as lying on it, so nearly
+     * coplanar detail is dropped. Throws std::invalid_argument if points do not span a volume.
+     */
+    ConvexHull(ArrayView<glm::vec3> points);
+
+    const std::vector<glm::vec3>& vertices() const;
+
+    /**
+     * @brief The hull's triangles, wound counter-clockwise when seen from outside.
+     */
+    const std::vector<std::array<unsigned, 3>>& faces() const;
+
+    /**
+     * @brief The center and radius of a sphere enclosing the hull.
+     */
+    const glm::vec3& center() const;
+    float radius() const;
+
+    /**
+     * @brief Returns the index of the vertex farthest along direction.
+     */
+    unsigned support(const glm::vec3& direction) const;
+
+    std::size_t memory_usage() const;
+
+    static const unsigned SUPPORT_MAP_CELLS = 8; // per side of each cube face
+private:
+    unsigned climb(const glm::vec3& direction, unsigned start) const;
+
+    std::vector<glm::vec3> m_vertices;
+    std::vector<std::array<unsigned, 3>> m_faces;
+    std::vector<unsigned> m_neighbour_offsets; // neighbours of vertex i are m_neighbours[offsets[i], offsets[i + 1])
+    std::vector<unsigned> m_neighbours;
+    std::vector<unsigned> m_support_map; // 6 faces of SUPPORT_MAP_CELLS^2 cells
+    glm::vec3 m_center;
+    float m_radius;
+};
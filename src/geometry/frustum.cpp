@@ -0,0 +1,204 @@
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <immintrin.h>
+
+#include "../utility/cpu_features.h"
+#include "frustum.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
+namespace {
+    using Kernel = void (*)(const Frustum&, const BoxSoA&, std::vector<unsigned>&);
+
+    // appends the boxes at first + the set bits of mask, ignoring the padding past count
+    void append_visible(unsigned mask, std::size_t first, std::size_t count, std::vector<unsigned>& visible)
+    {
+        if (count - first < BoxSoA::LANE_WIDTH) {
+            mask &= (1u << (count - first)) - 1;
+        }
+
+        for (unsigned lane = 0; mask; lane++, mask >>= 1) {
+            if (mask & 1) {
+                visible.push_back(static_cast<unsigned>(first + lane));
+            }
+        }
+    }
+
+    void cull_sse2(const Frustum& frustum, const BoxSoA& boxes, std::vector<unsigned>& visible)
+    {
+        const __m128 sign_mask = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (std::size_t first = 0; first < boxes.size(); first += BoxSoA::LANE_WIDTH) {
+            unsigned mask = 0;
+
+            for (std::size_t half = 0; half < BoxSoA::LANE_WIDTH; half += 4) {
+                std::size_t i = first + half;
+                __m128 cx = _mm_load_ps(boxes.stream(BoxSoA::CENTER_X) + i);
+                __m128 cy = _mm_load_ps(boxes.stream(BoxSoA::CENTER_Y) + i);
+                __m128 cz = _mm_load_ps(boxes.stream(BoxSoA::CENTER_Z) + i);
+                __m128 ex = _mm_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_X) + i);
+                __m128 ey = _mm_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_Y) + i);
+                __m128 ez = _mm_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_Z) + i);
+                __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+                for (const glm::vec4& plane : frustum.planes) {
+                    __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+
+                    // a box is outside a plane when its center is farther behind it than its projected radius
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(plane.w)));
+                    __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nx), ex), _mm_mul_ps(_mm_andnot_ps(sign_mask, ny), ey)), _mm_mul_ps(_mm_andnot_ps(sign_mask, nz), ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+                }
+
+                mask |= static_cast<unsigned>(_mm_movemask_ps(inside)) << half;
+            }
+
+            append_visible(mask, first, boxes.size(), visible);
+        }
+    }
+
+    TARGET_AVX void cull_avx(const Frustum& frustum, const BoxSoA& boxes, std::vector<unsigned>& visible)
+    {
+        const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (std::size_t i = 0; i < boxes.size(); i += BoxSoA::LANE_WIDTH) {
+            __m256 cx = _mm256_load_ps(boxes.stream(BoxSoA::CENTER_X) + i);
+            __m256 cy = _mm256_load_ps(boxes.stream(BoxSoA::CENTER_Y) + i);
+            __m256 cz = _mm256_load_ps(boxes.stream(BoxSoA::CENTER_Z) + i);
+            __m256 ex = _mm256_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_X) + i);
+            __m256 ey = _mm256_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_Y) + i);
+            __m256 ez = _mm256_load_ps(boxes.stream(BoxSoA::HALF_EXTENT_Z) + i);
+            __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+            for (const glm::vec4& plane : frustum.planes) {
+                __m256 nx = _mm256_set1_ps(plane.x), ny = _mm256_set1_ps(plane.y), nz = _mm256_set1_ps(plane.z);
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_add_ps(_mm256_mul_ps(nz, cz), _mm256_set1_ps(plane.w)));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(sign_mask, nx), ex), _mm256_mul_ps(_mm256_andnot_ps(sign_mask, ny), ey)), _mm256_mul_ps(_mm256_andnot_ps(sign_mask, nz), ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+            }
+
+            append_visible(static_cast<unsigned>(_mm256_movemask_ps(inside)), i, boxes.size(), visible);
+        }
+    }
+
+    struct KernelInfo {
+        Kernel kernel;
+        const char* name;
+    };
+
+    KernelInfo select_kernel()
+    {
+        if (cpu_features().avx) return { cull_avx, "AVX" };
+        return { cull_sse2, "SSE2" };
+    }
+
+    const KernelInfo kernel_info = select_kernel();
+}
+
+const std::size_t BoxSoA::ALIGNMENT;
+const std::size_t BoxSoA::LANE_WIDTH;
+
+Frustum::Frustum()
+{
+    planes.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Frustum::Frustum(const glm::mat4& view_projection)
+{
+    // a point is inside when -w <= x, y, z <= w in clip space, so each plane is the
+    // last row of the matrix plus or minus one of the others (Gribb and Hartmann)
+    glm::vec4 rows[4];
+
+    for (int row = 0; row < 4; row++) {
+        rows[row] = glm::vec4(view_projection[0][row], view_projection[1][row], view_projection[2][row], view_projection[3][row]);
+    }
+
+    planes[LEFT_PLANE] = rows[3] + rows[0];
+    planes[RIGHT_PLANE] = rows[3] - rows[0];
+    planes[BOTTOM_PLANE] = rows[3] + rows[1];
+    planes[TOP_PLANE] = rows[3] - rows[1];
+    planes[NEAR_PLANE] = rows[3] + rows[2];
+    planes[FAR_PLANE] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+    glm::vec3 center = box.center();
+    glm::vec3 half_extent = 0.5f * box.extent();
+
+    for (const glm::vec4& plane : planes) {
+        glm::vec3 normal(plane);
+
+        if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), half_extent) < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BoxSoA::BoxSoA() : m_size(0)
+{
+}
+
+void BoxSoA::clear()
+{
+    for (FloatStream& s : m_streams) {
+        s.clear();
+    }
+
+    m_size = 0;
+}
+
+void BoxSoA::push_back(const AABB& box)
+{
+    if (m_size == m_streams[0].size()) {
+        for (FloatStream& s : m_streams) {
+            s.resize(s.size() + LANE_WIDTH, 0.0f);
+        }
+    }
+
+    set(m_size++, box);
+}
+
+void BoxSoA::set(std::size_t i, const AABB& box)
+{
+    glm::vec3 center = box.center();
+    glm::vec3 half_extent = 0.5f * box.extent();
+
+    for (int axis = 0; axis < 3; axis++) {
+        m_streams[CENTER_X + axis][i] = center[axis];
+        m_streams[HALF_EXTENT_X + axis][i] = half_extent[axis];
+    }
+}
+
+std::size_t BoxSoA::size() const
+{
+    return m_size;
+}
+
+const float* BoxSoA::stream(Stream stream) const
+{
+    return m_streams[stream].data();
+}
+
+void cull_boxes(const Frustum& frustum, const BoxSoA& boxes, std::vector<unsigned>& visible)
+{
+    visible.clear();
+    kernel_info.kernel(frustum, boxes, visible);
+}
+
+const char* cull_kernel_name()
+{
+    return kernel_info.name;
+}
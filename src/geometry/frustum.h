@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+
+#include "../utility/aligned_allocator.h"
+#include "geometry.h"
+
+/**
+ * @brief The six planes bounding what a camera sees, facing inwards.
+ */
+struct Frustum {
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, NUM_PLANES };
+
+    /**
+     * @brief A frustum that contains everything.
+     */
+    Frustum();
+
+    /**
+     * @brief Extracts the planes of an OpenGL-style projection * view matrix, so they are in world space.
+     */
+    Frustum(const glm::mat4& view_projection);
+
+    /**
+     * @brief Whether box may be visible. Boxes just outside a corner can pass, but no visible box fails.
+     */
+    bool intersects(const AABB& box) const;
+
+    std::array<glm::vec4, NUM_PLANES> planes; // xyz is the unit normal, w the offset: inside when dot(xyz, P) + w >= 0
+};
+
+/**
+ * @brief Boxes stored as centers and half extents in separate aligned streams, for cull_boxes().
+ *
+ * Streams are padded to a multiple of LANE_WIDTH, so the kernels always load whole lanes.
+ */
+class BoxSoA {
+public:
+    enum Stream {
+        CENTER_X, CENTER_Y, CENTER_Z,
+        HALF_EXTENT_X, HALF_EXTENT_Y, HALF_EXTENT_Z,
+        NUM_STREAMS
+    };
+
+    static const std::size_t ALIGNMENT = 32;
+    static const std::size_t LANE_WIDTH = 8;
+
+    BoxSoA();
+
+    void clear();
+    void push_back(const AABB& box);
+    void set(std::size_t i, const AABB& box);
+
+    std::size_t size() const;
+    const float* stream(Stream stream) const;
+private:
+    using FloatStream = std::vector<float, AlignedAllocator<float, ALIGNMENT>>;
+
+    std::array<FloatStream, NUM_STREAMS> m_streams;
+    std::size_t m_size;
+};
+
+/**
+ * @brief Replaces visible with the indices of every box in boxes that frustum.intersects().
+ *
+ * Tests eight boxes at a time with AVX, or four with SSE, depending on what CPUID reports at startup.
+ */
+void cull_boxes(const Frustum& frustum, const BoxSoA& boxes, std::vector<unsigned>& visible);
+
+/**
+ * @brief The name of the kernel cull_boxes() selected for this CPU: "AVX" or "SSE2".
+ */
+const char* cull_kernel_name();
@@ -1,5 +1,143 @@
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <limits>
+
 #include "geometry.h"
 
 Triangle::Triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) : points{a, b, c}
 {
 }
+
+AABB::AABB() :
+    min(std::numeric_limits<float>::max()),
+    max(-std::numeric_limits<float>::max())
+{
+}
+
+AABB::AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max)
+{
+}
+
+void AABB::grow(const glm::vec3& point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void AABB::grow(const AABB& other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+bool AABB::empty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+glm::vec3 AABB::center() const
+{
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 AABB::extent() const
+{
+    return max - min;
+}
+
+float AABB::surface_area() const
+{
+    if (empty()) {
+        return 0.0f;
+    }
+
+    glm::vec3 e = extent();
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+float AABB::distance(const glm::vec3& point) const
+{
+    return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+}
+
+// adapted from https://stackoverflow.com/a/42752998
+bool intersect_triangle(const glm::vec3& O, const glm::vec3& D, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float max_t, float& t)
+{
+    glm::vec3 E1 = b - a;
+    glm::vec3 E2 = c - a;
+    glm::vec3 N = glm::cross(E1, E2);
+    float det = -glm::dot(D, N);
+    float invdet = 1.0f / det;
+    glm::vec3 AO = O - a;
+    glm::vec3 DAO = glm::cross(AO, D);
+    float u = glm::dot(E2, DAO) * invdet;
+    float v = -glm::dot(E1, DAO) * invdet;
+    t = glm::dot(AO, N) * invdet;
+    return (det >= 1.0e-6f && t >= 0.0f && t <= max_t && u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f);
+}
+
+glm::vec3 closest_point_on_triangle(const glm::vec3& P, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    // find the Voronoi region of P among the triangle's vertices, edges and face
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = P - a;
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return a;
+    }
+
+    glm::vec3 bp = P - b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+
+    if (d3 >= 0.0f && d4 <= d3) {
+        return b;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    glm::vec3 cp = P - c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+
+    if (d6 >= 0.0f && d5 <= d6) {
+        return c;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+AABB transform_aabb(const glm::mat4& matrix, const AABB& box)
+{
+    if (box.empty()) {
+        return box;
+    }
+
+    // each output axis spans the center's image plus the absolute row of the matrix applied to the half extent
+    glm::vec3 center(matrix * glm::vec4(box.center(), 1.0f));
+    glm::vec3 half_extent = glm::abs(glm::mat3(matrix)[0]) * (0.5f * box.extent().x) +
+        glm::abs(glm::mat3(matrix)[1]) * (0.5f * box.extent().y) +
+        glm::abs(glm::mat3(matrix)[2]) * (0.5f * box.extent().z);
+    return AABB(center - half_extent, center + half_extent);
+}
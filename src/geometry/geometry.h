@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 struct Triangle {
@@ -8,3 +9,44 @@ struct Triangle {
 
     std::array<glm::vec3, 3> points;
 };
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction; // unit length
+};
+
+struct AABB {
+    AABB();
+    AABB(const glm::vec3& min, const glm::vec3& max);
+
+    void grow(const glm::vec3& point);
+    void grow(const AABB& other);
+
+    bool empty() const;
+    glm::vec3 center() const;
+    glm::vec3 extent() const;
+    float surface_area() const;
+    float distance(const glm::vec3& point) const; // 0 inside the box
+
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+/**
+ * @brief Intersects the ray O + tD with the front face of triangle abc.
+ *
+ * @param max_t The largest parameter value that counts as a hit.
+ * @param t Receives the ray parameter of the hit point.
+ * @return Whether the ray hit the triangle with 0 <= t <= max_t.
+ */
+bool intersect_triangle(const glm::vec3& O, const glm::vec3& D, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float max_t, float& t);
+
+/**
+ * @brief Finds the point on triangle abc (including its interior) closest to P.
+ */
+glm::vec3 closest_point_on_triangle(const glm::vec3& P, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+/**
+ * @brief The smallest axis-aligned box containing box transformed by the affine matrix.
+ */
+AABB transform_aabb(const glm::mat4& matrix, const AABB& box);
@@ -0,0 +1,502 @@
+#include <algorithm>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#include "gjk.h"
+
+namespace {
+    const unsigned MAX_GJK_ITERATIONS = 32;
+    const unsigned MAX_EPA_ITERATIONS = 32;
+    const unsigned MAX_EPA_VERTICES = 4 + MAX_EPA_ITERATIONS;
+    const unsigned MAX_EPA_FACES = 128;
+    const unsigned MAX_EPA_EDGES = 64;
+
+    // relative to the size of the pair, so the tests work at any scale
+    const float GJK_TOLERANCE = 1.0e-6f;
+    const float EPA_TOLERANCE = 1.0e-4f;
+
+    struct Vertex {
+        glm::vec3 w; // the point of the Minkowski difference hull - triangle
+        glm::vec3 b; // the triangle's part of w
+        unsigned hull;
+        unsigned corner;
+    };
+
+    struct Pair {
+        const ConvexHull& hull;
+        glm::quat orientation;
+        glm::quat inverse;
+        glm::vec3 position;
+        glm::vec3 corners[3];
+
+        Vertex vertex(unsigned h, unsigned corner) const
+        {
+            glm::vec3 a = orientation * hull.vertices()[h] + position;
+            return { a - corners[corner], corners[corner], h, corner };
+        }
+
+        Vertex support(const glm::vec3& direction)
+        {
+            unsigned h = hull.support(inverse * direction);
+            unsigned corner = 0;
+
+            for (unsigned k = 1; k < 3; k++) {
+                if (glm::dot(corners[k], direction) < glm::dot(corners[corner], direction)) {
+                    corner = k;
+                }
+            }
+
+            return vertex(h, corner);
+        }
+    };
+
+    void closest_on_segment(Vertex* simplex, unsigned& count, glm::vec3& v)
+    {
+        glm::vec3 ab = simplex[1].w - simplex[0].w;
+        float length2 = glm::dot(ab, ab);
+        float t = length2 > 0.0f ? -glm::dot(simplex[0].w, ab) / length2 : 0.0f;
+
+        if (t <= 0.0f) {
+            count = 1;
+            v = simplex[0].w;
+        } else if (t >= 1.0f) {
+            simplex[0] = simplex[1];
+            count = 1;
+            v = simplex[0].w;
+        } else {
+            v = simplex[0].w + t * ab;
+        }
+    }
+
+    // Ericson's closest point on a triangle, with the origin as the query point
+    void closest_on_triangle(Vertex* simplex, unsigned& count, glm::vec3& v)
+    {
+        const glm::vec3& a = simplex[0].w;
+        const glm::vec3& b = simplex[1].w;
+        const glm::vec3& c = simplex[2].w;
+        glm::vec3 ab = b - a, ac = c - a;
+
+        float d1 = -glm::dot(ab, a), d2 = -glm::dot(ac, a);
+
+        if (d1 <= 0.0f && d2 <= 0.0f) {
+            count = 1;
+            v = a;
+            return;
+        }
+
+        float d3 = -glm::dot(ab, b), d4 = -glm::dot(ac, b);
+
+        if (d3 >= 0.0f && d4 <= d3) {
+            simplex[0] = simplex[1];
+            count = 1;
+            v = simplex[0].w;
+            return;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            count = 2;
+            v = a + d1 / (d1 - d3) * ab;
+            return;
+        }
+
+        float d5 = -glm::dot(ab, c), d6 = -glm::dot(ac, c);
+
+        if (d6 >= 0.0f && d5 <= d6) {
+            simplex[0] = simplex[2];
+            count = 1;
+            v = simplex[0].w;
+            return;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            v = a + d2 / (d2 - d6) * ac;
+            simplex[1] = simplex[2];
+            count = 2;
+            return;
+        }
+
+        float va = d3 * d6 - d5 * d4;
+
+        if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+            v = b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+            simplex[0] = simplex[2];
+            count = 2;
+            return;
+        }
+
+        float sum = va + vb + vc;
+
+        if (!(sum > 0.0f)) {
+            // collinear corners: the closest point lies on the longest edge
+            simplex[1] = glm::dot(ab, ab) > glm::dot(ac, ac) ? simplex[1] : simplex[2];
+            count = 2;
+            closest_on_segment(simplex, count, v);
+            return;
+        }
+
+        v = a + (vb / sum) * ab + (vc / sum) * ac;
+        count = 3;
+    }
+
+    /**
+     * Replaces the simplex with the smallest part of it that holds its point closest to the
+     * origin, and stores that point in v. Returns true if the origin lies inside a tetrahedron.
+     */
+    bool closest_on_simplex(Vertex* simplex, unsigned& count, glm::vec3& v)
+    {
+        if (count == 1) {
+            v = simplex[0].w;
+            return false;
+        }
+
+        if (count == 2) {
+            closest_on_segment(simplex, count, v);
+            return false;
+        }
+
+        if (count == 3) {
+            closest_on_triangle(simplex, count, v);
+            return false;
+        }
+
+        static const unsigned FACES[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+        float volume = glm::dot(glm::cross(simplex[1].w - simplex[0].w, simplex[2].w - simplex[0].w), simplex[3].w - simplex[0].w);
+        float best = std::numeric_limits<float>::max();
+        Vertex closest[3];
+        unsigned closest_count = 0;
+
+        for (const unsigned* face : FACES) {
+            const glm::vec3& a = simplex[face[0]].w;
+            glm::vec3 n = glm::cross(simplex[face[1]].w - a, simplex[face[2]].w - a);
+            float origin_side = -glm::dot(n, a);
+            float opposite_side = glm::dot(n, simplex[face[3]].w - a);
+
+            // a flat tetrahedron cannot hold the origin, so check all of its faces
+            if (volume != 0.0f && origin_side * opposite_side >= 0.0f) {
+                continue;
+            }
+
+            Vertex candidate[3] = { simplex[face[0]], simplex[face[1]], simplex[face[2]] };
+            unsigned candidate_count = 3;
+            glm::vec3 p;
+            closest_on_triangle(candidate, candidate_count, p);
+
+            if (glm::dot(p, p) < best) {
+                best = glm::dot(p, p);
+                v = p;
+                std::copy(candidate, candidate + candidate_count, closest);
+                closest_count = candidate_count;
+            }
+        }
+
+        if (closest_count == 0) {
+            v = glm::vec3(0.0f);
+            return true;
+        }
+
+        std::copy(closest, closest + closest_count, simplex);
+        count = closest_count;
+        return false;
+    }
+
+    bool same_vertex(const Vertex& x, const Vertex& y)
+    {
+        return x.hull == y.hull && x.corner == y.corner;
+    }
+
+    /**
+     * Grows a simplex touching the origin into a tetrahedron around it for EPA,
+     * by adding support points in directions the simplex does not span yet.
+     */
+    bool complete_tetrahedron(Pair& pair, Vertex* simplex, unsigned& count, float scale)
+    {
+        static const glm::vec3 AXES[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+
+        while (count < 4) {
+            glm::vec3 directions[6];
+            unsigned num_directions = 0;
+
+            if (count == 1) {
+                for (const glm::vec3& axis : AXES) {
+                    directions[num_directions++] = axis;
+                    directions[num_directions++] = -axis;
+                }
+            } else if (count == 2) {
+                glm::vec3 edge = simplex[1].w - simplex[0].w;
+
+                for (const glm::vec3& axis : AXES) {
+                    glm::vec3 normal = glm::cross(edge, axis);
+
+                    if (glm::dot(normal, normal) > GJK_TOLERANCE * glm::dot(edge, edge)) {
+                        directions[num_directions++] = normal;
+                        directions[num_directions++] = -normal;
+                    }
+                }
+            } else {
+                glm::vec3 normal = glm::cross(simplex[1].w - simplex[0].w, simplex[2].w - simplex[0].w);
+                directions[num_directions++] = normal;
+                directions[num_directions++] = -normal;
+            }
+
+            bool grown = false;
+
+            for (unsigned i = 0; i < num_directions && !grown; i++) {
+                Vertex w = pair.support(directions[i]);
+
+                // only accept points that leave the line or plane of the simplex
+                if (glm::dot(w.w - simplex[0].w, glm::normalize(directions[i])) > GJK_TOLERANCE * scale) {
+                    simplex[count++] = w;
+                    grown = true;
+                }
+            }
+
+            if (!grown) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    struct Face {
+        unsigned v[3];
+        glm::vec3 normal;
+        float distance;
+        bool alive;
+    };
+
+    void make_face(Face& face, const Vertex* vertices, unsigned a, unsigned b, unsigned c)
+    {
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        face.alive = true;
+        glm::vec3 n = glm::cross(vertices[b].w - vertices[a].w, vertices[c].w - vertices[a].w);
+        float length = glm::length(n);
+
+        if (length > 0.0f) {
+            face.normal = n / length;
+            face.distance = glm::dot(face.normal, vertices[a].w);
+        } else {
+            face.normal = glm::vec3(0.0f);
+            face.distance = std::numeric_limits<float>::max();
+        }
+    }
+
+    /**
+     * Expands the tetrahedron around the origin towards the boundary of the Minkowski
+     * difference until it finds the face closest to the origin.
+     */
+    void expand_polytope(Pair& pair, const Vertex* simplex, float scale, ConvexContact& contact, unsigned& iterations)
+    {
+        Vertex vertices[MAX_EPA_VERTICES];
+        Face faces[MAX_EPA_FACES];
+        unsigned edges[MAX_EPA_EDGES][2];
+        unsigned num_vertices = 4, num_faces = 4;
+
+        std::copy(simplex, simplex + 4, vertices);
+
+        // wind the faces so their normals point away from the fourth vertex
+        if (glm::dot(glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w), vertices[3].w - vertices[0].w) > 0.0f) {
+            std::swap(vertices[1], vertices[2]);
+        }
+
+        make_face(faces[0], vertices, 0, 1, 2);
+        make_face(faces[1], vertices, 0, 3, 1);
+        make_face(faces[2], vertices, 1, 3, 2);
+        make_face(faces[3], vertices, 2, 3, 0);
+
+        const Face* closest = nullptr;
+
+        for (unsigned iteration = 0; ; iteration++) {
+            closest = nullptr;
+
+            for (unsigned f = 0; f < num_faces; f++) {
+                if (faces[f].alive && (!closest || faces[f].distance < closest->distance)) {
+                    closest = &faces[f];
+                }
+            }
+
+            if (!closest || iteration == MAX_EPA_ITERATIONS || num_vertices == MAX_EPA_VERTICES) {
+                break;
+            }
+
+            iterations++;
+            Vertex w = pair.support(closest->normal);
+
+            if (glm::dot(w.w, closest->normal) - closest->distance <= EPA_TOLERANCE * scale) {
+                break;
+            }
+
+            // carve out every face the new point sees, keeping the edges around the hole
+            unsigned num_edges = 0;
+            bool overflow = false;
+
+            for (unsigned f = 0; f < num_faces; f++) {
+                Face& face = faces[f];
+
+                if (!face.alive || glm::dot(face.normal, w.w - vertices[face.v[0]].w) <= 0.0f) {
+                    continue;
+                }
+
+                face.alive = false;
+
+                for (unsigned e = 0; e < 3; e++) {
+                    unsigned from = face.v[e], to = face.v[(e + 1) % 3];
+                    unsigned k = 0;
+
+                    while (k < num_edges && !(edges[k][0] == to && edges[k][1] == from)) {
+                        k++;
+                    }
+
+                    if (k < num_edges) {
+                        edges[k][0] = edges[num_edges - 1][0];
+                        edges[k][1] = edges[num_edges - 1][1];
+                        num_edges--;
+                    } else if (num_edges < MAX_EPA_EDGES) {
+                        edges[num_edges][0] = from;
+                        edges[num_edges][1] = to;
+                        num_edges++;
+                    } else {
+                        overflow = true;
+                    }
+                }
+            }
+
+            // drop dead faces to make room for the new ones
+            unsigned alive = 0;
+
+            for (unsigned f = 0; f < num_faces; f++) {
+                if (faces[f].alive) {
+                    faces[alive++] = faces[f];
+                }
+            }
+
+            num_faces = alive;
+
+            if (overflow || num_faces + num_edges > MAX_EPA_FACES) {
+                break;
+            }
+
+            vertices[num_vertices] = w;
+
+            for (unsigned e = 0; e < num_edges; e++) {
+                make_face(faces[num_faces++], vertices, edges[e][0], edges[e][1], num_vertices);
+            }
+
+            num_vertices++;
+        }
+
+        // the closest point of the face to the origin, in barycentric coordinates, carried over to the triangle
+        if (!closest) {
+            contact.normal = glm::vec3(0.0f);
+            contact.depth = 0.0f;
+            contact.point = vertices[0].b;
+            return;
+        }
+
+        const Vertex& a = vertices[closest->v[0]];
+        const Vertex& b = vertices[closest->v[1]];
+        const Vertex& c = vertices[closest->v[2]];
+        glm::vec3 p = closest->normal * closest->distance;
+        glm::vec3 v0 = b.w - a.w, v1 = c.w - a.w, v2 = p - a.w;
+        float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+        float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+        float denominator = d00 * d11 - d01 * d01;
+        float u = 0.0f, v = 0.0f;
+
+        if (denominator > 0.0f) {
+            u = glm::clamp((d11 * d20 - d01 * d21) / denominator, 0.0f, 1.0f);
+            v = glm::clamp((d00 * d21 - d01 * d20) / denominator, 0.0f, 1.0f - u);
+        }
+
+        contact.normal = -closest->normal;
+        contact.depth = glm::max(closest->distance, 0.0f);
+        contact.point = a.b + u * (b.b - a.b) + v * (c.b - a.b);
+    }
+}
+
+GjkSimplex::GjkSimplex() : count(0), hull_vertices{0, 0, 0, 0}, triangle_corners{0, 0, 0, 0}
+{
+}
+
+bool convex_triangle_contact(const ConvexHull& hull, const glm::quat& orientation, const glm::vec3& position, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, GjkSimplex& cache, ConvexContact& contact, unsigned& iterations)
+{
+    Pair pair = { hull, orientation, glm::conjugate(orientation), position, { a, b, c } };
+    Vertex simplex[4];
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < cache.count && i < 4; i++) {
+        if (cache.hull_vertices[i] < hull.vertices().size() && cache.triangle_corners[i] < 3) {
+            simplex[count++] = pair.vertex(cache.hull_vertices[i], cache.triangle_corners[i]);
+        }
+    }
+
+    if (count == 0) {
+        glm::vec3 direction = (a + b + c) / 3.0f - position;
+        simplex[count++] = pair.support(glm::dot(direction, direction) > 0.0f ? direction : glm::vec3(1.0f, 0.0f, 0.0f));
+    }
+
+    float scale = hull.radius() + glm::max(glm::length(b - a), glm::max(glm::length(c - b), glm::length(a - c)));
+    bool overlap = false;
+    glm::vec3 v;
+
+    for (unsigned iteration = 0; iteration < MAX_GJK_ITERATIONS; iteration++) {
+        iterations++;
+
+        if (closest_on_simplex(simplex, count, v)) {
+            overlap = true;
+            break;
+        }
+
+        float v2 = glm::dot(v, v);
+
+        if (v2 <= GJK_TOLERANCE * GJK_TOLERANCE * scale * scale) {
+            overlap = true;
+            break;
+        }
+
+        Vertex w = pair.support(-v);
+
+        // a support plane with the origin in front of it separates the shapes, and a point
+        // already in the simplex means v is as close as the shapes get
+        if (glm::dot(v, w.w) > 0.0f || v2 - glm::dot(v, w.w) <= GJK_TOLERANCE * v2) {
+            break;
+        }
+
+        bool duplicate = false;
+
+        for (unsigned i = 0; i < count; i++) {
+            duplicate = duplicate || same_vertex(simplex[i], w);
+        }
+
+        if (duplicate) {
+            break;
+        }
+
+        simplex[count++] = w;
+    }
+
+    if (overlap && count < 4 && !complete_tetrahedron(pair, simplex, count, scale)) {
+        // the shapes only touch, with no volume to push out of
+        contact.normal = glm::normalize(glm::cross(b - a, c - a));
+        contact.depth = 0.0f;
+        contact.point = simplex[0].b;
+    } else if (overlap) {
+        expand_polytope(pair, simplex, scale, contact, iterations);
+    }
+
+    cache.count = count;
+
+    for (unsigned i = 0; i < count; i++) {
+        cache.hull_vertices[i] = simplex[i].hull;
+        cache.triangle_corners[i] = simplex[i].corner;
+    }
+
+    return overlap;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include "convex_hull.h"
+
+/**
+ * @brief The simplex a GJK query ended with, kept to start the next query on the same pair from.
+ *
+ * Points are stored as indices, so the simplex stays valid while the hull moves: a query
+ * rebuilds the points at the current pose and usually finishes in one or two iterations.
+ */
+struct GjkSimplex {
+    GjkSimplex();
+
+    unsigned count; // 0 starts from scratch
+    unsigned hull_vertices[4];
+    unsigned triangle_corners[4];
+};
+
+struct ConvexContact {
+    unsigned triangle; // index into CollisionMesh::triangles()
+    glm::vec3 normal; // points from the triangle towards the hull
+    float depth; // moving the hull depth along normal separates them
+    glm::vec3 point; // the deepest point on the triangle
+};
+
+/**
+ * @brief Tests hull, rotated by orientation and moved to position, against triangle abc with GJK.
+ *
+ * If they overlap, EPA finds the shortest translation that separates them. Contact::triangle
+ * is left to the caller.
+ *
+ * @param simplex The simplex this pair ended with last time, or an empty one. Receives the new one.
+ * @param iterations Incremented by the number of GJK and EPA iterations.
+ * @return Whether the hull and the triangle overlap.
+ */
+bool convex_triangle_contact(const ConvexHull& hull, const glm::quat& orientation, const glm::vec3& position, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, GjkSimplex& simplex, ConvexContact& contact, unsigned& iterations);
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <stdexcept>
+
+#include "heightfield_collider.h"
+
+namespace {
+    const unsigned QUANTIZED_MAX = 0x7FFF; // the low bit of every sample holds the diagonal
+
+    // corners of a cell, numbered by their offset from its lowest corner
+    const unsigned CORNER_00 = 0;
+    const unsigned CORNER_10 = 1;
+    const unsigned CORNER_01 = 2;
+    const unsigned CORNER_11 = 3;
+
+    bool clip_slab(float O, float D, float min, float max, float& t_enter, float& t_exit)
+    {
+        if (D == 0.0f) {
+            return O >= min && O <= max;
+        }
+
+        float t0 = (min - O) / D;
+        float t1 = (max - O) / D;
+        t_enter = std::max(t_enter, std::min(t0, t1));
+        t_exit = std::min(t_exit, std::max(t0, t1));
+        return t_enter <= t_exit;
+    }
+}
+
+HeightfieldCollider::HeightfieldCollider() : m_origin(0.0f), m_spacing_x(0.0f), m_spacing_z(0.0f), m_columns(0), m_rows(0), m_min_height(0.0f), m_max_height(0.0f), m_height_step(0.0f)
+{
+}
+
+HeightfieldCollider::HeightfieldCollider(const glm::vec3& origin, float spacing_x, float spacing_z, unsigned columns, unsigned rows, const std::vector<float>& heights) :
+    m_origin(origin.x, 0.0f, origin.z), m_spacing_x(spacing_x), m_spacing_z(spacing_z), m_columns(columns), m_rows(rows)
+{
+    if (columns < 2 || rows < 2 || !(spacing_x > 0.0f) || !(spacing_z > 0.0f)) {
+        throw std::invalid_argument("A heightfield needs at least 2x2 samples with positive spacing");
+    }
+
+    if (heights.size() != static_cast<std::size_t>(columns) * rows) {
+        throw std::invalid_argument("Expected columns * rows heights");
+    }
+
+    encode(heights, std::vector<bool>(heights.size(), false));
+}
+
+bool HeightfieldCollider::from_mesh(const CollisionMesh& mesh, HeightfieldCollider& heightfield)
+{
+    const TriangleSoA& triangles = mesh.triangles();
+    std::size_t num_triangles = triangles.size();
+
+    if (num_triangles < 2) {
+        return false;
+    }
+
+    AABB bounds;
+
+    for (std::size_t i = 0; i < num_triangles; i++) {
+        Triangle triangle = triangles.triangle(i);
+        bounds.grow(triangle.points[0]);
+        bounds.grow(triangle.points[1]);
+        bounds.grow(triangle.points[2]);
+    }
+
+    // the spacing is the shortest step along each axis that is not rounding noise
+    glm::vec3 extent = bounds.extent();
+    float noise = 1.0e-5f * std::max(extent.x, extent.z);
+    float spacing_x = std::numeric_limits<float>::max();
+    float spacing_z = std::numeric_limits<float>::max();
+
+    for (std::size_t i = 0; i < num_triangles; i++) {
+        Triangle triangle = triangles.triangle(i);
+
+        for (int j = 0; j < 3; j++) {
+            float dx = std::abs(triangle.points[(j + 1) % 3].x - triangle.points[j].x);
+            float dz = std::abs(triangle.points[(j + 1) % 3].z - triangle.points[j].z);
+
+            if (dx > noise) spacing_x = std::min(spacing_x, dx);
+            if (dz > noise) spacing_z = std::min(spacing_z, dz);
+        }
+    }
+
+    if (spacing_x == std::numeric_limits<float>::max() || spacing_z == std::numeric_limits<float>::max()) {
+        return false;
+    }
+
+    // every sample lies on the lattice, so the extent is a whole number of cells
+    double cells_x = std::round(extent.x / spacing_x);
+    double cells_z = std::round(extent.z / spacing_z);
+
+    if (cells_x * cells_z * 2.0 != static_cast<double>(num_triangles)) {
+        return false;
+    }
+
+    unsigned columns = static_cast<unsigned>(cells_x) + 1;
+    unsigned rows = static_cast<unsigned>(cells_z) + 1;
+    spacing_x = extent.x / static_cast<float>(cells_x);
+    spacing_z = extent.z / static_cast<float>(cells_z);
+    float tolerance = 1.0e-3f * std::min(spacing_x, spacing_z);
+
+    std::vector<float> heights(static_cast<std::size_t>(columns) * rows, std::numeric_limits<float>::quiet_NaN());
+    std::vector<unsigned char> missing_corners((columns - 1) * (rows - 1), 0);
+
+    for (std::size_t i = 0; i < num_triangles; i++) {
+        // the grid has to face up, since triangles are one-sided
+        if (!(triangles.normal(i).y > 0.0f)) {
+            return false;
+        }
+
+        Triangle triangle = triangles.triangle(i);
+        unsigned column[3];
+        unsigned row[3];
+
+        for (int j = 0; j < 3; j++) {
+            const glm::vec3& p = triangle.points[j];
+            float gx = (p.x - bounds.min.x) / spacing_x;
+            float gz = (p.z - bounds.min.z) / spacing_z;
+            float ix = std::round(gx);
+            float iz = std::round(gz);
+
+            if (std::abs(gx - ix) * spacing_x > tolerance || std::abs(gz - iz) * spacing_z > tolerance) {
+                return false;
+            }
+
+            column[j] = static_cast<unsigned>(ix);
+            row[j] = static_cast<unsigned>(iz);
+            float& height = heights[row[j] * columns + column[j]];
+
+            if (std::isnan(height)) {
+                height = p.y;
+            } else if (std::abs(height - p.y) > tolerance) {
+                return false;
+            }
+        }
+
+        unsigned cell_column = std::min({ column[0], column[1], column[2] });
+        unsigned cell_row = std::min({ row[0], row[1], row[2] });
+
+        if (cell_column == columns - 1 || cell_row == rows - 1) {
+            return false;
+        }
+
+        unsigned corners = 0;
+
+        for (int j = 0; j < 3; j++) {
+            unsigned local_column = column[j] - cell_column;
+            unsigned local_row = row[j] - cell_row;
+
+            if (local_column > 1 || local_row > 1) {
+                return false;
+            }
+
+            corners |= 1u << (local_row * 2 + local_column);
+        }
+
+        unsigned missing = corners ^ 0xFu;
+        unsigned char& cell = missing_corners[cell_row * (columns - 1) + cell_column];
+
+        // three distinct corners leave exactly one missing, and each half of a cell appears once
+        if ((missing & (missing - 1)) != 0 || (cell & missing) != 0) {
+            return false;
+        }
+
+        cell |= missing;
+    }
+
+    std::vector<bool> anti_diagonal(heights.size(), false);
+
+    for (unsigned row = 0; row < rows - 1; row++) {
+        for (unsigned column = 0; column < columns - 1; column++) {
+            unsigned char cell = missing_corners[row * (columns - 1) + column];
+
+            if (cell == ((1u << CORNER_00) | (1u << CORNER_11))) {
+                anti_diagonal[row * columns + column] = true;
+            } else if (cell != ((1u << CORNER_10) | (1u << CORNER_01))) {
+                return false;
+            }
+        }
+    }
+
+    heightfield.m_origin = glm::vec3(bounds.min.x, 0.0f, bounds.min.z);
+    heightfield.m_spacing_x = spacing_x;
+    heightfield.m_spacing_z = spacing_z;
+    heightfield.m_columns = columns;
+    heightfield.m_rows = rows;
+    heightfield.encode(heights, anti_diagonal);
+    return true;
+}
+
+unsigned HeightfieldCollider::columns() const
+{
+    return m_columns;
+}
+
+unsigned HeightfieldCollider::rows() const
+{
+    return m_rows;
+}
+
+std::size_t HeightfieldCollider::memory_usage() const
+{
+    return m_samples.size() * sizeof(std::uint16_t);
+}
+
+bool HeightfieldCollider::height_at(float x, float z, float& height) const
+{
+    glm::vec3 normal;
+    return height_at(x, z, height, normal);
+}
+
+bool HeightfieldCollider::height_at(float x, float z, float& height, glm::vec3& normal) const
+{
+    float gx = (x - m_origin.x) / m_spacing_x;
+    float gz = (z - m_origin.z) / m_spacing_z;
+
+    if (!(gx >= 0.0f && gx <= m_columns - 1.0f && gz >= 0.0f && gz <= m_rows - 1.0f)) {
+        return false;
+    }
+
+    // points on the far edges belong to the last cell
+    unsigned column = std::min(static_cast<unsigned>(gx), m_columns - 2);
+    unsigned row = std::min(static_cast<unsigned>(gz), m_rows - 2);
+    float fx = gx - column;
+    float fz = gz - row;
+    bool second_half = anti_diagonal(column, row) ? fx + fz > 1.0f : fz > fx;
+
+    Triangle triangle = this->triangle(column, row, second_half ? 1 : 0);
+    const glm::vec3& a = triangle.points[0];
+    glm::vec3 N = glm::cross(triangle.points[1] - a, triangle.points[2] - a);
+
+    height = a.y - (N.x * (x - a.x) + N.z * (z - a.z)) / N.y;
+    normal = glm::normalize(N);
+    return true;
+}
+
+bool HeightfieldCollider::snap_to_ground(glm::vec3& position, float max_distance) const
+{
+    float height;
+
+    if (!height_at(position.x, position.z, height) || position.y - height > max_distance) {
+        return false;
+    }
+
+    position.y = height;
+    return true;
+}
+
+bool HeightfieldCollider::raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const
+{
+    if (m_samples.empty() || D == glm::vec3(0.0f)) {
+        return false;
+    }
+
+    float max_x = m_origin.x + (m_columns - 1) * m_spacing_x;
+    float max_z = m_origin.z + (m_rows - 1) * m_spacing_z;
+    float t = 0.0f;
+    float t_exit = max_t;
+
+    if (!clip_slab(O.x, D.x, m_origin.x, max_x, t, t_exit) ||
+        !clip_slab(O.y, D.y, m_min_height, m_max_height, t, t_exit) ||
+        !clip_slab(O.z, D.z, m_origin.z, max_z, t, t_exit)) {
+        return false;
+    }
+
+    // walk the cells the ray passes over in order, so the first cell with a hit has the closest one
+    glm::vec3 start = O + t * D;
+    unsigned column = std::min(static_cast<unsigned>(std::max((start.x - m_origin.x) / m_spacing_x, 0.0f)), m_columns - 2);
+    unsigned row = std::min(static_cast<unsigned>(std::max((start.z - m_origin.z) / m_spacing_z, 0.0f)), m_rows - 2);
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    int step_x = D.x > 0.0f ? 1 : (D.x < 0.0f ? -1 : 0);
+    int step_z = D.z > 0.0f ? 1 : (D.z < 0.0f ? -1 : 0);
+    float t_delta_x = step_x != 0 ? m_spacing_x / std::abs(D.x) : infinity;
+    float t_delta_z = step_z != 0 ? m_spacing_z / std::abs(D.z) : infinity;
+    float t_next_x = step_x != 0 ? (m_origin.x + (column + (step_x > 0 ? 1 : 0)) * m_spacing_x - O.x) / D.x : infinity;
+    float t_next_z = step_z != 0 ? (m_origin.z + (row + (step_z > 0 ? 1 : 0)) * m_spacing_z - O.z) / D.z : infinity;
+
+    while (true) {
+        float t_cell_exit = std::min(std::min(t_next_x, t_next_z), t_exit);
+
+        if (intersect_cell(column, row, O, D, t, t_cell_exit, max_t, hit)) {
+            hit.point = O + hit.t * D;
+            return true;
+        }
+
+        if (t_cell_exit >= t_exit) {
+            return false;
+        }
+
+        if (t_next_x < t_next_z) {
+            if ((step_x < 0 && column == 0) || (step_x > 0 && column == m_columns - 2)) {
+                return false;
+            }
+
+            column += step_x;
+            t = t_next_x;
+            t_next_x += t_delta_x;
+        } else {
+            if ((step_z < 0 && row == 0) || (step_z > 0 && row == m_rows - 2)) {
+                return false;
+            }
+
+            row += step_z;
+            t = t_next_z;
+            t_next_z += t_delta_z;
+        }
+    }
+}
+
+bool HeightfieldCollider::segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const
+{
+    return raycast(P, displacement, 1.0f, hit);
+}
+
+void HeightfieldCollider::encode(const std::vector<float>& heights, const std::vector<bool>& anti_diagonal)
+{
+    auto range = std::minmax_element(heights.begin(), heights.end());
+    m_min_height = *range.first;
+    m_max_height = *range.second;
+    m_height_step = (m_max_height - m_min_height) / QUANTIZED_MAX;
+    m_samples.resize(heights.size());
+
+    for (std::size_t i = 0; i < heights.size(); i++) {
+        unsigned q = m_height_step > 0.0f ? static_cast<unsigned>(std::lround((heights[i] - m_min_height) / m_height_step)) : 0;
+        q = std::min(q, QUANTIZED_MAX);
+        m_samples[i] = static_cast<std::uint16_t>((q << 1) | (anti_diagonal[i] ? 1 : 0));
+    }
+}
+
+glm::vec3 HeightfieldCollider::sample(unsigned column, unsigned row) const
+{
+    std::uint16_t s = m_samples[row * m_columns + column];
+    return glm::vec3(m_origin.x + column * m_spacing_x, m_min_height + (s >> 1) * m_height_step, m_origin.z + row * m_spacing_z);
+}
+
+bool HeightfieldCollider::anti_diagonal(unsigned column, unsigned row) const
+{
+    return (m_samples[row * m_columns + column] & 1) != 0;
+}
+
+Triangle HeightfieldCollider::triangle(unsigned column, unsigned row, unsigned half) const
+{
+    glm::vec3 corners[4] = { sample(column, row), sample(column + 1, row), sample(column, row + 1), sample(column + 1, row + 1) };
+
+    // wound so that the normal points up
+    if (anti_diagonal(column, row)) {
+        return half == 0 ? Triangle(corners[CORNER_00], corners[CORNER_01], corners[CORNER_10])
+                         : Triangle(corners[CORNER_10], corners[CORNER_01], corners[CORNER_11]);
+    }
+
+    return half == 0 ? Triangle(corners[CORNER_00], corners[CORNER_11], corners[CORNER_10])
+                     : Triangle(corners[CORNER_00], corners[CORNER_01], corners[CORNER_11]);
+}
+
+bool HeightfieldCollider::intersect_cell(unsigned column, unsigned row, const glm::vec3& O, const glm::vec3& D, float t_enter, float t_exit, float& max_t, RaycastHit& hit) const
+{
+    unsigned first = row * m_columns + column;
+    std::uint16_t samples[4] = { m_samples[first], m_samples[first + 1], m_samples[first + m_columns], m_samples[first + m_columns + 1] };
+    float cell_min = m_min_height + (std::min({ samples[0], samples[1], samples[2], samples[3] }) >> 1) * m_height_step;
+    float cell_max = m_min_height + (std::max({ samples[0], samples[1], samples[2], samples[3] }) >> 1) * m_height_step;
+    float y_enter = O.y + t_enter * D.y;
+    float y_exit = O.y + t_exit * D.y;
+
+    if (std::min(y_enter, y_exit) > cell_max || std::max(y_enter, y_exit) < cell_min) {
+        return false;
+    }
+
+    bool found = false;
+
+    for (unsigned half = 0; half < 2; half++) {
+        Triangle triangle = this->triangle(column, row, half);
+        float t;
+
+        if (intersect_triangle(O, D, triangle.points[0], triangle.points[1], triangle.points[2], max_t, t)) {
+            const glm::vec3& a = triangle.points[0];
+            max_t = t;
+            hit.t = t;
+            hit.triangle = 2 * (row * (m_columns - 1) + column) + half;
+            hit.normal = glm::normalize(glm::cross(triangle.points[1] - a, triangle.points[2] - a));
+            found = true;
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "collision_mesh.h"
+
+/**
+ * @brief Collision against a terrain given as heights on a regular grid in the xz plane.
+ *
+ * Every cell is split into two triangles along one of its diagonals, facing up (+y).
+ * Samples take 2 bytes each: 15 bits of quantized height and 1 bit selecting the
+ * diagonal of the cell whose lowest corner the sample is, so heights are within
+ * (max - min) / 65534 of the originals. Point queries look up a single cell, and
+ * segment casts only visit the cells under the segment.
+ *
+ * Triangles are numbered 2 * cell for the half that contains the cell's edge at its
+ * lowest z and 2 * cell + 1 for the other half, where cell = row * (columns - 1) + column.
+ */
+class HeightfieldCollider {
+public:
+    HeightfieldCollider();
+
+    /**
+     * @param origin The position of sample (0, 0). Its y coordinate is ignored.
+     * @param spacing_x The distance between neighbouring samples along x.
+     * @param spacing_z The distance between neighbouring samples along z.
+     * @param columns The number of samples along x. Must be at least 2.
+     * @param rows The number of samples along z. Must be at least 2.
+     * @param heights columns * rows heights, row by row. Every cell is split along its diagonal
+     * from (column, row) to (column + 1, row + 1).
+     */
+    HeightfieldCollider(const glm::vec3& origin, float spacing_x, float spacing_z, unsigned columns, unsigned rows, const std::vector<float>& heights);
+
+    /**
+     * @brief Converts mesh into a heightfield if its triangles form an upward-facing regular grid.
+     *
+     * @return Whether mesh was a grid. heightfield is only modified if it was.
+     */
+    static bool from_mesh(const CollisionMesh& mesh, HeightfieldCollider& heightfield);
+
+    unsigned columns() const;
+    unsigned rows() const;
+    std::size_t memory_usage() const;
+
+    /**
+     * @brief Finds the height of the surface above or below the point (x, z).
+     *
+     * @return Whether the point lies over the grid.
+     */
+    bool height_at(float x, float z, float& height) const;
+    bool height_at(float x, float z, float& height, glm::vec3& normal) const;
+
+    /**
+     * @brief Moves position onto the surface if it is at most max_distance above it, or below it.
+     *
+     * @return Whether position was snapped.
+     */
+    bool snap_to_ground(glm::vec3& position, float max_distance) const;
+
+    /**
+     * @brief Same as CollisionMesh::raycast(), walking the grid cells under the ray in order.
+     */
+    bool raycast(const glm::vec3& O, const glm::vec3& D, float max_t, RaycastHit& hit) const;
+    bool segment_cast(const glm::vec3& P, const glm::vec3& displacement, RaycastHit& hit) const;
+private:
+    void encode(const std::vector<float>& heights, const std::vector<bool>& anti_diagonal);
+
+    glm::vec3 sample(unsigned column, unsigned row) const;
+    bool anti_diagonal(unsigned column, unsigned row) const;
+    Triangle triangle(unsigned column, unsigned row, unsigned half) const;
+    bool intersect_cell(unsigned column, unsigned row, const glm::vec3& O, const glm::vec3& D, float t_enter, float t_exit, float& max_t, RaycastHit& hit) const;
+
+    std::vector<std::uint16_t> m_samples;
+    glm::vec3 m_origin;
+    float m_spacing_x;
+    float m_spacing_z;
+    unsigned m_columns;
+    unsigned m_rows;
+    float m_min_height;
+    float m_max_height;
+    float m_height_step;
+};
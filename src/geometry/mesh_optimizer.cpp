@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <glm/geometric.hpp>
+
+#include "mesh_optimizer.h"
+
+namespace {
+    const unsigned NOT_USED = ~0u;
+
+    // a FIFO cache: a vertex is cached while fewer than cache_size misses happened since it was loaded
+    class CacheSimulation {
+    public:
+        CacheSimulation(std::size_t num_vertices, unsigned cache_size) :
+            m_loaded(num_vertices, 0), m_time(cache_size + 1), m_cache_size(cache_size)
+        {
+        }
+
+        void reset()
+        {
+            m_time += m_cache_size + 1;
+        }
+
+        unsigned access(unsigned v)
+        {
+            if (m_time - m_loaded[v] > m_cache_size) {
+                m_loaded[v] = m_time++;
+                return 1;
+            }
+
+            return 0;
+        }
+
+        unsigned access(const unsigned* triangle)
+        {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+    private:
+        std::vector<std::size_t> m_loaded; // the miss count when each vertex was loaded
+        std::size_t m_time;
+        unsigned m_cache_size;
+    };
+}
+
+VertexCacheStats analyze_vertex_cache(ArrayView<unsigned> elements, std::size_t num_vertices, unsigned cache_size)
+{
+    CacheSimulation cache(num_vertices, cache_size);
+    std::vector<unsigned char> used(num_vertices, 0);
+    std::size_t num_used = 0;
+    VertexCacheStats stats;
+    stats.vertices_transformed = 0;
+
+    for (std::size_t i = 0; i < elements.size(); i += 3) {
+        stats.vertices_transformed += cache.access(&elements[i]);
+
+        for (unsigned corner = 0; corner < 3; corner++) {
+            num_used += !used[elements[i + corner]];
+            used[elements[i + corner]] = 1;
+        }
+    }
+
+    stats.acmr = elements.empty() ? 0.0f : static_cast<float>(stats.vertices_transformed) / (elements.size() / 3);
+    stats.atvr = num_used == 0 ? 0.0f : static_cast<float>(stats.vertices_transformed) / num_used;
+    return stats;
+}
+
+void optimize_vertex_cache(std::vector<unsigned>& elements, std::size_t num_vertices, unsigned cache_size)
+{
+    std::size_t num_triangles = elements.size() / 3;
+
+    // the triangles around every vertex, and how many of them are not emitted yet
+    std::vector<unsigned> offsets(num_vertices + 1, 0);
+
+    for (unsigned v : elements) {
+        offsets[v + 1]++;
+    }
+
+    for (std::size_t v = 0; v < num_vertices; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<unsigned> adjacent(elements.size());
+    std::vector<unsigned> live(num_vertices);
+    std::vector<unsigned> cursor(offsets.begin(), offsets.end() - 1);
+
+    for (std::size_t i = 0; i < elements.size(); i++) {
+        adjacent[cursor[elements[i]]++] = static_cast<unsigned>(i / 3);
+    }
+
+    for (std::size_t v = 0; v < num_vertices; v++) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+
+    std::vector<std::size_t> loaded(num_vertices, 0);
+    std::size_t time = cache_size + 1;
+    std::vector<unsigned char> emitted(num_triangles, 0);
+    std::vector<unsigned> dead_ends, candidates, result;
+    result.reserve(elements.size());
+    std::size_t scan = 0;
+    unsigned fan = num_triangles > 0 ? elements[0] : NOT_USED;
+
+    while (fan != NOT_USED) {
+        candidates.clear();
+
+        for (unsigned i = offsets[fan]; i < offsets[fan + 1]; i++) {
+            unsigned triangle = adjacent[i];
+
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            emitted[triangle] = 1;
+
+            for (unsigned corner = 0; corner < 3; corner++) {
+                unsigned v = elements[3 * triangle + corner];
+                result.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+
+                if (time - loaded[v] > cache_size) {
+                    loaded[v] = time++;
+                }
+            }
+        }
+
+        // prefer the candidate that has been in the cache longest yet will still be there after its fan
+        fan = NOT_USED;
+        std::size_t best_priority = 0;
+
+        for (unsigned v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+
+            std::size_t priority = time - loaded[v] + 2 * live[v] <= cache_size ? time - loaded[v] : 0;
+
+            if (fan == NOT_USED || priority > best_priority) {
+                fan = v;
+                best_priority = priority;
+            }
+        }
+
+        // otherwise back up to a recently used vertex with triangles left, or the next one in input order
+        while (fan == NOT_USED && !dead_ends.empty()) {
+            unsigned v = dead_ends.back();
+            dead_ends.pop_back();
+
+            if (live[v] > 0) {
+                fan = v;
+            }
+        }
+
+        while (fan == NOT_USED && scan < elements.size()) {
+            if (live[elements[scan]] > 0) {
+                fan = elements[scan];
+            }
+
+            scan++;
+        }
+    }
+
+    elements.swap(result);
+}
+
+void optimize_overdraw(ArrayView<glm::vec3> positions, std::vector<unsigned>& elements, float threshold, unsigned cache_size)
+{
+    std::size_t num_triangles = elements.size() / 3;
+
+    if (num_triangles == 0) {
+        return;
+    }
+
+    // hard boundaries are where the cache order jumped to triangles sharing nothing with the cache
+    CacheSimulation cache(positions.size(), cache_size);
+    std::vector<std::size_t> hard;
+
+    for (std::size_t t = 0; t < num_triangles; t++) {
+        if (cache.access(&elements[3 * t]) == 3) {
+            hard.push_back(t);
+        }
+    }
+
+    hard.push_back(num_triangles);
+
+    // soft boundaries split clusters wherever their miss ratio so far stays close to the whole cluster's
+    std::vector<std::size_t> clusters;
+
+    for (std::size_t h = 0; h + 1 < hard.size(); h++) {
+        std::size_t begin = hard[h], end = hard[h + 1];
+        cache.reset();
+        std::size_t cluster_misses = 0;
+
+        for (std::size_t t = begin; t < end; t++) {
+            cluster_misses += cache.access(&elements[3 * t]);
+        }
+
+        float cluster_acmr = static_cast<float>(cluster_misses) / (end - begin);
+        cache.reset();
+        clusters.push_back(begin);
+        std::size_t start = begin, misses = 0;
+
+        for (std::size_t t = begin; t < end; t++) {
+            misses += cache.access(&elements[3 * t]);
+
+            if (t + 1 < end && misses <= threshold * cluster_acmr * (t + 1 - start)) {
+                clusters.push_back(t + 1);
+                cache.reset();
+                start = t + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    clusters.push_back(num_triangles);
+
+    // clusters facing out of the mesh's center come first
+    glm::vec3 mesh_center(0.0f);
+    float mesh_area = 0.0f;
+    std::vector<glm::vec3> centers(clusters.size() - 1), normals(clusters.size() - 1);
+
+    for (std::size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+
+        for (std::size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3& a = positions[elements[3 * t]];
+            const glm::vec3& b = positions[elements[3 * t + 1]];
+            const glm::vec3& d = positions[elements[3 * t + 2]];
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangle_area = glm::length(cross);
+            center += (a + b + d) * (triangle_area / 3.0f);
+            normal += cross;
+            area += triangle_area;
+        }
+
+        mesh_center += center;
+        mesh_area += area;
+        centers[c] = area > 0.0f ? center / area : positions[elements[3 * clusters[c]]];
+        normals[c] = area > 0.0f ? normal / area : normal;
+    }
+
+    if (mesh_area > 0.0f) {
+        mesh_center /= mesh_area;
+    }
+
+    std::vector<float> keys(centers.size());
+    std::vector<unsigned> order(centers.size());
+
+    for (std::size_t c = 0; c < centers.size(); c++) {
+        keys[c] = glm::dot(centers[c] - mesh_center, normals[c]);
+        order[c] = static_cast<unsigned>(c);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<unsigned> result;
+    result.reserve(elements.size());
+
+    for (unsigned c : order) {
+        result.insert(result.end(), elements.begin() + 3 * clusters[c], elements.begin() + 3 * clusters[c + 1]);
+    }
+
+    elements.swap(result);
+}
+
+std::vector<unsigned> optimize_vertex_fetch(std::vector<unsigned>& elements, std::size_t num_vertices)
+{
+    std::vector<unsigned> remap(num_vertices, NOT_USED);
+    std::vector<unsigned> order;
+
+    for (unsigned& v : elements) {
+        if (remap[v] == NOT_USED) {
+            remap[v] = static_cast<unsigned>(order.size());
+            order.push_back(v);
+        }
+
+        v = remap[v];
+    }
+
+    return order;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../utility/array_view.h"
+
+/**
+ * @brief The number of vertices the cache simulations keep. Larger than the FIFO of old GPUs, but orders tuned for it still do well on newer ones.
+ */
+const unsigned VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    std::size_t vertices_transformed; // cache misses
+    float acmr; // average cache miss ratio: vertices transformed per triangle, 0.5 at best and 3 at worst
+    float atvr; // average transformed vertex ratio: vertices transformed per vertex used, 1 at best
+};
+
+/**
+ * @brief Simulates a FIFO post-transform cache of cache_size vertices over the triangles in elements.
+ */
+VertexCacheStats analyze_vertex_cache(ArrayView<unsigned> elements, std::size_t num_vertices, unsigned cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorders the triangles in elements so consecutive triangles reuse transformed vertices.
+ *
+ * Uses Tipsy (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+ * Overdraw", 2007): it fans around one vertex at a time and moves on to the neighbour that is still
+ * in the cache and has the fewest triangles left, in linear time.
+ */
+void optimize_vertex_cache(std::vector<unsigned>& elements, std::size_t num_vertices, unsigned cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorders clusters of an optimize_vertex_cache() order so triangles facing out of the mesh come first.
+ *
+ * The order is cut where the cache order jumped, and wherever the cluster's miss ratio so far is
+ * within threshold of the whole cluster's, so the cache suffers at most about that factor. Clusters
+ * whose normals point away from the mesh's center are drawn first, so they tend to hide the rest.
+ */
+void optimize_overdraw(ArrayView<glm::vec3> positions, std::vector<unsigned>& elements, float threshold = 1.05f, unsigned cache_size = VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Renumbers the vertices in the order elements first uses them, so vertex fetches walk memory forwards.
+ *
+ * @return The old index of every new vertex. Vertices elements never uses are dropped.
+ */
+std::vector<unsigned> optimize_vertex_fetch(std::vector<unsigned>& elements, std::size_t num_vertices);
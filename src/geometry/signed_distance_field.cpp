@@ -0,0 +1,266 @@
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <stdexcept>
+
+#include "signed_distance_field.h"
+
+namespace {
+    const std::uint32_t KEEP = 0xFFFFFFFDu;
+    const unsigned SAMPLES_PER_BRICK = SignedDistanceField::BRICK_SAMPLES * SignedDistanceField::BRICK_SAMPLES * SignedDistanceField::BRICK_SAMPLES;
+
+    // barycentric coordinates this close to 0 put a closest point on an edge or vertex
+    const float FEATURE_TOLERANCE = 1.0e-4f;
+
+    /**
+     * The distance from P to the closest triangle, negative behind the surface. Points farther
+     * than max_distance only need their sign, so they fall back to an unbounded search.
+     */
+    float signed_distance(const CollisionMesh& mesh, const PseudoNormals& normals, const glm::vec3& P, float max_distance)
+    {
+        ClosestPoint closest;
+        float distance = max_distance;
+
+        if (!mesh.closest_point(P, max_distance, closest)) {
+            mesh.closest_point(P, std::numeric_limits<float>::infinity(), closest);
+        } else {
+            distance = closest.distance;
+        }
+
+        return normals.is_behind(P, closest) ? -distance : distance;
+    }
+}
+
+PseudoNormals::PseudoNormals(const CollisionMesh& mesh) :
+    m_mesh(mesh)
+{
+    ArrayView<glm::vec3> vertices = mesh.vertices();
+    ArrayView<unsigned> indices = mesh.indices();
+    ArrayView<unsigned> neighbours = mesh.neighbours();
+    const TriangleSoA& triangles = mesh.triangles();
+    m_vertices.assign(vertices.size(), glm::vec3(0.0f));
+    m_edges.resize(indices.size());
+
+    // only the sign of a dot product with them is ever needed, so none of the sums are normalized
+    for (std::size_t i = 0; i < triangles.size(); i++) {
+        glm::vec3 normal = triangles.normal(i);
+
+        for (unsigned k = 0; k < 3; k++) {
+            unsigned corner = indices[3 * i + k];
+            glm::vec3 to_next = glm::normalize(vertices[indices[3 * i + (k + 1) % 3]] - vertices[corner]);
+            glm::vec3 to_previous = glm::normalize(vertices[indices[3 * i + (k + 2) % 3]] - vertices[corner]);
+            m_vertices[corner] += std::acos(glm::clamp(glm::dot(to_next, to_previous), -1.0f, 1.0f)) * normal;
+
+            unsigned neighbour = neighbours[3 * i + k];
+            m_edges[3 * i + k] = neighbour == CollisionMesh::NO_NEIGHBOUR ? normal : normal + triangles.normal(neighbour);
+        }
+    }
+}
+
+bool PseudoNormals::is_behind(const glm::vec3& P, const ClosestPoint& closest) const
+{
+    const TriangleSoA& triangles = m_mesh.triangles();
+    const unsigned* corners = &m_mesh.indices()[3 * closest.triangle];
+    std::size_t i = closest.triangle;
+
+    // the closest point's barycentric coordinates tell which feature of the triangle it is on
+    glm::vec3 e1 = triangles.edge1(i), e2 = triangles.edge2(i), q = closest.point - triangles.vertex(i);
+    float d11 = glm::dot(e1, e1), d12 = glm::dot(e1, e2), d22 = glm::dot(e2, e2);
+    float q1 = glm::dot(q, e1), q2 = glm::dot(q, e2);
+    float denominator = d11 * d22 - d12 * d12;
+    float v = (d22 * q1 - d12 * q2) / denominator;
+    float w = (d11 * q2 - d12 * q1) / denominator;
+    float u = 1.0f - v - w;
+    bool at_v0 = u > 1.0f - FEATURE_TOLERANCE, at_v1 = v > 1.0f - FEATURE_TOLERANCE, at_v2 = w > 1.0f - FEATURE_TOLERANCE;
+    glm::vec3 normal;
+
+    if (at_v0 || at_v1 || at_v2) {
+        normal = m_vertices[corners[at_v0 ? 0 : at_v1 ? 1 : 2]];
+    } else if (w < FEATURE_TOLERANCE) {
+        normal = m_edges[3 * i];
+    } else if (u < FEATURE_TOLERANCE) {
+        normal = m_edges[3 * i + 1];
+    } else if (v < FEATURE_TOLERANCE) {
+        normal = m_edges[3 * i + 2];
+    } else {
+        normal = triangles.normal(i);
+    }
+
+    return glm::dot(P - closest.point, normal) < 0.0f;
+}
+
+SignedDistanceField::SignedDistanceField(const CollisionMesh& mesh, float voxel_size, float max_distance, unsigned bits, ThreadPool& pool) :
+    m_voxel_size(voxel_size), m_max_distance(max_distance), m_bits(bits)
+{
+    if (bits != 8 && bits != 16) {
+        throw std::invalid_argument("SignedDistanceField: samples must be 8 or 16 bits");
+    }
+
+    if (!(voxel_size > 0.0f) || !(max_distance > 0.0f)) {
+        throw std::invalid_argument("SignedDistanceField: voxel size and distance must be positive");
+    }
+
+    if (mesh.bvh().nodes().empty()) {
+        throw std::invalid_argument("SignedDistanceField: the mesh is empty");
+    }
+
+    PseudoNormals normals(mesh);
+    const AABB& bounds = mesh.bvh().nodes()[0].bounds;
+    glm::vec3 extent = bounds.extent() + 2.0f * max_distance;
+    m_origin = bounds.min - max_distance;
+    m_cells = glm::max(glm::uvec3(glm::ceil(extent / voxel_size)), glm::uvec3(1));
+    m_grid_bricks = (m_cells + (BRICK_CELLS - 1)) / BRICK_CELLS;
+    m_step = 2.0f * max_distance / ((1u << bits) - 1);
+    m_bricks.resize(static_cast<std::size_t>(m_grid_bricks.x) * m_grid_bricks.y * m_grid_bricks.z);
+
+    // a brick can only hold a sample within max_distance of the surface if its center is
+    // within max_distance plus half the brick's diagonal
+    float brick_radius = 0.5f * BRICK_CELLS * voxel_size * std::sqrt(3.0f);
+
+    pool.parallel_for(m_bricks.size(), 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            glm::uvec3 brick(i % m_grid_bricks.x, (i / m_grid_bricks.x) % m_grid_bricks.y, i / (m_grid_bricks.x * m_grid_bricks.y));
+            glm::vec3 center = m_origin + (glm::vec3(brick * BRICK_CELLS) + 0.5f * BRICK_CELLS) * voxel_size;
+            float distance = signed_distance(mesh, normals, center, max_distance + brick_radius);
+
+            if (std::abs(distance) < max_distance + brick_radius) {
+                m_bricks[i] = KEEP;
+            } else {
+                m_bricks[i] = distance < 0.0f ? EMPTY_INSIDE : EMPTY_OUTSIDE;
+            }
+        }
+    });
+
+    std::vector<std::uint32_t> kept;
+
+    for (std::size_t i = 0; i < m_bricks.size(); i++) {
+        if (m_bricks[i] == KEEP) {
+            m_bricks[i] = static_cast<std::uint32_t>(kept.size() * SAMPLES_PER_BRICK);
+            kept.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    if (bits == 8) {
+        m_samples8.resize(kept.size() * SAMPLES_PER_BRICK);
+    } else {
+        m_samples16.resize(kept.size() * SAMPLES_PER_BRICK);
+    }
+
+    pool.parallel_for(kept.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; k++) {
+            std::size_t i = kept[k];
+            glm::uvec3 brick(i % m_grid_bricks.x, (i / m_grid_bricks.x) % m_grid_bricks.y, i / (m_grid_bricks.x * m_grid_bricks.y));
+            glm::vec3 corner = m_origin + glm::vec3(brick * BRICK_CELLS) * voxel_size;
+            std::size_t first = m_bricks[i];
+
+            for (unsigned z = 0; z < BRICK_SAMPLES; z++) {
+                for (unsigned y = 0; y < BRICK_SAMPLES; y++) {
+                    for (unsigned x = 0; x < BRICK_SAMPLES; x++) {
+                        glm::vec3 P = corner + glm::vec3(x, y, z) * voxel_size;
+                        float distance = signed_distance(mesh, normals, P, max_distance);
+                        float q = std::round((glm::clamp(distance, -max_distance, max_distance) + max_distance) / m_step);
+                        std::size_t index = first + (z * BRICK_SAMPLES + y) * BRICK_SAMPLES + x;
+
+                        if (bits == 8) {
+                            m_samples8[index] = static_cast<std::uint8_t>(q);
+                        } else {
+                            m_samples16[index] = static_cast<std::uint16_t>(q);
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+float SignedDistanceField::voxel_size() const
+{
+    return m_voxel_size;
+}
+
+float SignedDistanceField::max_distance() const
+{
+    return m_max_distance;
+}
+
+unsigned SignedDistanceField::bits() const
+{
+    return m_bits;
+}
+
+std::size_t SignedDistanceField::num_bricks() const
+{
+    return (m_samples8.size() + m_samples16.size()) / SAMPLES_PER_BRICK;
+}
+
+std::size_t SignedDistanceField::num_grid_bricks() const
+{
+    return m_bricks.size();
+}
+
+std::size_t SignedDistanceField::memory_usage() const
+{
+    return m_bricks.size() * sizeof(std::uint32_t) + m_samples8.size() * sizeof(std::uint8_t) + m_samples16.size() * sizeof(std::uint16_t);
+}
+
+bool SignedDistanceField::sample(const glm::vec3& P, float& distance, glm::vec3& gradient) const
+{
+    glm::vec3 g = (P - m_origin) / m_voxel_size;
+
+    if (!(g.x >= 0.0f && g.y >= 0.0f && g.z >= 0.0f && g.x <= m_cells.x && g.y <= m_cells.y && g.z <= m_cells.z)) {
+        return false;
+    }
+
+    // points on the far faces belong to the last cell
+    glm::uvec3 cell = glm::min(glm::uvec3(g), m_cells - 1u);
+    glm::uvec3 brick = cell / BRICK_CELLS;
+    glm::uvec3 local = cell - brick * BRICK_CELLS;
+    glm::vec3 f = g - glm::vec3(cell);
+    std::uint32_t entry = m_bricks[(static_cast<std::size_t>(brick.z) * m_grid_bricks.y + brick.y) * m_grid_bricks.x + brick.x];
+
+    if (entry == EMPTY_OUTSIDE || entry == EMPTY_INSIDE) {
+        distance = entry == EMPTY_INSIDE ? -m_max_distance : m_max_distance;
+        gradient = glm::vec3(0.0f);
+        return true;
+    }
+
+    const std::size_t dy = BRICK_SAMPLES;
+    const std::size_t dz = BRICK_SAMPLES * BRICK_SAMPLES;
+    std::size_t first = entry + local.z * dz + local.y * dy + local.x;
+    float d000 = decode(first);
+    float d100 = decode(first + 1);
+    float d010 = decode(first + dy);
+    float d110 = decode(first + dy + 1);
+    float d001 = decode(first + dz);
+    float d101 = decode(first + dz + 1);
+    float d011 = decode(first + dz + dy);
+    float d111 = decode(first + dz + dy + 1);
+
+    // interpolate along x, then y, then z, differentiating each step
+    float d00 = d000 + f.x * (d100 - d000);
+    float d10 = d010 + f.x * (d110 - d010);
+    float d01 = d001 + f.x * (d101 - d001);
+    float d11 = d011 + f.x * (d111 - d011);
+    float d0 = d00 + f.y * (d10 - d00);
+    float d1 = d01 + f.y * (d11 - d01);
+    distance = d0 + f.z * (d1 - d0);
+
+    float dx00 = d100 - d000;
+    float dx10 = d110 - d010;
+    float dx01 = d101 - d001;
+    float dx11 = d111 - d011;
+    float dx0 = dx00 + f.y * (dx10 - dx00);
+    float dx1 = dx01 + f.y * (dx11 - dx01);
+    gradient.x = dx0 + f.z * (dx1 - dx0);
+    gradient.y = (d10 - d00) + f.z * ((d11 - d01) - (d10 - d00));
+    gradient.z = d1 - d0;
+    gradient /= m_voxel_size;
+    return true;
+}
+
+float SignedDistanceField::decode(std::size_t index) const
+{
+    float q = m_bits == 8 ? m_samples8[index] : m_samples16[index];
+    return q * m_step - m_max_distance;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../utility/thread_pool.h"
+#include "collision_mesh.h"
+
+/**
+ * @brief Angle-weighted pseudo-normals of a CollisionMesh's vertices and edges, which tell which side of the surface a point is on.
+ *
+ * The closest point to P is often on an edge or vertex shared by several triangles, where the
+ * face normal of whichever triangle reported it gives the wrong side near sharp convex edges.
+ * Weighting the normals of the triangles around each vertex by their angle there, and adding
+ * the two normals along each edge, gives the right side at every feature (Bærentzen and Aanæs,
+ * "Signed Distance Computation Using the Angle Weighted Pseudonormal", 2005). Edges shared by
+ * more than two triangles fall back to the face normal.
+ */
+class PseudoNormals {
+public:
+    /**
+     * @param mesh Must outlive the normals, and not be updated while they are used.
+     */
+    PseudoNormals(const CollisionMesh& mesh);
+
+    /**
+     * @brief Whether P lies behind the surface, given closest, its closest point on the mesh.
+     */
+    bool is_behind(const glm::vec3& P, const ClosestPoint& closest) const;
+private:
+    const CollisionMesh& m_mesh;
+    std::vector<glm::vec3> m_vertices; // one per vertex of the mesh
+    std::vector<glm::vec3> m_edges;    // three per triangle, for its edges v0v1, v1v2 and v2v0
+};
+
+/**
+ * @brief Distances to a CollisionMesh sampled on a regular grid, for constant-time proximity tests.
+ *
+ * The grid is split into bricks of BRICK_SAMPLES^3 samples, where neighbouring bricks
+ * share their boundary samples so that every trilinear lookup reads a single brick.
+ * Only bricks within max_distance of the surface are stored. Distances are clamped to
+ * [-max_distance, max_distance] and quantized to 8 or 16 bits.
+ *
+ * A point is inside (negative distance) when it lies behind the surface at its closest
+ * point, judged by PseudoNormals, so for terrain, points below the ground are inside.
+ * On open meshes the sign flips across the plane of a boundary edge, and samples
+ * interpolated across that flip are unreliable.
+ */
+class SignedDistanceField {
+public:
+    static const unsigned BRICK_SAMPLES = 8;
+    static const unsigned BRICK_CELLS = BRICK_SAMPLES - 1;
+    static const std::uint32_t EMPTY_OUTSIDE = 0xFFFFFFFFu;
+    static const std::uint32_t EMPTY_INSIDE = 0xFFFFFFFEu;
+
+    /**
+     * @brief Bakes the distance field of mesh, spreading the bricks over the threads of pool.
+     *
+     * @param voxel_size The distance between neighbouring samples.
+     * @param max_distance The narrow band stored around the surface. Distances beyond it are clamped.
+     * @param bits 8 or 16.
+     */
+    SignedDistanceField(const CollisionMesh& mesh, float voxel_size, float max_distance, unsigned bits, ThreadPool& pool);
+
+    float voxel_size() const;
+    float max_distance() const;
+    unsigned bits() const;
+
+    /**
+     * @brief The number of stored bricks and the number of bricks in the whole grid.
+     */
+    std::size_t num_bricks() const;
+    std::size_t num_grid_bricks() const;
+
+    std::size_t memory_usage() const;
+
+    /**
+     * @brief Trilinearly interpolates the distance at P and its gradient.
+     *
+     * Far from the surface, distance is +-max_distance and gradient is zero.
+     *
+     * @return Whether P lies within the grid, which covers the mesh's bounds grown by max_distance.
+     */
+    bool sample(const glm::vec3& P, float& distance, glm::vec3& gradient) const;
+private:
+    float decode(std::size_t index) const;
+
+    std::vector<std::uint32_t> m_bricks; // first sample of each brick, or EMPTY_OUTSIDE / EMPTY_INSIDE
+    std::vector<std::uint8_t> m_samples8;
+    std::vector<std::uint16_t> m_samples16;
+
+    glm::vec3 m_origin;
+    glm::uvec3 m_cells;
+    glm::uvec3 m_grid_bricks;
+    float m_voxel_size;
+    float m_max_distance;
+    float m_step; // distance per quantization step
+    unsigned m_bits;
+};
@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/geometric.hpp>
+
+#include "simplify.h"
+
+namespace {
+    // open edges weigh this much more than the faces around them, so the outline barely moves
+    const double BOUNDARY_WEIGHT = 10.0;
+
+    // a level that keeps more than this share of the triangles of the level before ends the chain
+    const float MIN_LOD_REDUCTION = 0.9f;
+
+    // the symmetric 4x4 matrix of a sum of squared plane distances, and the total weight of the planes
+    struct Quadric {
+        double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+        double weight;
+    };
+
+    Quadric plane_quadric(const glm::dvec3& n, double d, double weight)
+    {
+        Quadric q;
+        q.a00 = weight * n.x * n.x;
+        q.a01 = weight * n.x * n.y;
+        q.a02 = weight * n.x * n.z;
+        q.a03 = weight * n.x * d;
+        q.a11 = weight * n.y * n.y;
+        q.a12 = weight * n.y * n.z;
+        q.a13 = weight * n.y * d;
+        q.a22 = weight * n.z * n.z;
+        q.a23 = weight * n.z * d;
+        q.a33 = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+
+    void add(Quadric& q, const Quadric& r)
+    {
+        q.a00 += r.a00;
+        q.a01 += r.a01;
+        q.a02 += r.a02;
+        q.a03 += r.a03;
+        q.a11 += r.a11;
+        q.a12 += r.a12;
+        q.a13 += r.a13;
+        q.a22 += r.a22;
+        q.a23 += r.a23;
+        q.a33 += r.a33;
+        q.weight += r.weight;
+    }
+
+    // the mean squared distance of p to the planes of q and r together
+    double error(const Quadric& q, const Quadric& r, const glm::vec3& p)
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = (q.a00 + r.a00) * x * x + (q.a11 + r.a11) * y * y + (q.a22 + r.a22) * z * z
+            + 2.0 * ((q.a01 + r.a01) * x * y + (q.a02 + r.a02) * x * z + (q.a12 + r.a12) * y * z)
+            + 2.0 * ((q.a03 + r.a03) * x + (q.a13 + r.a13) * y + (q.a23 + r.a23) * z) + q.a33 + r.a33;
+        double weight = q.weight + r.weight;
+        return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+
+    std::uint64_t edge_key(unsigned a, unsigned b)
+    {
+        return static_cast<std::uint64_t>(a) << 32 | b;
+    }
+
+    struct Collapse {
+        double error;
+        unsigned from;
+        unsigned to;
+
+        bool operator<(const Collapse& other) const
+        {
+            return error < other.error;
+        }
+    };
+
+    // the triangles around every vertex, rebuilt after each pass
+    struct Adjacency {
+        void build(std::size_t num_vertices, const std::vector<unsigned>& indices)
+        {
+            offsets.assign(num_vertices + 1, 0);
+
+            for (unsigned v : indices) {
+                offsets[v + 1]++;
+            }
+
+            for (std::size_t v = 0; v < num_vertices; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+
+            triangles.resize(indices.size());
+            std::vector<unsigned> cursor(offsets.begin(), offsets.end() - 1);
+
+            for (std::size_t i = 0; i < indices.size(); i++) {
+                triangles[cursor[indices[i]]++] = static_cast<unsigned>(i / 3);
+            }
+        }
+
+        std::vector<unsigned> offsets;
+        std::vector<unsigned> triangles;
+    };
+
+    // moving from onto to must keep every other triangle around from facing the same way
+    bool flips(ArrayView<glm::vec3> positions, const std::vector<unsigned>& indices, const Adjacency& adjacency, unsigned from, unsigned to)
+    {
+        for (unsigned i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+            const unsigned* t = &indices[3 * adjacency.triangles[i]];
+
+            if (t[0] == to || t[1] == to || t[2] == to) {
+                continue;
+            }
+
+            unsigned corner = t[0] == from ? 0 : t[1] == from ? 1 : 2;
+            const glm::vec3& b = positions[t[(corner + 1) % 3]];
+            const glm::vec3& c = positions[t[(corner + 2) % 3]];
+            glm::vec3 before = glm::cross(b - positions[from], c - positions[from]);
+            glm::vec3 after = glm::cross(b - positions[to], c - positions[to]);
+
+            if (glm::dot(before, after) <= 0.0f) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // the vertices of the triangles around v, sorted, without v itself
+    void ring(const std::vector<unsigned>& indices, const Adjacency& adjacency, unsigned v, std::vector<unsigned>& vertices)
+    {
+        vertices.clear();
+
+        for (unsigned i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++) {
+            const unsigned* t = &indices[3 * adjacency.triangles[i]];
+            vertices.insert(vertices.end(), t, t + 3);
+        }
+
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        vertices.erase(std::remove(vertices.begin(), vertices.end(), v), vertices.end());
+    }
+
+    // an edge may only collapse if its ends share no neighbours besides the corners across its triangles,
+    // otherwise the surface would be pinched into a non-manifold edge
+    bool pinches(const std::vector<unsigned>& indices, const Adjacency& adjacency, unsigned from, unsigned to,
+                 std::vector<unsigned>& from_ring, std::vector<unsigned>& to_ring)
+    {
+        unsigned shared_triangles = 0;
+
+        for (unsigned i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+            const unsigned* t = &indices[3 * adjacency.triangles[i]];
+            shared_triangles += t[0] == to || t[1] == to || t[2] == to;
+        }
+
+        ring(indices, adjacency, from, from_ring);
+        ring(indices, adjacency, to, to_ring);
+        unsigned shared_vertices = 0;
+
+        for (unsigned v : to_ring) {
+            shared_vertices += v != from && std::binary_search(from_ring.begin(), from_ring.end(), v);
+        }
+
+        return shared_vertices > shared_triangles;
+    }
+}
+
+std::vector<unsigned> simplify(ArrayView<glm::vec3> positions, ArrayView<unsigned> elements, std::size_t target_triangles, float& max_error)
+{
+    std::size_t num_vertices = positions.size();
+    std::vector<unsigned> indices(elements.begin(), elements.end());
+    max_error = 0.0f;
+
+    // vertices that share their position with another are seams and stay where they are
+    std::vector<unsigned char> locked(num_vertices, 0);
+    std::vector<unsigned> order(num_vertices);
+
+    for (unsigned v = 0; v < num_vertices; v++) {
+        order[v] = v;
+    }
+
+    auto position_less = [&](unsigned a, unsigned b) {
+        const glm::vec3& p = positions[a];
+        const glm::vec3& q = positions[b];
+        return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+    };
+
+    std::sort(order.begin(), order.end(), position_less);
+
+    for (std::size_t i = 1; i < num_vertices; i++) {
+        if (positions[order[i]] == positions[order[i - 1]]) {
+            locked[order[i]] = locked[order[i - 1]] = 1;
+        }
+    }
+
+    // every vertex starts with the planes of its triangles, weighted by area
+    std::vector<Quadric> quadrics(num_vertices, plane_quadric(glm::dvec3(0.0), 0.0, 0.0));
+    std::vector<std::uint64_t> edges;
+
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        glm::dvec3 p0(positions[indices[i]]), p1(positions[indices[i + 1]]), p2(positions[indices[i + 2]]);
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+
+        for (unsigned corner = 0; corner < 3; corner++) {
+            edges.push_back(edge_key(indices[i + corner], indices[i + (corner + 1) % 3]));
+        }
+
+        if (length == 0.0) {
+            continue;
+        }
+
+        normal /= length;
+        Quadric q = plane_quadric(normal, -glm::dot(normal, p0), 0.5 * length);
+
+        for (unsigned corner = 0; corner < 3; corner++) {
+            add(quadrics[indices[i + corner]], q);
+        }
+    }
+
+    // an edge whose reverse is in no triangle is open, and gets a plane through it standing up from its face
+    std::sort(edges.begin(), edges.end());
+
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        glm::dvec3 p[3] = { glm::dvec3(positions[indices[i]]), glm::dvec3(positions[indices[i + 1]]), glm::dvec3(positions[indices[i + 2]]) };
+        glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+        for (unsigned corner = 0; corner < 3; corner++) {
+            unsigned a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+
+            if (std::binary_search(edges.begin(), edges.end(), edge_key(b, a))) {
+                continue;
+            }
+
+            glm::dvec3 edge = p[(corner + 1) % 3] - p[corner];
+            glm::dvec3 side = glm::cross(edge, normal);
+            double length = glm::length(side);
+
+            if (length == 0.0) {
+                continue;
+            }
+
+            side /= length;
+            Quadric q = plane_quadric(side, -glm::dot(side, p[corner]), BOUNDARY_WEIGHT * glm::dot(edge, edge));
+            add(quadrics[a], q);
+            add(quadrics[b], q);
+        }
+    }
+
+    // each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the triangles
+    Adjacency adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned> remap(num_vertices);
+    std::vector<unsigned char> touched(num_vertices);
+    std::vector<unsigned> from_ring, to_ring;
+
+    while (indices.size() / 3 > target_triangles) {
+        adjacency.build(num_vertices, indices);
+        edges.clear();
+
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            for (unsigned corner = 0; corner < 3; corner++) {
+                unsigned a = indices[i + corner], b = indices[i + (corner + 1) % 3];
+                edges.push_back(edge_key(std::min(a, b), std::max(a, b)));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        collapses.clear();
+
+        for (std::uint64_t key : edges) {
+            unsigned a = static_cast<unsigned>(key >> 32), b = static_cast<unsigned>(key);
+            Collapse collapse;
+            collapse.error = -1.0;
+
+            if (!locked[a]) {
+                collapse.error = error(quadrics[a], quadrics[b], positions[b]);
+                collapse.from = a;
+                collapse.to = b;
+            }
+
+            if (!locked[b]) {
+                double e = error(quadrics[a], quadrics[b], positions[a]);
+
+                if (collapse.error < 0.0 || e < collapse.error) {
+                    collapse.error = e;
+                    collapse.from = b;
+                    collapse.to = a;
+                }
+            }
+
+            if (collapse.error >= 0.0) {
+                collapses.push_back(collapse);
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end());
+        std::size_t excess = indices.size() / 3 - target_triangles;
+        std::size_t removed = 0;
+        unsigned num_collapsed = 0;
+
+        for (unsigned v = 0; v < num_vertices; v++) {
+            remap[v] = v;
+        }
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for (const Collapse& collapse : collapses) {
+            if (removed >= excess) {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            if (flips(positions, indices, adjacency, collapse.from, collapse.to) || pinches(indices, adjacency, collapse.from, collapse.to, from_ring, to_ring)) {
+                continue;
+            }
+
+            // the triangles around from change shape, so none of their corners may move again this pass
+            for (unsigned i = adjacency.offsets[collapse.from]; i < adjacency.offsets[collapse.from + 1]; i++) {
+                const unsigned* t = &indices[3 * adjacency.triangles[i]];
+                touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+                removed += t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to;
+            }
+
+            remap[collapse.from] = collapse.to;
+            add(quadrics[collapse.to], quadrics[collapse.from]);
+            max_error = std::max(max_error, static_cast<float>(collapse.error));
+            num_collapsed++;
+        }
+
+        if (num_collapsed == 0) {
+            break;
+        }
+
+        std::size_t kept = 0;
+
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            unsigned a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+
+            if (a != b && b != c && c != a) {
+                indices[kept++] = a;
+                indices[kept++] = b;
+                indices[kept++] = c;
+            }
+        }
+
+        indices.resize(kept);
+    }
+
+    max_error = std::sqrt(max_error);
+    return indices;
+}
+
+std::vector<LodLevel> build_lods(ArrayView<glm::vec3> positions, std::vector<unsigned>& elements, unsigned max_levels, std::size_t min_triangles)
+{
+    std::vector<LodLevel> levels;
+    LodLevel full = { 0, elements.size(), 0.0f };
+    levels.push_back(full);
+
+    while (levels.size() < max_levels && levels.back().count / 3 > min_triangles) {
+        const LodLevel& last = levels.back();
+        std::size_t target = std::max(last.count / 6, min_triangles);
+        float error;
+        std::vector<unsigned> coarser = simplify(positions, ArrayView<unsigned>(elements.data() + last.first, last.count), target, error);
+
+        if (coarser.size() > MIN_LOD_REDUCTION * last.count) {
+            break;
+        }
+
+        LodLevel level = { elements.size(), coarser.size(), last.error + error };
+        elements.insert(elements.end(), coarser.begin(), coarser.end());
+        levels.push_back(level);
+    }
+
+    return levels;
+}
+
+unsigned select_lod(const std::vector<LodLevel>& levels, float pixels_per_unit, float max_error_pixels)
+{
+    unsigned lod = 0;
+
+    while (lod + 1 < levels.size() && levels[lod + 1].error * pixels_per_unit <= max_error_pixels) {
+        lod++;
+    }
+
+    return lod;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../utility/array_view.h"
+
+/**
+ * @brief One level of detail: a range of a shared element array and how far it strays from the full mesh.
+ */
+struct LodLevel {
+    std::size_t first; // in elements
+    std::size_t count;
+    float error;       // an estimate of the largest distance to the full mesh, in model units
+};
+
+/**
+ * @brief Reduces a triangle mesh towards target_triangles by collapsing edges in order of quadric error.
+ *
+ * Every collapse moves one vertex onto a neighbour, so the result indexes the same positions and
+ * levels of detail can share one vertex buffer. Collapses that would flip a triangle or pinch the
+ * surface are skipped, open edges are kept in place by extra quadrics, and vertices sharing their
+ * position with another, such as the two sides of a normal seam, never move. The result may stay
+ * above target_triangles when nothing more can be collapsed.
+ *
+ * @param error Receives the root mean square distance of the moved vertices to the planes they came from,
+ *              at the worst collapse.
+ * @return Three indices into positions per remaining triangle.
+ */
+std::vector<unsigned> simplify(ArrayView<glm::vec3> positions, ArrayView<unsigned> elements, std::size_t target_triangles, float& error);
+
+/**
+ * @brief Appends ever coarser copies of the mesh in elements, each with about half the triangles of the last.
+ *
+ * Stops after max_levels levels, below min_triangles, or once a level barely shrinks. Each level
+ * is simplified from the one before, and its error adds up the errors along the way.
+ *
+ * @return The levels from the full mesh, [0, elements.size()) on entry, to the coarsest.
+ */
+std::vector<LodLevel> build_lods(ArrayView<glm::vec3> positions, std::vector<unsigned>& elements, unsigned max_levels = 8, std::size_t min_triangles = 64);
+
+/**
+ * @brief The coarsest level whose error spans at most max_error_pixels on screen.
+ *
+ * @param pixels_per_unit How many pixels one model unit covers where the mesh is drawn, see Camera::get_pixels_per_unit().
+ */
+unsigned select_lod(const std::vector<LodLevel>& levels, float pixels_per_unit, float max_error_pixels);
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "sweep_and_prune.h"
+
+namespace {
+    // ties put min endpoints first, so boxes that only touch still count as overlapping
+    template <typename Endpoint>
+    bool less(const Endpoint& a, const Endpoint& b)
+    {
+        return a.value < b.value || (a.value == b.value && !(a.data & 1) && (b.data & 1));
+    }
+
+    std::uint64_t pair_key(unsigned a, unsigned b)
+    {
+        return static_cast<std::uint64_t>(a) << 32 | b;
+    }
+}
+
+SweepAndPrune::SweepAndPrune() :
+    m_swaps(0)
+{
+}
+
+unsigned SweepAndPrune::add(const AABB& bounds)
+{
+    unsigned object = allocate();
+
+    // start beyond every other box and let update() sort the endpoints into place
+    const float far = std::numeric_limits<float>::infinity();
+    Proxy& proxy = m_proxies[object];
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+        proxy.endpoints[axis][0] = static_cast<unsigned>(m_axes[axis].size());
+        proxy.endpoints[axis][1] = static_cast<unsigned>(m_axes[axis].size() + 1);
+        m_axes[axis].push_back({ far, object << 1 });
+        m_axes[axis].push_back({ far, object << 1 | 1 });
+    }
+
+    update(object, bounds);
+    return object;
+}
+
+std::vector<unsigned> SweepAndPrune::add(const std::vector<AABB>& boxes)
+{
+    std::vector<unsigned> objects(boxes.size());
+
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+        objects[i] = allocate();
+
+        for (unsigned axis = 0; axis < 3; axis++) {
+            m_axes[axis].push_back({ boxes[i].min[axis], objects[i] << 1 });
+            m_axes[axis].push_back({ boxes[i].max[axis], objects[i] << 1 | 1 });
+        }
+    }
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+        std::vector<Endpoint>& endpoints = m_axes[axis];
+        std::sort(endpoints.begin(), endpoints.end(), less<Endpoint>);
+
+        for (std::size_t i = 0; i < endpoints.size(); i++) {
+            m_proxies[endpoints[i].data >> 1].endpoints[axis][endpoints[i].data & 1] = static_cast<unsigned>(i);
+        }
+    }
+
+    // sweep along x, testing every box against the boxes whose x interval is still open
+    std::vector<unsigned> open;
+    std::vector<unsigned> open_index(m_proxies.size());
+
+    for (const Endpoint& endpoint : m_axes[0]) {
+        unsigned object = endpoint.data >> 1;
+
+        if (endpoint.data & 1) {
+            unsigned index = open_index[object];
+            open[index] = open.back();
+            open_index[open[index]] = index;
+            open.pop_back();
+            continue;
+        }
+
+        for (unsigned other : open) {
+            if (overlaps(object, other)) {
+                add_pair(object, other);
+            }
+        }
+
+        open_index[object] = static_cast<unsigned>(open.size());
+        open.push_back(object);
+    }
+
+    return objects;
+}
+
+void SweepAndPrune::remove(unsigned object)
+{
+    if (object >= m_proxies.size() || !m_proxies[object].alive) {
+        throw std::invalid_argument("SweepAndPrune::remove: no such object");
+    }
+
+    // walking down, a hole is filled by a pair already checked
+    for (std::size_t i = m_pairs.size(); i-- > 0;) {
+        if (m_pairs[i].first == object || m_pairs[i].second == object) {
+            remove_pair(m_pairs[i].first, m_pairs[i].second);
+        }
+    }
+
+    // other boxes may end at infinity too, so the endpoints are erased where they are rather than sorted last
+    for (unsigned axis = 0; axis < 3; axis++) {
+        std::vector<Endpoint>& endpoints = m_axes[axis];
+        unsigned kept = m_proxies[object].endpoints[axis][0];
+
+        for (std::size_t i = kept; i < endpoints.size(); i++) {
+            if (endpoints[i].data >> 1 == object) {
+                continue;
+            }
+
+            endpoints[kept] = endpoints[i];
+            m_proxies[endpoints[kept].data >> 1].endpoints[axis][endpoints[kept].data & 1] = kept;
+            kept++;
+        }
+
+        endpoints.resize(kept);
+    }
+
+    m_proxies[object].alive = false;
+    m_free.push_back(object);
+}
+
+void SweepAndPrune::update(unsigned object, const AABB& bounds)
+{
+    if (object >= m_proxies.size() || !m_proxies[object].alive) {
+        throw std::invalid_argument("SweepAndPrune::update: no such object");
+    }
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+        set_axis(object, axis, bounds.min[axis], bounds.max[axis]);
+    }
+}
+
+unsigned SweepAndPrune::allocate()
+{
+    unsigned object;
+
+    if (!m_free.empty()) {
+        object = m_free.back();
+        m_free.pop_back();
+    } else {
+        object = static_cast<unsigned>(m_proxies.size());
+        m_proxies.push_back(Proxy());
+    }
+
+    m_proxies[object].alive = true;
+    return object;
+}
+
+const std::vector<SweepAndPrune::Pair>& SweepAndPrune::pairs() const
+{
+    return m_pairs;
+}
+
+std::size_t SweepAndPrune::size() const
+{
+    return m_proxies.size() - m_free.size();
+}
+
+std::uint64_t SweepAndPrune::swaps() const
+{
+    return m_swaps;
+}
+
+void SweepAndPrune::set_axis(unsigned object, unsigned axis, float min, float max)
+{
+    std::vector<Endpoint>& endpoints = m_axes[axis];
+    const Proxy& proxy = m_proxies[object];
+    float old_min = endpoints[proxy.endpoints[axis][0]].value;
+    float old_max = endpoints[proxy.endpoints[axis][1]].value;
+    endpoints[proxy.endpoints[axis][0]].value = min;
+    endpoints[proxy.endpoints[axis][1]].value = max;
+
+    // move the endpoint heading outwards first, so the min never has to pass its own max
+    if (max > old_max) {
+        sort_up(axis, proxy.endpoints[axis][1]);
+    }
+
+    if (min < old_min) {
+        sort_down(axis, proxy.endpoints[axis][0]);
+    } else if (min > old_min) {
+        sort_up(axis, proxy.endpoints[axis][0]);
+    }
+
+    if (max < old_max) {
+        sort_down(axis, proxy.endpoints[axis][1]);
+    }
+}
+
+void SweepAndPrune::sort_down(unsigned axis, unsigned index)
+{
+    std::vector<Endpoint>& endpoints = m_axes[axis];
+
+    while (index > 0 && less(endpoints[index], endpoints[index - 1])) {
+        swap_endpoints(axis, index - 1, index);
+        index--;
+    }
+}
+
+void SweepAndPrune::sort_up(unsigned axis, unsigned index)
+{
+    std::vector<Endpoint>& endpoints = m_axes[axis];
+
+    while (index + 1 < endpoints.size() && less(endpoints[index + 1], endpoints[index])) {
+        swap_endpoints(axis, index, index + 1);
+        index++;
+    }
+}
+
+void SweepAndPrune::swap_endpoints(unsigned axis, unsigned lower, unsigned upper)
+{
+    std::vector<Endpoint>& endpoints = m_axes[axis];
+    Endpoint rising = endpoints[lower];
+    Endpoint falling = endpoints[upper];
+    unsigned a = rising.data >> 1;
+    unsigned b = falling.data >> 1;
+
+    endpoints[lower] = falling;
+    endpoints[upper] = rising;
+    m_proxies[a].endpoints[axis][rising.data & 1] = upper;
+    m_proxies[b].endpoints[axis][falling.data & 1] = lower;
+    m_swaps++;
+
+    if (a == b) {
+        return;
+    }
+
+    // a min dropping below a max starts an overlap on this axis, a max dropping below a min ends one
+    bool falling_is_max = falling.data & 1;
+    bool rising_is_max = rising.data & 1;
+
+    if (!falling_is_max && rising_is_max) {
+        if (overlaps(a, b)) {
+            add_pair(a, b);
+        }
+    } else if (falling_is_max && !rising_is_max) {
+        remove_pair(a, b);
+    }
+}
+
+bool SweepAndPrune::overlaps(unsigned a, unsigned b) const
+{
+    const Proxy& pa = m_proxies[a];
+    const Proxy& pb = m_proxies[b];
+
+    for (unsigned axis = 0; axis < 3; axis++) {
+        const std::vector<Endpoint>& endpoints = m_axes[axis];
+
+        if (endpoints[pb.endpoints[axis][1]].value < endpoints[pa.endpoints[axis][0]].value ||
+            endpoints[pa.endpoints[axis][1]].value < endpoints[pb.endpoints[axis][0]].value) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SweepAndPrune::add_pair(unsigned a, unsigned b)
+{
+    if (a > b) {
+        std::swap(a, b);
+    }
+
+    auto inserted = m_pair_index.insert({ pair_key(a, b), static_cast<unsigned>(m_pairs.size()) });
+
+    if (inserted.second) {
+        m_pairs.push_back({ a, b });
+    }
+}
+
+void SweepAndPrune::remove_pair(unsigned a, unsigned b)
+{
+    if (a > b) {
+        std::swap(a, b);
+    }
+
+    auto found = m_pair_index.find(pair_key(a, b));
+
+    if (found == m_pair_index.end()) {
+        return;
+    }
+
+    // fill the hole with the last pair
+    unsigned index = found->second;
+    m_pair_index.erase(found);
+
+    if (index + 1 < m_pairs.size()) {
+        m_pairs[index] = m_pairs.back();
+        m_pair_index[pair_key(m_pairs[index].first, m_pairs[index].second)] = index;
+    }
+
+    m_pairs.pop_back();
+}
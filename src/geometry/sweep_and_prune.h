@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+
+/**
+ * @brief A broadphase that keeps the boxes of dynamic objects sorted along all three axes.
+ *
+ * Every box contributes a min and a max endpoint per axis. When a box moves, its endpoints
+ * are insertion-sorted back into place, and each swap between two objects' endpoints is
+ * exactly the moment their intervals on that axis start or stop overlapping, so the set of
+ * overlapping pairs is updated as a side effect. Objects move little between steps, so the
+ * axes stay nearly sorted and an update costs about as much as the swaps it makes. Objects
+ * that do not move cost nothing.
+ */
+class SweepAndPrune {
+public:
+    using Pair = std::pair<unsigned, unsigned>; // first < second
+
+    SweepAndPrune();
+
+    /**
+     * @brief Inserts a box and returns its handle. Handles of removed objects are reused.
+     */
+    unsigned add(const AABB& bounds);
+
+    /**
+     * @brief Inserts many boxes at once, sorting each axis in O(n log n) instead of inserting one by one.
+     *
+     * @return The handles of the new objects, in the order of boxes.
+     */
+    std::vector<unsigned> add(const std::vector<AABB>& boxes);
+
+    void remove(unsigned object);
+
+    /**
+     * @brief Moves the box of object, adding and removing the pairs whose overlap changed.
+     */
+    void update(unsigned object, const AABB& bounds);
+
+    /**
+     * @brief Every pair of objects whose boxes overlap, boundaries included, in no particular order.
+     */
+    const std::vector<Pair>& pairs() const;
+
+    std::size_t size() const;
+
+    /**
+     * @brief The total number of endpoint swaps made so far, a measure of the sorting work.
+     */
+    std::uint64_t swaps() const;
+private:
+    struct Endpoint {
+        float value;
+        unsigned data; // object << 1, plus 1 for a max endpoint
+    };
+
+    struct Proxy {
+        unsigned endpoints[3][2]; // index of the min and max endpoint on each axis
+        bool alive;
+    };
+
+    unsigned allocate();
+    void set_axis(unsigned object, unsigned axis, float min, float max);
+    void sort_down(unsigned axis, unsigned index);
+    void sort_up(unsigned axis, unsigned index);
+    void swap_endpoints(unsigned axis, unsigned lower, unsigned upper);
+    bool overlaps(unsigned a, unsigned b) const;
+    void add_pair(unsigned a, unsigned b);
+    void remove_pair(unsigned a, unsigned b);
+
+    std::vector<Endpoint> m_axes[3];
+    std::vector<Proxy> m_proxies;
+    std::vector<unsigned> m_free;
+    std::vector<Pair> m_pairs;
+    std::unordered_map<std::uint64_t, unsigned> m_pair_index; // position of each pair in m_pairs
+    std::uint64_t m_swaps;
+};
@@ -0,0 +1,177 @@
+#include <immintrin.h>
+
+#include "../utility/cpu_features.h"
+#include "triangle_simd.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE41
+#endif
+
+namespace {
+    using Kernel = unsigned (*)(const TriangleSoA&, std::size_t, const glm::vec3&, const glm::vec3&, float, TriangleHits8&);
+
+    unsigned intersect_scalar(const TriangleSoA& triangles, std::size_t first, const glm::vec3& O, const glm::vec3& D, float max_t, TriangleHits8& hits)
+    {
+        unsigned mask = 0;
+
+        for (unsigned lane = 0; lane < 8; lane++) {
+            if (triangles.intersect(first + lane, O, D, max_t, hits.t[lane], hits.u[lane], hits.v[lane])) {
+                mask |= 1u << lane;
+            }
+        }
+
+        return mask;
+    }
+
+    TARGET_SSE41 unsigned intersect_sse41(const TriangleSoA& triangles, std::size_t first, const glm::vec3& O, const glm::vec3& D, float max_t, TriangleHits8& hits)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 Dx = _mm_set1_ps(D.x), Dy = _mm_set1_ps(D.y), Dz = _mm_set1_ps(D.z);
+        const __m128 Ox = _mm_set1_ps(O.x), Oy = _mm_set1_ps(O.y), Oz = _mm_set1_ps(O.z);
+        const __m128 t_max = _mm_set1_ps(max_t);
+        unsigned mask = 0;
+
+        for (unsigned half = 0; half < 8; half += 4) {
+            std::size_t i = first + half;
+            __m128 nx = _mm_loadu_ps(triangles.stream(TriangleSoA::N_X) + i);
+            __m128 ny = _mm_loadu_ps(triangles.stream(TriangleSoA::N_Y) + i);
+            __m128 nz = _mm_loadu_ps(triangles.stream(TriangleSoA::N_Z) + i);
+            __m128 AOx = _mm_sub_ps(Ox, _mm_loadu_ps(triangles.stream(TriangleSoA::V0_X) + i));
+            __m128 AOy = _mm_sub_ps(Oy, _mm_loadu_ps(triangles.stream(TriangleSoA::V0_Y) + i));
+            __m128 AOz = _mm_sub_ps(Oz, _mm_loadu_ps(triangles.stream(TriangleSoA::V0_Z) + i));
+
+            __m128 det = _mm_sub_ps(zero, _mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, nx), _mm_mul_ps(Dy, ny)), _mm_mul_ps(Dz, nz)));
+            __m128 invdet = _mm_div_ps(one, det);
+
+            __m128 DAOx = _mm_sub_ps(_mm_mul_ps(AOy, Dz), _mm_mul_ps(AOz, Dy));
+            __m128 DAOy = _mm_sub_ps(_mm_mul_ps(AOz, Dx), _mm_mul_ps(AOx, Dz));
+            __m128 DAOz = _mm_sub_ps(_mm_mul_ps(AOx, Dy), _mm_mul_ps(AOy, Dx));
+
+            __m128 uv_scale = _mm_mul_ps(invdet, _mm_loadu_ps(triangles.stream(TriangleSoA::INV_DOUBLE_AREA) + i));
+            __m128 E2_DAO = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E2_X) + i), DAOx),
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E2_Y) + i), DAOy)),
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E2_Z) + i), DAOz));
+            __m128 E1_DAO = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E1_X) + i), DAOx),
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E1_Y) + i), DAOy)),
+                _mm_mul_ps(_mm_loadu_ps(triangles.stream(TriangleSoA::E1_Z) + i), DAOz));
+            __m128 u = _mm_mul_ps(E2_DAO, uv_scale);
+            __m128 v = _mm_sub_ps(zero, _mm_mul_ps(E1_DAO, uv_scale));
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(AOx, nx), _mm_mul_ps(AOy, ny)), _mm_mul_ps(AOz, nz)), invdet);
+
+            __m128 hit = _mm_cmpgt_ps(det, zero);
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(t, t_max));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+
+            _mm_store_ps(hits.t + half, t);
+            _mm_store_ps(hits.u + half, u);
+            _mm_store_ps(hits.v + half, v);
+            mask |= static_cast<unsigned>(_mm_movemask_ps(hit)) << half;
+        }
+
+        return mask;
+    }
+
+    TARGET_AVX2 unsigned intersect_avx2(const TriangleSoA& triangles, std::size_t i, const glm::vec3& O, const glm::vec3& D, float max_t, TriangleHits8& hits)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 Dx = _mm256_set1_ps(D.x), Dy = _mm256_set1_ps(D.y), Dz = _mm256_set1_ps(D.z);
+
+        __m256 nx = _mm256_loadu_ps(triangles.stream(TriangleSoA::N_X) + i);
+        __m256 ny = _mm256_loadu_ps(triangles.stream(TriangleSoA::N_Y) + i);
+        __m256 nz = _mm256_loadu_ps(triangles.stream(TriangleSoA::N_Z) + i);
+        __m256 AOx = _mm256_sub_ps(_mm256_set1_ps(O.x), _mm256_loadu_ps(triangles.stream(TriangleSoA::V0_X) + i));
+        __m256 AOy = _mm256_sub_ps(_mm256_set1_ps(O.y), _mm256_loadu_ps(triangles.stream(TriangleSoA::V0_Y) + i));
+        __m256 AOz = _mm256_sub_ps(_mm256_set1_ps(O.z), _mm256_loadu_ps(triangles.stream(TriangleSoA::V0_Z) + i));
+
+        __m256 det = _mm256_sub_ps(zero, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Dx, nx), _mm256_mul_ps(Dy, ny)), _mm256_mul_ps(Dz, nz)));
+        __m256 invdet = _mm256_div_ps(one, det);
+
+        __m256 DAOx = _mm256_sub_ps(_mm256_mul_ps(AOy, Dz), _mm256_mul_ps(AOz, Dy));
+        __m256 DAOy = _mm256_sub_ps(_mm256_mul_ps(AOz, Dx), _mm256_mul_ps(AOx, Dz));
+        __m256 DAOz = _mm256_sub_ps(_mm256_mul_ps(AOx, Dy), _mm256_mul_ps(AOy, Dx));
+
+        __m256 uv_scale = _mm256_mul_ps(invdet, _mm256_loadu_ps(triangles.stream(TriangleSoA::INV_DOUBLE_AREA) + i));
+        __m256 E2_DAO = _mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E2_X) + i), DAOx),
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E2_Y) + i), DAOy)),
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E2_Z) + i), DAOz));
+        __m256 E1_DAO = _mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E1_X) + i), DAOx),
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E1_Y) + i), DAOy)),
+            _mm256_mul_ps(_mm256_loadu_ps(triangles.stream(TriangleSoA::E1_Z) + i), DAOz));
+        __m256 u = _mm256_mul_ps(E2_DAO, uv_scale);
+        __m256 v = _mm256_sub_ps(zero, _mm256_mul_ps(E1_DAO, uv_scale));
+        __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(AOx, nx), _mm256_mul_ps(AOy, ny)), _mm256_mul_ps(AOz, nz)), invdet);
+
+        __m256 hit = _mm256_cmp_ps(det, zero, _CMP_GT_OQ);
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(max_t), _CMP_LE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+
+        _mm256_store_ps(hits.t, t);
+        _mm256_store_ps(hits.u, u);
+        _mm256_store_ps(hits.v, v);
+        return static_cast<unsigned>(_mm256_movemask_ps(hit));
+    }
+
+    struct KernelInfo {
+        Kernel kernel;
+        const char* name;
+    };
+
+    KernelInfo select_kernel()
+    {
+        if (cpu_features().avx2) return { intersect_avx2, "AVX2" };
+        if (cpu_features().sse41) return { intersect_sse41, "SSE4.1" };
+        return { intersect_scalar, "scalar" };
+    }
+
+    const KernelInfo kernel_info = select_kernel();
+}
+
+unsigned intersect_triangles8(const TriangleSoA& triangles, std::size_t first, const glm::vec3& O, const glm::vec3& D, float max_t, TriangleHits8& hits)
+{
+    return kernel_info.kernel(triangles, first, O, D, max_t, hits);
+}
+
+bool closest_hit(const TriangleSoA& triangles, std::size_t first, std::size_t count, const glm::vec3& O, const glm::vec3& D, float& max_t, unsigned& triangle)
+{
+    TriangleHits8 hits;
+    bool found = false;
+
+    for (std::size_t offset = 0; offset < count; offset += 8) {
+        unsigned mask = kernel_info.kernel(triangles, first + offset, O, D, max_t, hits);
+
+        if (count - offset < 8) {
+            mask &= (1u << (count - offset)) - 1;
+        }
+
+        for (unsigned lane = 0; mask; lane++, mask >>= 1) {
+            if ((mask & 1) && hits.t[lane] <= max_t) {
+                max_t = hits.t[lane];
+                triangle = static_cast<unsigned>(first + offset + lane);
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+const char* triangle_kernel_name()
+{
+    return kernel_info.name;
+}
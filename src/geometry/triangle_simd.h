@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/vec3.hpp>
+
+#include "triangle_soa.h"
+
+struct TriangleHits8 {
+    alignas(32) float t[8];
+    alignas(32) float u[8];
+    alignas(32) float v[8];
+};
+
+/**
+ * @brief Intersects the ray O + tD with the front faces of the eight triangles starting at first.
+ *
+ * Uses AVX2 or SSE4.1 depending on what CPUID reports at startup, with a scalar fallback.
+ * Every kernel gives the same result as TriangleSoA::intersect() for each lane.
+ *
+ * @param max_t The largest parameter value that counts as a hit.
+ * @param hits Receives the t/u/v values of every lane. Lanes that did not hit hold unspecified values.
+ * @return A bit mask with bit i set if triangle first + i was hit.
+ */
+unsigned intersect_triangles8(const TriangleSoA& triangles, std::size_t first, const glm::vec3& O, const glm::vec3& D, float max_t, TriangleHits8& hits);
+
+/**
+ * @brief Finds the closest front-facing triangle in [first, first + count) hit by O + tD.
+ *
+ * @param max_t The largest parameter value that counts as a hit. Lowered to the t of the closest hit.
+ * @param triangle Receives the index of the closest hit triangle, if any.
+ * @return Whether any triangle in the range was hit.
+ */
+bool closest_hit(const TriangleSoA& triangles, std::size_t first, std::size_t count, const glm::vec3& O, const glm::vec3& D, float& max_t, unsigned& triangle);
+
+/**
+ * @brief The name of the kernel selected for this CPU: "AVX2", "SSE4.1" or "scalar".
+ */
+const char* triangle_kernel_name();
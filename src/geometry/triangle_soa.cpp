@@ -0,0 +1,181 @@
+#include <glm/geometric.hpp>
+
+#include "triangle_soa.h"
+
+TriangleSoA::TriangleSoA() : m_size(0), m_padded_size(0)
+{
+    point_at_streams();
+}
+
+TriangleSoA::TriangleSoA(const StreamPointers& streams, std::size_t size, std::size_t padded_size) :
+    m_data(streams), m_size(size), m_padded_size(padded_size)
+{
+}
+
+TriangleSoA::TriangleSoA(const TriangleSoA& rhs) :
+    m_streams(rhs.m_streams), m_data(rhs.m_data), m_size(rhs.m_size), m_padded_size(rhs.m_padded_size)
+{
+    if (rhs.m_data[0] == rhs.m_streams[0].data()) {
+        point_at_streams();
+    }
+}
+
+TriangleSoA& TriangleSoA::operator=(const TriangleSoA& rhs)
+{
+    if (this != &rhs) {
+        m_streams = rhs.m_streams;
+        m_data = rhs.m_data;
+        m_size = rhs.m_size;
+        m_padded_size = rhs.m_padded_size;
+
+        if (rhs.m_data[0] == rhs.m_streams[0].data()) {
+            point_at_streams();
+        }
+    }
+
+    return *this;
+}
+
+void TriangleSoA::reserve(std::size_t count)
+{
+    std::size_t padded = (count + 2 * LANE_WIDTH - 2) / LANE_WIDTH * LANE_WIDTH;
+    own();
+
+    for (FloatStream& s : m_streams) {
+        s.reserve(padded);
+    }
+
+    point_at_streams();
+}
+
+void TriangleSoA::push_back(const Triangle& triangle)
+{
+    own();
+
+    if (m_size + LANE_WIDTH > m_padded_size) {
+        for (FloatStream& s : m_streams) {
+            s.resize(s.size() + LANE_WIDTH, 0.0f);
+        }
+
+        m_padded_size += LANE_WIDTH;
+        point_at_streams();
+    }
+
+    set(m_size++, triangle);
+}
+
+void TriangleSoA::set(std::size_t i, const Triangle& triangle)
+{
+    own();
+    glm::vec3 v0 = triangle.points[0];
+    glm::vec3 e1 = triangle.points[1] - v0;
+    glm::vec3 e2 = triangle.points[2] - v0;
+    glm::vec3 N = glm::cross(e1, e2);
+    float double_area = glm::length(N);
+    glm::vec3 n = double_area > 0.0f ? N / double_area : glm::vec3(0.0f);
+
+    for (int axis = 0; axis < 3; axis++) {
+        m_streams[V0_X + axis][i] = v0[axis];
+        m_streams[E1_X + axis][i] = e1[axis];
+        m_streams[E2_X + axis][i] = e2[axis];
+        m_streams[N_X + axis][i] = n[axis];
+    }
+
+    m_streams[PLANE_D][i] = glm::dot(n, v0);
+    m_streams[INV_DOUBLE_AREA][i] = double_area > 0.0f ? 1.0f / double_area : 0.0f;
+}
+
+std::size_t TriangleSoA::size() const
+{
+    return m_size;
+}
+
+std::size_t TriangleSoA::padded_size() const
+{
+    return m_padded_size;
+}
+
+std::size_t TriangleSoA::memory_usage() const
+{
+    return padded_size() * BYTES_PER_TRIANGLE;
+}
+
+const float* TriangleSoA::stream(Stream stream) const
+{
+    return m_data[stream];
+}
+
+Triangle TriangleSoA::triangle(std::size_t i) const
+{
+    glm::vec3 v0 = vertex(i);
+    return Triangle(v0, v0 + edge1(i), v0 + edge2(i));
+}
+
+glm::vec3 TriangleSoA::vertex(std::size_t i) const
+{
+    return { m_data[V0_X][i], m_data[V0_Y][i], m_data[V0_Z][i] };
+}
+
+glm::vec3 TriangleSoA::edge1(std::size_t i) const
+{
+    return { m_data[E1_X][i], m_data[E1_Y][i], m_data[E1_Z][i] };
+}
+
+glm::vec3 TriangleSoA::edge2(std::size_t i) const
+{
+    return { m_data[E2_X][i], m_data[E2_Y][i], m_data[E2_Z][i] };
+}
+
+glm::vec3 TriangleSoA::normal(std::size_t i) const
+{
+    return { m_data[N_X][i], m_data[N_Y][i], m_data[N_Z][i] };
+}
+
+float TriangleSoA::plane_offset(std::size_t i) const
+{
+    return m_data[PLANE_D][i];
+}
+
+bool TriangleSoA::intersect(std::size_t i, const glm::vec3& O, const glm::vec3& D, float max_t, float& t) const
+{
+    float u, v;
+    return intersect(i, O, D, max_t, t, u, v);
+}
+
+bool TriangleSoA::intersect(std::size_t i, const glm::vec3& O, const glm::vec3& D, float max_t, float& t, float& u, float& v) const
+{
+    // intersect_triangle()'s test with the determinant split into a unit-normal part and the
+    // precomputed 1 / |cross(e1, e2)|, and no epsilon on it
+    glm::vec3 E1 = edge1(i);
+    glm::vec3 E2 = edge2(i);
+    glm::vec3 n = normal(i);
+    float det = -glm::dot(D, n);
+    float invdet = 1.0f / det;
+    glm::vec3 AO = O - vertex(i);
+    glm::vec3 DAO = glm::cross(AO, D);
+    float uv_scale = invdet * m_data[INV_DOUBLE_AREA][i];
+    u = glm::dot(E2, DAO) * uv_scale;
+    v = -glm::dot(E1, DAO) * uv_scale;
+    t = glm::dot(AO, n) * invdet;
+    return (det > 0.0f && t >= 0.0f && t <= max_t && u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f);
+}
+
+void TriangleSoA::own()
+{
+    if (m_data[0] == m_streams[0].data()) {
+        return;
+    }
+
+    for (unsigned s = 0; s < NUM_STREAMS; s++) {
+        m_streams[s].assign(m_data[s], m_data[s] + m_padded_size);
+    }
+
+    point_at_streams();
+}
+
+void TriangleSoA::point_at_streams()
+{
+    for (unsigned s = 0; s < NUM_STREAMS; s++) {
+        m_data[s] = m_streams[s].data();
+    }
+}
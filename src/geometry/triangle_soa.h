@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "../utility/aligned_allocator.h"
+#include "geometry.h"
+
+/**
+ * @brief Structure-of-arrays triangle storage with everything a query needs precomputed.
+ *
+ * Every triangle is stored as one float in each of NUM_STREAMS separately allocated,
+ * ALIGNMENT-byte aligned streams, so queries read contiguous memory and never recompute
+ * edges, normals or plane offsets. Streams are padded to a multiple of LANE_WIDTH and always
+ * extend at least LANE_WIDTH - 1 degenerate, never-hit triangles past the last real one, so a
+ * wide kernel may load LANE_WIDTH lanes starting at any triangle.
+ *
+ * The streams may also live elsewhere, such as in a mapped cache file, and are then only
+ * copied into the TriangleSoA's own storage once it is modified.
+ */
+class TriangleSoA {
+public:
+    enum Stream {
+        V0_X, V0_Y, V0_Z,   // first vertex
+        E1_X, E1_Y, E1_Z,   // v1 - v0
+        E2_X, E2_Y, E2_Z,   // v2 - v0
+        N_X, N_Y, N_Z,      // unit normal
+        PLANE_D,            // dot(N, v0)
+        INV_DOUBLE_AREA,    // 1 / |cross(e1, e2)|, 0 for degenerate triangles
+        NUM_STREAMS
+    };
+
+    static const std::size_t ALIGNMENT = 32;
+    static const std::size_t LANE_WIDTH = 8;
+    static const std::size_t BYTES_PER_TRIANGLE = NUM_STREAMS * sizeof(float);
+
+    using StreamPointers = std::array<const float*, NUM_STREAMS>;
+
+    TriangleSoA();
+
+    /**
+     * @brief Refers to streams stored elsewhere, which must outlive the TriangleSoA or its first modification.
+     *
+     * Every stream must be ALIGNMENT-byte aligned and hold padded_size floats, laid out as above.
+     */
+    TriangleSoA(const StreamPointers& streams, std::size_t size, std::size_t padded_size);
+
+    TriangleSoA(const TriangleSoA& rhs);
+    TriangleSoA& operator=(const TriangleSoA& rhs);
+    TriangleSoA(TriangleSoA&& rhs) = default;
+    TriangleSoA& operator=(TriangleSoA&& rhs) = default;
+
+    void reserve(std::size_t count);
+    void push_back(const Triangle& triangle);
+    void set(std::size_t i, const Triangle& triangle);
+
+    std::size_t size() const;
+    std::size_t padded_size() const;
+    std::size_t memory_usage() const;
+
+    const float* stream(Stream stream) const;
+
+    Triangle triangle(std::size_t i) const;
+    glm::vec3 vertex(std::size_t i) const;
+    glm::vec3 edge1(std::size_t i) const;
+    glm::vec3 edge2(std::size_t i) const;
+    glm::vec3 normal(std::size_t i) const;
+    float plane_offset(std::size_t i) const;
+
+    /**
+     * @brief Intersects the ray O + tD with the front face of triangle i.
+     *
+     * The same test as intersect_triangle(), but on the precomputed streams. It rejects only rays
+     * that do not head against the unit normal, where intersect_triangle() rejects a determinant
+     * below 1e-6 on the unnormalized cross product, so the two can differ on grazing rays and
+     * near-degenerate triangles.
+     */
+    bool intersect(std::size_t i, const glm::vec3& O, const glm::vec3& D, float max_t, float& t) const;
+    bool intersect(std::size_t i, const glm::vec3& O, const glm::vec3& D, float max_t, float& t, float& u, float& v) const;
+private:
+    using FloatStream = std::vector<float, AlignedAllocator<float, ALIGNMENT>>;
+
+    /**
+     * @brief Copies streams stored elsewhere into m_streams before they are modified.
+     */
+    void own();
+    void point_at_streams();
+
+    std::array<FloatStream, NUM_STREAMS> m_streams;
+    StreamPointers m_data; // m_streams, or the streams stored elsewhere; moving a vector keeps its buffer
+    std::size_t m_size;
+    std::size_t m_padded_size;
+};
@@ -1,16 +1,21 @@
+#include <algorithm>
+#include <glm/geometric.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/matrix.hpp>
 
 #include "camera.h"
 
 Camera::Camera() :
+    m_transform(),
+    m_projection_matrix(),
+    m_view_matrix(),
+    m_view_projection_matrix(),
     m_aspect_ratio(1.0f),
     m_field_of_view(45.0f),
     m_near_plane(0.01f),
     m_far_plane(1000.0f),
     m_recalculate(true),
-    m_recalc_view(true),
-    m_projection_matrix(),
-    m_transform()
+    m_recalc_view(true)
 {
 }
 
@@ -43,12 +48,71 @@ const glm::mat4& Camera::get_projection_matrix() const
     if (m_recalculate) {
         m_projection_matrix = glm::perspective(glm::radians(m_field_of_view), m_aspect_ratio, m_near_plane, m_far_plane);
         m_recalculate = false;
+        m_recalc_view = true;
     }
     
     return m_projection_matrix;
 }
 
+const glm::mat4& Camera::get_view_matrix() const
+{
+    recalculate_view();
+    return m_view_matrix;
+}
+
+const glm::mat4& Camera::get_view_projection_matrix() const
+{
+    recalculate_view();
+    return m_view_projection_matrix;
+}
+
+const Frustum& Camera::get_frustum() const
+{
+    recalculate_view();
+    return m_frustum;
+}
+
 Transform& Camera::get_transform()
+{
+    m_recalc_view = true;
+    return m_transform;
+}
+
+const Transform& Camera::get_transform() const
 {
     return m_transform;
 }
+
+Ray Camera::screen_ray(const glm::vec2& cursor, const glm::vec2& viewport) const
+{
+    glm::vec2 ndc(2.0f * cursor.x / viewport.x - 1.0f, 1.0f - 2.0f * cursor.y / viewport.y);
+    const glm::mat4& projection = get_projection_matrix();
+
+    // read the direction off the projection's scale terms instead of unprojecting a far-plane
+    // point, which loses most of its precision to the near/far ratio
+    glm::vec3 view_direction(ndc.x / projection[0][0], ndc.y / projection[1][1], -1.0f);
+    glm::mat4 view_to_world = glm::inverse(get_view_matrix());
+
+    Ray ray;
+    ray.origin = glm::vec3(view_to_world * glm::vec4(view_direction * m_near_plane, 1.0f));
+    ray.direction = glm::normalize(glm::vec3(view_to_world * glm::vec4(view_direction, 0.0f)));
+    return ray;
+}
+
+float Camera::get_pixels_per_unit(float distance, float viewport_height) const
+{
+    // projection[1][1] is 1 / tan(fov / 2), which maps the half height of the view at distance 1 to one
+    return 0.5f * viewport_height * get_projection_matrix()[1][1] / std::max(distance, m_near_plane);
+}
+
+void Camera::recalculate_view() const
+{
+    const glm::mat4& projection = get_projection_matrix();
+
+    if (m_recalc_view) {
+        m_view_matrix = m_transform.get_inverse_matrix();
+        m_view_projection_matrix = projection * m_view_matrix;
+        m_frustum = Frustum(m_view_projection_matrix);
+        m_recalc_view = false;
+    }
+}
@@ -2,7 +2,10 @@
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 
+#include "../geometry/frustum.h"
+#include "../geometry/geometry.h"
 #include "../graphics/transform.h"
 
 class Camera {
@@ -15,16 +18,46 @@ public:
     void set_far_plane(float far_plane);
 
     const glm::mat4& get_projection_matrix() const;
+
+    /**
+     * @brief The view matrix, projection * view, and the world-space frustum, cached until the camera changes.
+     */
+    const glm::mat4& get_view_matrix() const;
+    const glm::mat4& get_view_projection_matrix() const;
+    const Frustum& get_frustum() const;
+
+    /**
+     * @brief The camera can be moved through the returned reference, so this marks the cached view as stale.
+     */
     Transform& get_transform();
+    const Transform& get_transform() const;
+
+    /**
+     * @brief The ray from the near plane through the point under cursor.
+     *
+     * @param cursor The cursor position with the origin at the top left, as GLFW reports it.
+     * @param viewport The size of the window in the same units as cursor.
+     */
+    Ray screen_ray(const glm::vec2& cursor, const glm::vec2& viewport) const;
+
+    /**
+     * @brief How many pixels one world unit covers at distance from the camera, in a viewport viewport_height pixels tall.
+     */
+    float get_pixels_per_unit(float distance, float viewport_height) const;
 private:
+    void recalculate_view() const;
+
     Transform m_transform;
     mutable glm::mat4 m_projection_matrix;
+    mutable glm::mat4 m_view_matrix;
+    mutable glm::mat4 m_view_projection_matrix;
+    mutable Frustum m_frustum;
 
     float m_aspect_ratio;
     float m_field_of_view;
     float m_near_plane;
     float m_far_plane;
 
-    mutable bool m_recalculate;
-    mutable bool m_recalc_view;
+    mutable bool m_recalculate; // the projection matrix is stale
+    mutable bool m_recalc_view; // the view matrix, and everything derived from the projection, is stale
 };
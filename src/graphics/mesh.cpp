@@ -1,8 +1,4 @@
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
 #include <glm/geometric.hpp>
-#include <stdexcept>
 
 #include "mesh.h"
 
@@ -11,83 +7,113 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& eleme
     init(vertices, elements);
 }
 
-Mesh::Mesh(const CollisionMesh& geometry)
+Mesh::Mesh(const CollisionMesh& geometry) : Mesh(geometry, 0, geometry.triangles().size())
+{
+}
+
+Mesh::Mesh(const CollisionMesh& geometry, std::size_t first, std::size_t count)
 {
     std::vector<Vertex> vertices;
     std::vector<GLuint> elements;
 
-    for (const Triangle& triangle : geometry.triangles()) {
-        Vertex v0, v1, v2;
+    append_flat_triangles(geometry.triangles(), first, count, vertices, elements);
+    init(vertices, elements);
+}
 
-        v0.m_position = triangle.points[0];
-        v1.m_position = triangle.points[1];
-        v2.m_position = triangle.points[2];
+Mesh::Mesh(const std::string& path)
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> elements;
+    import_model(path, vertices, elements);
 
-        glm::vec3 N = glm::normalize(glm::cross(v1.m_position - v0.m_position, v2.m_position - v0.m_position));
-        v0.m_normal = v1.m_normal = v2.m_normal = N;
-        
-        vertices.push_back(v0);
-        vertices.push_back(v1);
-        vertices.push_back(v2);
+    std::vector<glm::vec3> positions(vertices.size());
 
-        elements.push_back(vertices.size() - 3);
-        elements.push_back(vertices.size() - 2);
-        elements.push_back(vertices.size() - 1);
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].m_position;
     }
 
+    std::vector<LodLevel> lods = build_lods(positions, elements);
+    optimize_model(vertices, elements, lods);
     init(vertices, elements);
+    m_lods = lods;
 }
 
-Mesh::Mesh(const std::string& path)
+Mesh::Mesh(std::size_t num_vertices, std::size_t num_elements, const AABB& bounds) : m_bounds(bounds)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices);
+    allocate(num_vertices, nullptr, num_elements, nullptr);
+}
 
-    if (!scene) {
-        throw std::runtime_error(std::string("Failed to read '") + path + "': " + importer.GetErrorString());
+std::vector<Mesh> Mesh::split(const CollisionMesh& geometry, unsigned max_chunk_triangles)
+{
+    // triangles are stored in leaf order, so every subtree is a contiguous range of them
+    const BVH& bvh = geometry.bvh();
+    std::vector<Mesh> chunks;
+
+    for (unsigned node : bvh.subtrees(max_chunk_triangles)) {
+        unsigned first, count;
+        bvh.primitive_range(node, first, count);
+        chunks.emplace_back(geometry, first, count);
     }
 
-    std::vector<Vertex> vertices;
-    std::vector<GLuint> elements;
+    return chunks;
+}
 
-    for (unsigned i = 0; i < scene->mNumMeshes; i++) {
-        const aiMesh* mesh = scene->mMeshes[i];
+const AABB& Mesh::get_bounds() const
+{
+    return m_bounds;
+}
 
-        for (unsigned j = 0; j < mesh->mNumVertices; j++) {
-            aiVector3D position = mesh->mVertices[j];
-            aiVector3D normal = mesh->mNormals[j];
+unsigned Mesh::get_num_lods() const
+{
+    return static_cast<unsigned>(m_lods.size());
+}
 
-            Vertex vertex;
-            vertex.m_position = glm::vec3(position.x, position.y, position.z);
-            vertex.m_normal = glm::vec3(normal.x, normal.y, normal.z);
-            vertices.push_back(vertex);
-        }
+const LodLevel& Mesh::get_lod(unsigned lod) const
+{
+    return m_lods.at(lod);
+}
 
-        unsigned element_offset = static_cast<unsigned>(elements.size());
+unsigned Mesh::select_lod(float pixels_per_unit, float max_error_pixels) const
+{
+    return ::select_lod(m_lods, pixels_per_unit, max_error_pixels);
+}
 
-        for (unsigned j = 0; j < mesh->mNumFaces; j++) {
-            aiFace face = mesh->mFaces[j];
+void Mesh::upload_vertices(std::size_t first, const Vertex* vertices, std::size_t count)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(Vertex) * first, sizeof(Vertex) * count, vertices);
+}
 
-            for (unsigned k = 0; k < face.mNumIndices; k++) {
-                elements.push_back(face.mIndices[k] + element_offset);
-            }
-        }
+void Mesh::upload_elements(std::size_t first, const GLuint* elements, std::size_t count)
+{
+    // the element buffer binding belongs to the vertex array, so binding it elsewhere would change another mesh
+    glBindVertexArray(m_vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * first, sizeof(GLuint) * count, elements);
+}
+
+void Mesh::init(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements)
+{
+    m_bounds = AABB();
+
+    for (const Vertex& vertex : vertices) {
+        m_bounds.grow(vertex.m_position);
     }
 
-    init(vertices, elements);
+    allocate(vertices.size(), vertices.data(), elements.size(), elements.data());
 }
 
-void Mesh::init(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements)
+void Mesh::allocate(std::size_t num_vertices, const Vertex* vertices, std::size_t num_elements, const GLuint* elements)
 {
-    m_num_elements = static_cast<GLuint>(elements.size());
+    LodLevel full = { 0, num_elements, 0.0f };
+    m_lods.assign(1, full);
 
     glBindVertexArray(m_vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * num_vertices, vertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * elements.size(), elements.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * num_elements, elements, GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, m_position)));
@@ -95,8 +121,9 @@ void Mesh::init(const std::vector<Vertex>& vertices, const std::vector<GLuint>&
     glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, m_normal)));
 }
 
-void Mesh::draw()
+void Mesh::draw(unsigned lod)
 {
+    const LodLevel& level = m_lods[lod];
     glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_num_elements, GL_UNSIGNED_INT, static_cast<void*>(0));
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.count), GL_UNSIGNED_INT, reinterpret_cast<void*>(sizeof(GLuint) * level.first));
 }
\ No newline at end of file
@@ -1,28 +1,69 @@
 #pragma once
 
-#include <glm/vec3.hpp>
+#include <cstddef>
 #include <vector>
 
 #include "../geometry/collision_mesh.h"
+#include "../geometry/simplify.h"
 #include "../utility/gl_wrapper.h"
-
-struct Vertex {
-    glm::vec3 m_position;
-    glm::vec3 m_normal;
-};
+#include "vertex.h"
 
 class Mesh {
 public:
     Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements);
     Mesh(const CollisionMesh& geometry);
+
+    /**
+     * @brief The triangles [first, first + count) of geometry.triangles().
+     */
+    Mesh(const CollisionMesh& geometry, std::size_t first, std::size_t count);
+
+    /**
+     * @brief Loads a model and builds its levels of detail, which share the vertex buffer and follow the full mesh in the element buffer.
+     */
     Mesh(const std::string& path);
 
-    void draw();
+    /**
+     * @brief Allocates room for num_vertices and num_elements, filled in later by upload_vertices() and upload_elements().
+     *
+     * Large meshes can then be uploaded a piece per frame. The mesh draws nothing useful until it is filled.
+     */
+    Mesh(std::size_t num_vertices, std::size_t num_elements, const AABB& bounds);
+
+    /**
+     * @brief Splits geometry into spatially compact chunks of at most max_chunk_triangles triangles each, following its hierarchy.
+     *
+     * Chunks can then be culled separately, so a large mesh such as terrain only draws what is in view.
+     */
+    static std::vector<Mesh> split(const CollisionMesh& geometry, unsigned max_chunk_triangles);
+
+    /**
+     * @brief The bounds of the vertices, in model space.
+     */
+    const AABB& get_bounds() const;
+
+    /**
+     * @brief The levels of detail, from the full mesh at 0 to the coarsest. Meshes that were not loaded from a model have only the full mesh.
+     */
+    unsigned get_num_lods() const;
+    const LodLevel& get_lod(unsigned lod) const;
+
+    /**
+     * @brief The coarsest level that strays at most max_error_pixels from the full mesh, where a model unit covers pixels_per_unit.
+     */
+    unsigned select_lod(float pixels_per_unit, float max_error_pixels) const;
+
+    void upload_vertices(std::size_t first, const Vertex* vertices, std::size_t count);
+    void upload_elements(std::size_t first, const GLuint* elements, std::size_t count);
+
+    void draw(unsigned lod = 0);
 private:
     void init(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements);
+    void allocate(std::size_t num_vertices, const Vertex* vertices, std::size_t num_elements, const GLuint* elements);
 
     GL::VertexArray m_vao;
     GL::Buffer m_vbo;
     GL::Buffer m_ebo;
-    GLuint m_num_elements;
+    std::vector<LodLevel> m_lods;
+    AABB m_bounds;
 };
@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <stdexcept>
+
+#include "../geometry/mesh_optimizer.h"
+#include "../geometry/simplify.h"
+#include "occlusion_buffer.h"
+
+namespace {
+    // vertices closer than this to the eye plane would project far off screen
+    const float MIN_W = 1.0e-3f;
+
+    const std::size_t SETUP_GRAIN = 1024;
+
+    unsigned round_up_to_four(unsigned n)
+    {
+        return (n + 3) & ~3u;
+    }
+}
+
+const unsigned OcclusionBuffer::BAND_HEIGHT;
+
+OcclusionBuffer::OcclusionBuffer(unsigned width, unsigned height) :
+    m_view_projection(1.0f),
+    m_num_rasterized(0)
+{
+    if (width == 0 || height == 0) {
+        throw std::invalid_argument("OcclusionBuffer: the buffer must be at least one texel wide and high");
+    }
+
+    // every level halves the one below, rounding up, until a single texel covers the screen
+    while (true) {
+        Level level;
+        level.width = width;
+        level.height = height;
+        level.stride = round_up_to_four(width);
+        level.depth.assign(level.stride * height, 0.0f);
+        m_levels.push_back(std::move(level));
+
+        if (width == 1 && height == 1) {
+            break;
+        }
+
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    m_bins.resize((get_height() + BAND_HEIGHT - 1) / BAND_HEIGHT);
+}
+
+void OcclusionBuffer::begin(const glm::mat4& view_projection)
+{
+    m_view_projection = view_projection;
+    m_occluders.clear();
+    std::fill(m_levels[0].depth.begin(), m_levels[0].depth.end(), 0.0f);
+}
+
+void OcclusionBuffer::add_occluder(const TriangleSoA& triangles, std::size_t first, std::size_t count)
+{
+    if (first + count > triangles.size()) {
+        throw std::out_of_range("OcclusionBuffer::add_occluder: triangle range out of bounds");
+    }
+
+    m_occluders.push_back({ &triangles, first, count });
+}
+
+void OcclusionBuffer::finish(ThreadPool& pool)
+{
+    std::vector<std::size_t> offsets(1, 0);
+
+    for (const Occluder& occluder : m_occluders) {
+        offsets.push_back(offsets.back() + occluder.count);
+    }
+
+    std::size_t total = offsets.back();
+    m_screen_triangles.resize(total);
+    m_valid.resize(total);
+
+    // project four triangles at a time in parallel, straight from the occluders' streams
+    pool.parallel_for(total, SETUP_GRAIN, [&](std::size_t begin, std::size_t end) {
+        std::size_t occluder = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+
+        for (std::size_t i = begin; i < end; occluder++) {
+            std::size_t count = std::min(end, offsets[occluder + 1]) - i;
+            setup(m_occluders[occluder].triangles, m_occluders[occluder].first + i - offsets[occluder], count, i);
+            i += count;
+        }
+    });
+
+    for (std::vector<unsigned>& bin : m_bins) {
+        bin.clear();
+    }
+
+    m_num_rasterized = 0;
+
+    for (std::size_t i = 0; i < total; i++) {
+        if (!m_valid[i]) {
+            continue;
+        }
+
+        for (int band = m_screen_triangles[i].min_y / static_cast<int>(BAND_HEIGHT); band <= m_screen_triangles[i].max_y / static_cast<int>(BAND_HEIGHT); band++) {
+            m_bins[band].push_back(static_cast<unsigned>(i));
+        }
+
+        m_num_rasterized++;
+    }
+
+    // bands cover disjoint rows, so threads never write the same texel
+    pool.parallel_for(m_bins.size(), 1, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t band = begin; band < end; band++) {
+            rasterize_band(static_cast<unsigned>(band));
+        }
+    });
+
+    build_pyramid();
+}
+
+void OcclusionBuffer::setup(const TriangleSoA* triangles, std::size_t first, std::size_t count, std::size_t output)
+{
+    const glm::mat4& m = m_view_projection;
+    const __m128 half_width = _mm_set1_ps(0.5f * get_width()), half_height = _mm_set1_ps(0.5f * get_height());
+    const __m128 one = _mm_set1_ps(1.0f);
+    int height = static_cast<int>(get_height());
+    float width = static_cast<float>(get_width());
+    const float* streams[TriangleSoA::NUM_STREAMS];
+
+    for (int s = 0; s < TriangleSoA::NUM_STREAMS; s++) {
+        streams[s] = triangles->stream(static_cast<TriangleSoA::Stream>(s)) + first;
+    }
+
+    alignas(16) float x[3][4], y[3][4], depth[3][4], area[4], behind[4];
+
+    // the streams are padded past the last triangle, so whole groups of four can always be loaded
+    for (std::size_t base = 0; base < count; base += 4) {
+        __m128 v0[3], min_w = _mm_set1_ps(std::numeric_limits<float>::max());
+
+        for (int axis = 0; axis < 3; axis++) {
+            v0[axis] = _mm_loadu_ps(streams[TriangleSoA::V0_X + axis] + base);
+        }
+
+        for (int k = 0; k < 3; k++) {
+            __m128 p[3];
+
+            for (int axis = 0; axis < 3; axis++) {
+                p[axis] = k == 0 ? v0[axis] : _mm_add_ps(v0[axis], _mm_loadu_ps(streams[(k == 1 ? TriangleSoA::E1_X : TriangleSoA::E2_X) + axis] + base));
+            }
+
+            __m128 clip[4];
+
+            for (int row = 0; row < 4; row++) {
+                if (row == 2) continue; // 1 / w stands in for z
+
+                clip[row] = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][row]), p[0]), _mm_mul_ps(_mm_set1_ps(m[1][row]), p[1])),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][row]), p[2]), _mm_set1_ps(m[3][row])));
+            }
+
+            __m128 inv_w = _mm_div_ps(one, clip[3]);
+            min_w = _mm_min_ps(min_w, clip[3]);
+            _mm_store_ps(x[k], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(clip[0], inv_w), one), half_width));
+            _mm_store_ps(y[k], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(clip[1], inv_w), one), half_height));
+            _mm_store_ps(depth[k], inv_w);
+        }
+
+        __m128 x0 = _mm_load_ps(x[0]), y0 = _mm_load_ps(y[0]);
+        __m128 doubled_area = _mm_sub_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_load_ps(x[1]), x0), _mm_sub_ps(_mm_load_ps(y[2]), y0)),
+            _mm_mul_ps(_mm_sub_ps(_mm_load_ps(y[1]), y0), _mm_sub_ps(_mm_load_ps(x[2]), x0)));
+        _mm_store_ps(area, doubled_area);
+        _mm_store_ps(behind, _mm_cmplt_ps(min_w, _mm_set1_ps(MIN_W)));
+
+        for (std::size_t lane = 0; lane < 4 && base + lane < count; lane++) {
+            std::size_t i = output + base + lane;
+            m_valid[i] = 0;
+
+            if (behind[lane] != 0.0f || area[lane] == 0.0f) {
+                continue;
+            }
+
+            // both sides are drawn, so clockwise triangles are just rewound
+            int second = area[lane] < 0.0f ? 2 : 1;
+            ScreenTriangle& screen = m_screen_triangles[i];
+            screen.points[0] = glm::vec2(x[0][lane], y[0][lane]);
+            screen.points[1] = glm::vec2(x[second][lane], y[second][lane]);
+            screen.points[2] = glm::vec2(x[3 - second][lane], y[3 - second][lane]);
+            screen.depth = glm::vec3(depth[0][lane], depth[second][lane], depth[3 - second][lane]);
+
+            float min_x = std::min(std::min(x[0][lane], x[1][lane]), x[2][lane]);
+            float max_x = std::max(std::max(x[0][lane], x[1][lane]), x[2][lane]);
+            float min_y = std::min(std::min(y[0][lane], y[1][lane]), y[2][lane]);
+            float max_y = std::max(std::max(y[0][lane], y[1][lane]), y[2][lane]);
+
+            if (max_x < 0.5f || min_x > width - 0.5f) {
+                continue;
+            }
+
+            screen.min_y = std::max(static_cast<int>(std::ceil(min_y - 0.5f)), 0);
+            screen.max_y = std::min(static_cast<int>(std::floor(max_y - 0.5f)), height - 1);
+            m_valid[i] = screen.min_y <= screen.max_y;
+        }
+    }
+}
+
+void OcclusionBuffer::rasterize_band(unsigned band)
+{
+    Level& level = m_levels[0];
+    int band_min_y = band * BAND_HEIGHT;
+    int band_max_y = std::min(band_min_y + static_cast<int>(BAND_HEIGHT), static_cast<int>(level.height)) - 1;
+    const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (unsigned index : m_bins[band]) {
+        const ScreenTriangle& t = m_screen_triangles[index];
+        const glm::vec2* p = t.points;
+
+        // edge k is positive on the inside of the edge from point k to point k + 1, pulled in by
+        // half a texel so it only passes texels whose every corner is inside: a texel the triangle
+        // covers in part must not hide what shows through the rest of it
+        float A[3], B[3], C[3];
+
+        for (int k = 0; k < 3; k++) {
+            const glm::vec2& a = p[k];
+            const glm::vec2& b = p[(k + 1) % 3];
+            A[k] = a.y - b.y;
+            B[k] = b.x - a.x;
+            C[k] = -(A[k] * a.x + B[k] * a.y) - 0.5f * (std::abs(A[k]) + std::abs(B[k]));
+        }
+
+        // 1 / w is a plane over the screen, so it steps by a constant per texel
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+        float dzdx = ((t.depth[1] - t.depth[0]) * (p[2].y - p[0].y) - (t.depth[2] - t.depth[0]) * (p[1].y - p[0].y)) / area;
+        float dzdy = ((t.depth[2] - t.depth[0]) * (p[1].x - p[0].x) - (t.depth[1] - t.depth[0]) * (p[2].x - p[0].x)) / area;
+        // and written at its farthest over the texel rather than at the center
+        float dzc = t.depth[0] - dzdx * p[0].x - dzdy * p[0].y - 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+        float min_x = std::min(std::min(p[0].x, p[1].x), p[2].x);
+        float max_x = std::max(std::max(p[0].x, p[1].x), p[2].x);
+        int x_begin = std::max(static_cast<int>(std::floor(min_x - 0.5f)), 0) & ~3;
+        int x_end = std::min(static_cast<int>(std::ceil(max_x - 0.5f)), static_cast<int>(level.width) - 1);
+        int y_begin = std::max(t.min_y, band_min_y);
+        int y_end = std::min(t.max_y, band_max_y);
+
+        __m128 step_e0 = _mm_set1_ps(4.0f * A[0]), step_e1 = _mm_set1_ps(4.0f * A[1]), step_e2 = _mm_set1_ps(4.0f * A[2]);
+        __m128 step_z = _mm_set1_ps(4.0f * dzdx);
+
+        for (int y = y_begin; y <= y_end; y++) {
+            float py = y + 0.5f;
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x_begin)), lane_offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[0]), px), _mm_set1_ps(B[0] * py + C[0]));
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[1]), px), _mm_set1_ps(B[1] * py + C[1]));
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[2]), px), _mm_set1_ps(B[2] * py + C[2]));
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + dzc));
+            float* row = &level.depth[y * level.stride];
+
+            for (int x = x_begin; x <= x_end; x += 4) {
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+                if (_mm_movemask_ps(inside)) {
+                    __m128 old_depth = _mm_load_ps(row + x);
+                    __m128 new_depth = _mm_max_ps(old_depth, z);
+                    _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+                }
+
+                e0 = _mm_add_ps(e0, step_e0);
+                e1 = _mm_add_ps(e1, step_e1);
+                e2 = _mm_add_ps(e2, step_e2);
+                z = _mm_add_ps(z, step_z);
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::build_pyramid()
+{
+    for (std::size_t i = 1; i < m_levels.size(); i++) {
+        const Level& below = m_levels[i - 1];
+        Level& level = m_levels[i];
+
+        // the farthest of up to four texels, so a box in front of a texel is in front of everything under it
+        for (unsigned y = 0; y < level.height; y++) {
+            unsigned y0 = 2 * y, y1 = std::min(2 * y + 1, below.height - 1);
+
+            for (unsigned x = 0; x < level.width; x++) {
+                unsigned x0 = 2 * x, x1 = std::min(2 * x + 1, below.width - 1);
+                level.depth[y * level.stride + x] = std::min(
+                    std::min(below.depth[y0 * below.stride + x0], below.depth[y0 * below.stride + x1]),
+                    std::min(below.depth[y1 * below.stride + x0], below.depth[y1 * below.stride + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::is_visible(const AABB& box) const
+{
+    glm::vec2 size(get_width(), get_height());
+    glm::vec2 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+    float nearest = 0.0f;
+
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z);
+        glm::vec4 clip = m_view_projection * glm::vec4(point, 1.0f);
+
+        if (clip.w < MIN_W) {
+            return true;
+        }
+
+        glm::vec2 screen = (0.5f * glm::vec2(clip) / clip.w + 0.5f) * size;
+        min = glm::min(min, screen);
+        max = glm::max(max, screen);
+        nearest = std::max(nearest, 1.0f / clip.w);
+    }
+
+    // every texel the box's screen rectangle touches, not just those whose centers it covers
+    int x0 = std::max(static_cast<int>(std::floor(min.x)), 0);
+    int y0 = std::max(static_cast<int>(std::floor(min.y)), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(max.x)) - 1, static_cast<int>(get_width()) - 1);
+    int y1 = std::min(static_cast<int>(std::ceil(max.y)) - 1, static_cast<int>(get_height()) - 1);
+
+    if (x0 > x1 || y0 > y1) {
+        return true;
+    }
+
+    // climb until the rectangle spans at most four texels each way
+    unsigned level = 0;
+
+    while ((x1 - x0 > 3 || y1 - y0 > 3) && level + 1 < m_levels.size()) {
+        x0 >>= 1;
+        y0 >>= 1;
+        x1 >>= 1;
+        y1 >>= 1;
+        level++;
+    }
+
+    const Level& texels = m_levels[level];
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (texels.depth[y * texels.stride + x] <= nearest) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+unsigned OcclusionBuffer::get_width() const
+{
+    return m_levels[0].width;
+}
+
+unsigned OcclusionBuffer::get_height() const
+{
+    return m_levels[0].height;
+}
+
+unsigned OcclusionBuffer::get_num_levels() const
+{
+    return static_cast<unsigned>(m_levels.size());
+}
+
+float OcclusionBuffer::get_depth(unsigned level, unsigned x, unsigned y) const
+{
+    return m_levels[level].depth[y * m_levels[level].stride + x];
+}
+
+std::size_t OcclusionBuffer::get_num_rasterized() const
+{
+    return m_num_rasterized;
+}
+
+void OcclusionBuffer::get_image(std::vector<std::uint8_t>& pixels) const
+{
+    const Level& level = m_levels[0];
+    float nearest = 0.0f;
+
+    for (float depth : level.depth) {
+        nearest = std::max(nearest, depth);
+    }
+
+    pixels.assign(level.width * level.height, 0);
+
+    if (nearest == 0.0f) {
+        return;
+    }
+
+    // 1 / w falls off quickly with distance, so the square root keeps distant occluders visible
+    for (unsigned y = 0; y < level.height; y++) {
+        for (unsigned x = 0; x < level.width; x++) {
+            float depth = level.depth[y * level.stride + x];
+
+            if (depth > 0.0f) {
+                pixels[y * level.width + x] = static_cast<std::uint8_t>(32.0f + 223.0f * std::sqrt(depth / nearest));
+            }
+        }
+    }
+}
+
+TriangleSoA build_occluder(ArrayView<glm::vec3> positions, ArrayView<unsigned> elements, std::size_t target_triangles)
+{
+    float error;
+    std::vector<unsigned> coarse = simplify(positions, elements, target_triangles, error);
+    std::vector<unsigned> used = optimize_vertex_fetch(coarse, positions.size());
+    std::vector<glm::vec3> normals(used.size(), glm::vec3(0.0f));
+
+    // area-weighted, so slivers left by the collapses barely tilt the corners they touch
+    for (std::size_t i = 0; i < coarse.size(); i += 3) {
+        const glm::vec3& a = positions[used[coarse[i]]];
+        glm::vec3 n = glm::cross(positions[used[coarse[i + 1]]] - a, positions[used[coarse[i + 2]]] - a);
+
+        for (unsigned corner = 0; corner < 3; corner++) {
+            normals[coarse[i + corner]] += n;
+        }
+    }
+
+    std::vector<glm::vec3> corners(used.size());
+
+    for (std::size_t v = 0; v < used.size(); v++) {
+        float length = glm::length(normals[v]);
+        corners[v] = length > 0.0f ? positions[used[v]] - normals[v] * (error / length) : positions[used[v]];
+    }
+
+    TriangleSoA occluder;
+    occluder.reserve(coarse.size() / 3);
+
+    for (std::size_t i = 0; i < coarse.size(); i += 3) {
+        occluder.push_back(Triangle(corners[coarse[i]], corners[coarse[i + 1]], corners[coarse[i + 2]]));
+    }
+
+    return occluder;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <vector>
+
+#include "../geometry/geometry.h"
+#include "../geometry/triangle_soa.h"
+#include "../utility/aligned_allocator.h"
+#include "../utility/array_view.h"
+#include "../utility/thread_pool.h"
+
+/**
+ * @brief A low-resolution depth buffer drawn on the CPU from a few large occluders, for hierarchical-Z occlusion culling.
+ *
+ * Each frame, begin() clears the buffer, add_occluder() queues occluder triangles, and finish()
+ * rasterizes them and builds a pyramid where every texel holds the farthest depth of the four
+ * below it. is_visible() then compares an object's nearest depth against the few pyramid texels
+ * covering its bounds.
+ *
+ * Depth is stored as 1 / w, which interpolates linearly across the screen and keeps its precision
+ * far away. Larger values are nearer and empty texels are 0, infinitely far.
+ */
+class OcclusionBuffer {
+public:
+    static const unsigned BAND_HEIGHT = 8; // rows rasterized together by one thread
+
+    OcclusionBuffer(unsigned width, unsigned height);
+
+    /**
+     * @brief Clears the buffer for occluders seen through an OpenGL-style projection * view matrix.
+     */
+    void begin(const glm::mat4& view_projection);
+
+    /**
+     * @brief Queues triangles [first, first + count) of triangles to be drawn by finish(). They are not copied.
+     *
+     * Triangles that cross the near plane are skipped, which only makes culling less aggressive.
+     */
+    void add_occluder(const TriangleSoA& triangles, std::size_t first, std::size_t count);
+
+    /**
+     * @brief Rasterizes the queued occluders in horizontal bands across pool, then builds the pyramid.
+     */
+    void finish(ThreadPool& pool);
+
+    /**
+     * @brief Whether any part of a world-space box could be in front of the occluders.
+     *
+     * Boxes crossing the near plane or outside the screen count as visible; the frustum culls those.
+     */
+    bool is_visible(const AABB& box) const;
+
+    unsigned get_width() const;
+    unsigned get_height() const;
+    unsigned get_num_levels() const;
+
+    /**
+     * @brief The depth of texel (x, y) of a pyramid level, with row 0 at the bottom of the screen.
+     */
+    float get_depth(unsigned level, unsigned x, unsigned y) const;
+
+    /**
+     * @brief The number of occluder triangles that finish() rasterized.
+     */
+    std::size_t get_num_rasterized() const;
+
+    /**
+     * @brief Writes level 0 as 8-bit grey, bottom row first, brighter where nearer. Empty texels are black.
+     */
+    void get_image(std::vector<std::uint8_t>& pixels) const;
+private:
+    struct Occluder {
+        const TriangleSoA* triangles;
+        std::size_t first;
+        std::size_t count;
+    };
+
+    struct ScreenTriangle {
+        glm::vec2 points[3]; // in pixels, wound counter-clockwise
+        glm::vec3 depth;     // 1 / w at each point
+        int min_y, max_y;    // rows whose centers it may cover
+    };
+
+    struct Level {
+        unsigned width;
+        unsigned height;
+        unsigned stride; // floats per row, a multiple of four so rows can be loaded whole
+        std::vector<float, AlignedAllocator<float, 16>> depth;
+    };
+
+    /**
+     * @brief Projects triangles [first, first + count) of triangles into m_screen_triangles from output on.
+     */
+    void setup(const TriangleSoA* triangles, std::size_t first, std::size_t count, std::size_t output);
+    void rasterize_band(unsigned band);
+    void build_pyramid();
+
+    std::vector<Level> m_levels;
+    glm::mat4 m_view_projection;
+    std::vector<Occluder> m_occluders;
+    std::vector<ScreenTriangle> m_screen_triangles;
+    std::vector<unsigned char> m_valid;
+    std::vector<std::vector<unsigned>> m_bins; // the screen triangles overlapping each band
+    std::size_t m_num_rasterized;
+};
+
+/**
+ * @brief A coarse copy of a triangle mesh, about target_triangles of it, cheap enough to draw as an occluder.
+ *
+ * The mesh is simplified and every corner is then pulled back behind the surface, against its
+ * normal, by the simplification error, so the copy is unlikely to hide what the full mesh would not.
+ */
+TriangleSoA build_occluder(ArrayView<glm::vec3> positions, ArrayView<unsigned> elements, std::size_t target_triangles);
@@ -0,0 +1,35 @@
+#include "occlusion_overlay.h"
+
+OcclusionOverlay::OcclusionOverlay()
+{
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void OcclusionOverlay::draw(const OcclusionBuffer& buffer, unsigned scale)
+{
+    GLsizei width = buffer.get_width();
+    GLsizei height = buffer.get_height();
+    buffer.get_image(m_grey);
+    m_pixels.resize(m_grey.size() * 4);
+
+    // a red-only texture would blit as shades of red, so the grey is copied into every channel
+    for (std::size_t i = 0; i < m_grey.size(); i++) {
+        m_pixels[i * 4] = m_pixels[i * 4 + 1] = m_pixels[i * 4 + 2] = m_grey[i];
+        m_pixels[i * 4 + 3] = 255;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width * scale, height * scale, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
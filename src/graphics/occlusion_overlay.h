@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../utility/gl_wrapper.h"
+#include "occlusion_buffer.h"
+
+/**
+ * @brief Shows an OcclusionBuffer's depth in the bottom left corner of the window, for debugging.
+ */
+class OcclusionOverlay {
+public:
+    OcclusionOverlay();
+
+    /**
+     * @brief Copies buffer into the window's framebuffer, scale window pixels per texel.
+     */
+    void draw(const OcclusionBuffer& buffer, unsigned scale);
+private:
+    GL::Texture m_texture;
+    GL::Framebuffer m_framebuffer;
+    std::vector<std::uint8_t> m_grey;
+    std::vector<std::uint8_t> m_pixels;
+};
@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "tile_meshes.h"
+
+TileMeshes::TileMeshes() : m_uploaded_bytes(0)
+{
+}
+
+void TileMeshes::update(WorldStreamer& streamer, std::size_t max_upload_bytes)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!streamer.is_resident(it->first) || streamer.get_generation(it->first) != it->second.generation) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const World& world = streamer.get_world();
+    std::size_t budget = max_upload_bytes;
+    m_tiles.clear();
+
+    for (unsigned tile : streamer.get_resident()) {
+        const std::vector<Vertex>& vertices = streamer.get_vertices(tile);
+        const std::vector<unsigned>& elements = streamer.get_elements(tile);
+        auto found = m_entries.find(tile);
+
+        if (found == m_entries.end()) {
+            // a tile that draws nothing never gets a mesh
+            if (elements.empty()) {
+                continue;
+            }
+
+            Entry entry;
+            entry.generation = streamer.get_generation(tile);
+            entry.mesh.reset(new Mesh(vertices.size(), elements.size(), world.get_tiles()[tile].bounds));
+            entry.uploaded_vertices = 0;
+            entry.uploaded_elements = 0;
+            entry.complete = false;
+            found = m_entries.emplace(tile, std::move(entry)).first;
+        }
+
+        Entry& entry = found->second;
+
+        if (entry.complete) {
+            m_tiles.push_back(tile);
+            continue;
+        }
+
+        if (entry.uploaded_vertices < vertices.size() && budget >= sizeof(Vertex)) {
+            std::size_t count = std::min(vertices.size() - entry.uploaded_vertices, budget / sizeof(Vertex));
+            entry.mesh->upload_vertices(entry.uploaded_vertices, vertices.data() + entry.uploaded_vertices, count);
+            entry.uploaded_vertices += count;
+            budget -= count * sizeof(Vertex);
+        }
+
+        if (entry.uploaded_vertices == vertices.size() && entry.uploaded_elements < elements.size() && budget >= sizeof(unsigned)) {
+            std::size_t count = std::min(elements.size() - entry.uploaded_elements, budget / sizeof(unsigned));
+            entry.mesh->upload_elements(entry.uploaded_elements, elements.data() + entry.uploaded_elements, count);
+            entry.uploaded_elements += count;
+            budget -= count * sizeof(unsigned);
+        }
+
+        if (entry.uploaded_vertices == vertices.size() && entry.uploaded_elements == elements.size()) {
+            streamer.release_geometry(tile);
+            entry.complete = true;
+            m_tiles.push_back(tile);
+        }
+    }
+
+    m_uploaded_bytes = max_upload_bytes - budget;
+}
+
+const std::vector<unsigned>& TileMeshes::get_tiles() const
+{
+    return m_tiles;
+}
+
+Mesh& TileMeshes::get_mesh(unsigned tile)
+{
+    return *m_entries.at(tile).mesh;
+}
+
+std::size_t TileMeshes::get_uploaded_bytes() const
+{
+    return m_uploaded_bytes;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../gameplay/world_streamer.h"
+#include "mesh.h"
+
+/**
+ * @brief The meshes of the tiles a WorldStreamer has loaded, uploaded a little every frame.
+ *
+ * A tile's mesh is allocated once the tile is resident and filled in over as many frames as the
+ * upload budget needs, nearest tile first, so a burst of loads never stalls a frame. The tile's
+ * render geometry is then released on the CPU side, and the mesh is freed once the tile is evicted.
+ */
+class TileMeshes {
+public:
+    TileMeshes();
+
+    /**
+     * @brief Uploads at most max_upload_bytes of the resident tiles' geometry and frees the meshes of evicted ones.
+     */
+    void update(WorldStreamer& streamer, std::size_t max_upload_bytes);
+
+    /**
+     * @brief The tiles whose meshes are complete, nearest first.
+     */
+    const std::vector<unsigned>& get_tiles() const;
+    Mesh& get_mesh(unsigned tile);
+
+    /**
+     * @brief The bytes uploaded by the last update().
+     */
+    std::size_t get_uploaded_bytes() const;
+private:
+    struct Entry {
+        unsigned generation;
+        std::unique_ptr<Mesh> mesh;
+        std::size_t uploaded_vertices;
+        std::size_t uploaded_elements;
+        bool complete; // the streamer's copy is released once uploaded
+    };
+
+    std::unordered_map<unsigned, Entry> m_entries;
+    std::vector<unsigned> m_tiles;
+    std::size_t m_uploaded_bytes;
+};
@@ -1,14 +1,16 @@
+#include <glm/common.hpp>
+
 #include "transform.h"
 
 Transform::Transform() :
 m_matrix(1.0f),
 m_inverse_matrix(1.0f),
-m_recalculate_matrix(false),
-m_recalculate_inverse_matrix(false),
 m_origin(0.0f),
 m_position(0.0f),
 m_orientation(1.0f, 0.0f, 0.0f, 0.0f),
-m_scale(1.0f)
+m_scale(1.0f),
+m_recalculate_matrix(false),
+m_recalculate_inverse_matrix(false)
 {
 }
 
@@ -42,6 +44,12 @@ void Transform::set_orientation(float angle, const glm::vec3& axis)
     m_recalculate_matrix = m_recalculate_inverse_matrix = true;
 }
 
+void Transform::set_orientation(const glm::quat& orientation)
+{
+    m_orientation = orientation;
+    m_recalculate_matrix = m_recalculate_inverse_matrix = true;
+}
+
 void Transform::set_scale(const glm::vec3& scale)
 {
     m_scale = scale;
@@ -127,4 +135,15 @@ const glm::mat4& Transform::get_inverse_matrix() const
     }
 
     return m_inverse_matrix;
+}
+
+Transform Transform::interpolate(const Transform& from, const Transform& to, float alpha)
+{
+    Transform result;
+    result.m_origin = glm::mix(from.m_origin, to.m_origin, alpha);
+    result.m_position = glm::mix(from.m_position, to.m_position, alpha);
+    result.m_orientation = glm::slerp(from.m_orientation, to.m_orientation, alpha);
+    result.m_scale = glm::mix(from.m_scale, to.m_scale, alpha);
+    result.m_recalculate_matrix = result.m_recalculate_inverse_matrix = true;
+    return result;
 }
\ No newline at end of file
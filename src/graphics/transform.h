@@ -13,6 +13,7 @@ public:
     void set_origin(const glm::vec3& pivot);
     void set_position(const glm::vec3& position);
     void set_orientation(float angle, const glm::vec3& axis);
+    void set_orientation(const glm::quat& orientation);
     void set_scale(const glm::vec3& scale);
 
     void translate(const glm::vec3& offset);
@@ -29,6 +30,13 @@ public:
     glm::vec3 forward() const;
     const glm::mat4& get_matrix() const;
     const glm::mat4& get_inverse_matrix() const;
+
+    /**
+     * @brief Blends two transforms, slerping the orientation and lerping everything else.
+     *
+     * @param alpha 0 gives from, 1 gives to.
+     */
+    static Transform interpolate(const Transform& from, const Transform& to, float alpha);
 private:
     mutable glm::mat4 m_matrix;
     mutable glm::mat4 m_inverse_matrix;
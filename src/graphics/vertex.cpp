@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <stdexcept>
+
+#include "../geometry/mesh_optimizer.h"
+#include "vertex.h"
+
+void append_flat_triangles(const TriangleSoA& triangles, std::size_t first, std::size_t count, std::vector<Vertex>& vertices, std::vector<unsigned>& elements)
+{
+    for (std::size_t i = first; i < first + count; i++) {
+        Triangle triangle = triangles.triangle(i);
+        Vertex v0, v1, v2;
+
+        v0.m_position = triangle.points[0];
+        v1.m_position = triangle.points[1];
+        v2.m_position = triangle.points[2];
+        v0.m_normal = v1.m_normal = v2.m_normal = triangles.normal(i);
+
+        vertices.push_back(v0);
+        vertices.push_back(v1);
+        vertices.push_back(v2);
+
+        elements.push_back(static_cast<unsigned>(vertices.size() - 3));
+        elements.push_back(static_cast<unsigned>(vertices.size() - 2));
+        elements.push_back(static_cast<unsigned>(vertices.size() - 1));
+    }
+}
+
+void import_model(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned>& elements)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_JoinIdenticalVertices);
+
+    if (!scene) {
+        throw std::runtime_error(std::string("Failed to read '") + path + "': " + importer.GetErrorString());
+    }
+
+    vertices.clear();
+    elements.clear();
+
+    for (unsigned i = 0; i < scene->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[i];
+        unsigned vertex_offset = static_cast<unsigned>(vertices.size());
+
+        for (unsigned j = 0; j < mesh->mNumVertices; j++) {
+            aiVector3D position = mesh->mVertices[j];
+            aiVector3D normal = mesh->mNormals[j];
+
+            Vertex vertex;
+            vertex.m_position = glm::vec3(position.x, position.y, position.z);
+            vertex.m_normal = glm::vec3(normal.x, normal.y, normal.z);
+            vertices.push_back(vertex);
+        }
+
+        for (unsigned j = 0; j < mesh->mNumFaces; j++) {
+            aiFace face = mesh->mFaces[j];
+
+            for (unsigned k = 0; k < face.mNumIndices; k++) {
+                elements.push_back(face.mIndices[k] + vertex_offset);
+            }
+        }
+    }
+}
+
+void optimize_model(std::vector<Vertex>& vertices, std::vector<unsigned>& elements, const std::vector<LodLevel>& lods)
+{
+    std::vector<glm::vec3> positions(vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].m_position;
+    }
+
+    for (const LodLevel& lod : lods) {
+        std::vector<unsigned> level(elements.begin() + lod.first, elements.begin() + lod.first + lod.count);
+        optimize_vertex_cache(level, vertices.size());
+        optimize_overdraw(positions, level);
+        std::copy(level.begin(), level.end(), elements.begin() + lod.first);
+    }
+
+    std::vector<unsigned> order = optimize_vertex_fetch(elements, vertices.size());
+    std::vector<Vertex> reordered(order.size());
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+        reordered[i] = vertices[order[i]];
+    }
+
+    vertices.swap(reordered);
+}
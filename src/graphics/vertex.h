@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+
+#include "../geometry/simplify.h"
+#include "../geometry/triangle_soa.h"
+
+struct Vertex {
+    glm::vec3 m_position;
+    glm::vec3 m_normal;
+};
+
+/**
+ * @brief Appends triangles [first, first + count) as three vertices each, with the triangle's normal on all three.
+ *
+ * Holds no graphics state, so meshes can be prepared on any thread before they are uploaded.
+ */
+void append_flat_triangles(const TriangleSoA& triangles, std::size_t first, std::size_t count, std::vector<Vertex>& vertices, std::vector<unsigned>& elements);
+
+/**
+ * @brief Reads every mesh in a model file into one vertex and element array, in the file's order.
+ *
+ * @throws std::runtime_error If the file cannot be read.
+ */
+void import_model(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned>& elements);
+
+/**
+ * @brief Reorders the triangles of every level for the vertex cache and then for overdraw, then the vertices in the order they are first used.
+ *
+ * The levels keep their ranges of elements. Vertices no level uses are dropped.
+ */
+void optimize_model(std::vector<Vertex>& vertices, std::vector<unsigned>& elements, const std::vector<LodLevel>& lods);
@@ -1,56 +1,54 @@
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <string>
 #include <vector>
 
+#include "gameplay/player.h"
+#include "gameplay/player_trace.h"
+#include "gameplay/world.h"
+#include "gameplay/world_streamer.h"
+#include "geometry/frustum.h"
 #include "graphics/camera.h"
 #include "graphics/mesh.h"
 #include "graphics/mesh_shader.h"
+#include "graphics/occlusion_buffer.h"
+#include "graphics/occlusion_overlay.h"
+#include "graphics/tile_meshes.h"
 #include "graphics/transform.h"
 #include "utility/file_io.h"
+#include "utility/fixed_timestep.h"
 #include "utility/gl_wrapper.h"
+#include "utility/mapped_file.h"
+#include "utility/thread_pool.h"
 
 GLFWwindow* window;
 glm::dvec2 scroll_delta;
 
-// adapted from https://stackoverflow.com/a/42752998
-bool intersect_triangle(const glm::vec3& O, const glm::vec3& D, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
-{
-    glm::vec3 E1 = b - a;
-    glm::vec3 E2 = c - a;
-    glm::vec3 N = glm::cross(E1, E2);
-    float det = -glm::dot(D, N);
-    float invdet = 1.0f / det;
-    glm::vec3 AO = O - a;
-    glm::vec3 DAO = glm::cross(AO, D);
-    float u = glm::dot(E2, DAO) * invdet;
-    float v = -glm::dot(E1, DAO) * invdet;
-    float t = glm::dot(AO, N) * invdet;
-    return (det >= 1.0e-6f && t >= 0.0f && t <= 1.0f && u >= 0.0f && v >= 0.0f && (u + v) <= 1.0f);
-}
+// the simulation runs at a fixed rate independent of the display, catching up at most a few steps per frame
+const double SIMULATION_STEP = 1.0 / 60.0;
+const unsigned MAX_SIMULATION_STEPS = 5;
 
-/**
- * @brief Calculates the signed distance between a point and a plane.
- *
- * The result will be positive if the point is above the plane,
- * and negative if the point is below the plane.
- *
- * @param P The position of the point.
- * @param N The plane's normal vector, i.e. a unit vector perpendicular to the plane.
- * @param D A scalar representing the signed distance from the origin to the closest point on the plane.
- * @return The signed distance from point P to the plane.
- */
-float signed_distance_to_plane(const glm::vec3& P, const glm::vec3& N, float D)
-{
-    return glm::dot(N, P) - D;
-}
+// the terrain is cut into overlapping tiles, and background threads keep the ones around the player loaded
+// as far as the memory budget allows; their meshes are uploaded a few pieces per frame
+const float TERRAIN_TILE_SIZE = 16.0f;
+const float TERRAIN_TILE_MARGIN = 4.0f;
+const float TERRAIN_LOAD_RADIUS = 48.0f;
+const std::size_t TERRAIN_MEMORY_BUDGET = 64 << 20;
+const std::size_t TERRAIN_UPLOAD_BUDGET = 1 << 20;
 
-glm::vec3 intersect_ray_plane(const glm::vec3& ray_O, const glm::vec3& ray_D, const glm::vec3& plane_N, float plane_D)
-{
-    float t = (plane_D - glm::dot(plane_N, ray_O)) / glm::dot(plane_N, ray_D);
-    return ray_O + t * ray_D;
-}
+// models are drawn at the coarsest level of detail that strays at most this far from the full mesh on screen
+const float MAX_LOD_ERROR_PIXELS = 1.0f;
+
+// coarse copies of the nearest visible terrain tiles are drawn into a small depth buffer on the CPU, up to this
+// many triangles, and everything behind them is skipped; off until C is pressed, as it does not pay off everywhere
+const unsigned OCCLUSION_WIDTH = 320;
+const unsigned OCCLUSION_HEIGHT = 180;
+const unsigned MAX_OCCLUDER_TRIANGLES = 4096;
+const unsigned OCCLUSION_OVERLAY_SCALE = 2;
 
 void error_callback(int error_code, const char* description)
 {
@@ -94,24 +92,102 @@ void init()
     glEnable(GL_DEPTH_TEST);
 }
 
-void run()
+unsigned read_player_input()
 {
+    const struct {
+        int key;
+        PlayerInput input;
+    } bindings[] = {
+        { GLFW_KEY_W, INPUT_FORWARD },
+        { GLFW_KEY_S, INPUT_BACKWARD },
+        { GLFW_KEY_A, INPUT_LEFT },
+        { GLFW_KEY_D, INPUT_RIGHT },
+        { GLFW_KEY_E, INPUT_UP },
+        { GLFW_KEY_Q, INPUT_DOWN },
+        { GLFW_KEY_LEFT, INPUT_TURN_LEFT },
+        { GLFW_KEY_RIGHT, INPUT_TURN_RIGHT },
+        { GLFW_KEY_UP, INPUT_PITCH_UP },
+        { GLFW_KEY_DOWN, INPUT_PITCH_DOWN },
+    };
+
+    unsigned input = 0;
+
+    for (const auto& binding : bindings) {
+        if (glfwGetKey(window, binding.key) == GLFW_PRESS) {
+            input |= binding.input;
+        }
+    }
+
+    return input;
+}
+
+/**
+ * @brief Runs the game until the window closes.
+ *
+ * @param trace_path If not empty, the player's inputs are recorded and saved there on exit.
+ */
+void run(const std::string& trace_path)
+{
+    const char* terrain_path = "res/models/grandure.obj";
     Camera camera;
     MeshShader mesh_shader;
-    CollisionMesh terrain_geometry("res/models/grandure.obj");
-    Mesh terrain(terrain_geometry);
-    Mesh player("res/models/suzanne.obj");
-    Transform player_transform;
+    ThreadPool pool;
+    std::string world_path = std::string(terrain_path) + ".world";
+    std::uint64_t terrain_hash, terrain_size;
+
+    {
+        MappedFile source(terrain_path);
+        terrain_hash = source.hash();
+        terrain_size = source.size();
+    }
+
+    if (!World::is_current(world_path, terrain_hash, terrain_size, TERRAIN_TILE_SIZE, TERRAIN_TILE_MARGIN)) {
+        CollisionMesh terrain_geometry(terrain_path, BVH::BEST, pool);
+        World::build(terrain_geometry, world_path, TERRAIN_TILE_SIZE, TERRAIN_TILE_MARGIN, terrain_hash, terrain_size, pool);
+    }
+
+    World world(world_path);
+    WorldStreamer streamer(world, TERRAIN_MEMORY_BUDGET, TERRAIN_LOAD_RADIUS);
+    TileMeshes terrain_meshes;
+    const char* player_path = "res/models/suzanne.obj";
+    Mesh player_mesh(player_path);
+    ConvexHull player_hull(CollisionMesh(player_path).vertices());
+    Player player(1.0f);
+    player.set_hull(&player_hull);
+    FixedTimestep timestep(SIMULATION_STEP, MAX_SIMULATION_STEPS);
+
+    streamer.wait_for(player.get_transform().get_position());
+
+    // the player's box goes first, followed by the terrain tiles that are ready to draw
+    BoxSoA bounds;
+    std::vector<unsigned> visible, occluders;
+    std::size_t drawn_objects = 0, occluded_objects = 0, drawn_triangles = 0, drawn_frames = 0;
+
+    OcclusionBuffer occlusion(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    OcclusionOverlay occlusion_overlay;
+    bool occlusion_culling = false;
+    bool culling_key_down = false;
+    bool show_occlusion = false;
+    bool occlusion_key_down = false;
+
+    PlayerTrace trace;
+    trace.mesh_path = terrain_path;
+    trace.hull_path = player_path;
+    trace.radius = player.get_radius();
+    trace.step = timestep.step();
+    trace.start_position = player.get_transform().get_position();
+    trace.start_orientation = player.get_transform().get_orientation();
 
     float camera_zoom = 4.0f;
 
     double last_frame = glfwGetTime();
+    double last_stats = last_frame;
     glm::dvec2 last_cursor_pos;
     glfwGetCursorPos(window, &last_cursor_pos.x, &last_cursor_pos.y);
 
     while (!glfwWindowShouldClose(window)) {
         double current_frame = glfwGetTime();
-        float dt = static_cast<float>(current_frame - last_frame);
+        unsigned steps = timestep.advance(current_frame - last_frame);
         last_frame = current_frame;
 
         glm::dvec2 current_cursor_pos;
@@ -141,65 +217,145 @@ void run()
             camera.set_aspect_ratio(static_cast<float>(window_size.x) / window_size.y);
         }
 
-        float movement_speed = 4.0f * dt;
-        float rotation_speed = 180.0f * dt;
-        glm::vec3 player_velocity = { 0.0f, 0.0f, 0.0f };
-
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) player_velocity += player_transform.forward() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) player_velocity -= player_transform.right() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) player_velocity -= player_transform.forward() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) player_velocity += player_transform.right() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) player_velocity += player_transform.up() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) player_velocity -= player_transform.up() * movement_speed;
-        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) player_transform.rotate(rotation_speed, { 0.0f, 1.0f, 0.0f });
-        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) player_transform.rotate(-rotation_speed, { 0.0f, 1.0f, 0.0f });
-        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) player_transform.rotate(rotation_speed, player_transform.right());
-        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) player_transform.rotate(-rotation_speed, player_transform.right());
-
-        bool collision;
-
-        do {
-            collision = false;
-
-            for (const Triangle& triangle : terrain_geometry.triangles()) {
-                glm::vec3 v0 = triangle.points[0];
-                glm::vec3 v1 = triangle.points[1];
-                glm::vec3 v2 = triangle.points[2];
-                glm::vec3 N = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-
-                if (intersect_triangle(player_transform.get_position(), player_velocity, v0, v1, v2)) {
-                    glm::vec3 new_position = intersect_ray_plane(player_transform.get_position(), glm::normalize(player_velocity), N, glm::dot(N, v0));
-                    glm::vec3 new_velocity = N * -signed_distance_to_plane(player_transform.get_position() + player_velocity, N, glm::dot(N, v0));
-                    player_transform.set_position(new_position);
-                    player_velocity = new_velocity;
-                    collision = true;
-                }
+        bool culling_key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+        occlusion_culling ^= culling_key && !culling_key_down;
+        culling_key_down = culling_key;
+
+        bool occlusion_key = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+        show_occlusion ^= occlusion_key && !occlusion_key_down;
+        occlusion_key_down = occlusion_key;
+
+        unsigned input = read_player_input();
+
+        // the player waits for the tile it stands on, which only happens when it outruns the loaders;
+        // the steps it misses are run once the tile is in
+        streamer.update(player.get_transform().get_position());
+
+        for (unsigned step = 0; step < steps; step++) {
+            const CollisionMesh* terrain_geometry = streamer.get_collision_at(player.get_transform().get_position());
+
+            if (!terrain_geometry) {
+                timestep.defer(steps - step);
+                break;
+            }
+
+            player.step(*terrain_geometry, input, static_cast<float>(timestep.step()));
+
+            if (!trace_path.empty()) {
+                trace.inputs.push_back(input);
             }
-        } while (collision);
+        }
 
-        player_transform.translate(player_velocity);
+        terrain_meshes.update(streamer, TERRAIN_UPLOAD_BUDGET);
+        const std::vector<unsigned>& terrain_tiles = terrain_meshes.get_tiles();
+
+        if (current_frame - last_stats >= 1.0) {
+            char title[200];
+            ContactCache& contacts = player.get_contacts();
+            std::snprintf(title, sizeof(title), "playtest - contact cache %.0f%% hits, %.1f triangles/step, drawn %.0f/%zu, %.0f occluded, %.0fk triangles", 100.0f * contacts.hit_rate(), contacts.triangles_per_query(), drawn_frames > 0 ? static_cast<double>(drawn_objects) / drawn_frames : 0.0, bounds.size(), drawn_frames > 0 ? static_cast<double>(occluded_objects) / drawn_frames : 0.0, drawn_frames > 0 ? drawn_triangles / 1.0e3 / drawn_frames : 0.0);
+            glfwSetWindowTitle(window, title);
+            contacts.reset_stats();
+            drawn_objects = occluded_objects = drawn_triangles = drawn_frames = 0;
+            last_stats = current_frame;
+        }
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
         mesh_shader.use();
         mesh_shader.set_projection_matrix(camera.get_projection_matrix());
-        mesh_shader.set_view_matrix(camera.get_transform().get_inverse_matrix());
+        mesh_shader.set_view_matrix(camera.get_view_matrix());
+
+        glm::mat4 player_matrix = Transform::interpolate(player.get_previous_transform(), player.get_transform(), timestep.alpha()).get_matrix();
+        AABB player_bounds = transform_aabb(player_matrix, player_mesh.get_bounds());
+        bounds.clear();
+        bounds.push_back(player_bounds);
+
+        for (unsigned tile : terrain_tiles) {
+            bounds.push_back(terrain_meshes.get_mesh(tile).get_bounds());
+        }
+
+        cull_boxes(camera.get_frustum(), bounds, visible);
 
-        mesh_shader.set_color({ 1.0f, 0.5f, 0.5f });
-        mesh_shader.set_model_matrix(player_transform.get_matrix());
-        player.draw();
+        auto object_bounds = [&](unsigned object) -> const AABB& {
+            return object == 0 ? player_bounds : terrain_meshes.get_mesh(terrain_tiles[object - 1]).get_bounds();
+        };
 
-        mesh_shader.set_color({ 1.0f, 1.0f, 1.0f });
-        mesh_shader.set_model_matrix(glm::mat4(1.0f));
-        terrain.draw();
+        glm::vec3 eye(camera.get_transform().get_matrix()[3]);
+
+        if (occlusion_culling) {
+            // the nearest tiles cover the most of the screen, so they make the best occluders
+            occluders.assign(visible.begin(), visible.end());
+            occluders.erase(std::remove(occluders.begin(), occluders.end(), 0u), occluders.end());
+            std::sort(occluders.begin(), occluders.end(), [&](unsigned a, unsigned b) {
+                return object_bounds(a).distance(eye) < object_bounds(b).distance(eye);
+            });
+
+            occlusion.begin(camera.get_view_projection_matrix());
+            unsigned occluder_triangles = 0;
+
+            for (unsigned object : occluders) {
+                const TriangleSoA& triangles = world.get_occluder(terrain_tiles[object - 1]);
+
+                if (occluder_triangles + triangles.size() > MAX_OCCLUDER_TRIANGLES) {
+                    break;
+                }
+
+                occlusion.add_occluder(triangles, 0, triangles.size());
+                occluder_triangles += static_cast<unsigned>(triangles.size());
+            }
+
+            occlusion.finish(pool);
+        }
+
+        drawn_frames++;
+
+        for (unsigned object : visible) {
+            if (occlusion_culling && !occlusion.is_visible(object_bounds(object))) {
+                occluded_objects++;
+                continue;
+            }
+
+            drawn_objects++;
+
+            if (object == 0) {
+                float pixels_per_unit = camera.get_pixels_per_unit(player_bounds.distance(eye), static_cast<float>(window_size.y));
+                unsigned lod = player_mesh.select_lod(pixels_per_unit, MAX_LOD_ERROR_PIXELS);
+                mesh_shader.set_color({ 1.0f, 0.5f, 0.5f });
+                mesh_shader.set_model_matrix(player_matrix);
+                player_mesh.draw(lod);
+                drawn_triangles += player_mesh.get_lod(lod).count / 3;
+            } else {
+                Mesh& tile_mesh = terrain_meshes.get_mesh(terrain_tiles[object - 1]);
+                mesh_shader.set_color({ 1.0f, 1.0f, 1.0f });
+                mesh_shader.set_model_matrix(glm::mat4(1.0f));
+                tile_mesh.draw();
+                drawn_triangles += tile_mesh.get_lod(0).count / 3;
+            }
+        }
+
+        if (occlusion_culling && show_occlusion) {
+            occlusion_overlay.draw(occlusion, OCCLUSION_OVERLAY_SCALE);
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
+
+    if (!trace_path.empty()) {
+        save_trace(trace_path, trace);
+    }
 }
 
 int main(int argc, char** argv)
 {
+    std::string trace_path;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--record" && i + 1 < argc) {
+            trace_path = argv[++i];
+        }
+    }
+
     try {
         init();
     } catch (std::exception& ex) {
@@ -208,7 +364,7 @@ int main(int argc, char** argv)
     }
 
     try {
-        run();
+        run(trace_path);
     } catch (GL::Exception& ex) {
         std::cerr << "[OpenGL] " << ex.what() << std::endl;
     } catch (std::exception& ex) {
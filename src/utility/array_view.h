@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A read-only view of a contiguous array owned elsewhere, such as a vector or a mapped file.
+ *
+ * The view does not keep the array alive, and is invalidated by anything that reallocates it.
+ */
+template <typename T>
+class ArrayView {
+public:
+    ArrayView() : m_data(nullptr), m_size(0)
+    {
+    }
+
+    ArrayView(const T* data, std::size_t size) : m_data(data), m_size(size)
+    {
+    }
+
+    template <typename Allocator>
+    ArrayView(const std::vector<T, Allocator>& vector) : m_data(vector.data()), m_size(vector.size())
+    {
+    }
+
+    const T* data() const
+    {
+        return m_data;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    const T* begin() const
+    {
+        return m_data;
+    }
+
+    const T* end() const
+    {
+        return m_data + m_size;
+    }
+
+    const T& operator[](std::size_t i) const
+    {
+        return m_data[i];
+    }
+private:
+    const T* m_data;
+    std::size_t m_size;
+};
@@ -0,0 +1,65 @@
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "cpu_features.h"
+
+namespace {
+    void cpuid(int info[4], int leaf, int subleaf)
+    {
+#ifdef _MSC_VER
+        __cpuidex(info, leaf, subleaf);
+#else
+        unsigned a, b, c, d;
+        __cpuid_count(leaf, subleaf, a, b, c, d);
+        info[0] = static_cast<int>(a);
+        info[1] = static_cast<int>(b);
+        info[2] = static_cast<int>(c);
+        info[3] = static_cast<int>(d);
+#endif
+    }
+
+    unsigned long long xgetbv()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+    }
+
+    CpuFeatures detect()
+    {
+        int info[4];
+        cpuid(info, 0, 0);
+        int max_leaf = info[0];
+
+        cpuid(info, 1, 0);
+        CpuFeatures features;
+        features.sse41 = (info[2] & (1 << 19)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        bool ymm_enabled = osxsave && avx && (xgetbv() & 0x6) == 0x6;
+        features.avx = ymm_enabled;
+        features.avx2 = false;
+
+        if (max_leaf >= 7 && ymm_enabled) {
+            cpuid(info, 7, 0);
+            features.avx2 = (info[1] & (1 << 5)) != 0;
+        }
+
+        return features;
+    }
+}
+
+const CpuFeatures& cpu_features()
+{
+    static const CpuFeatures features = detect();
+    return features;
+}
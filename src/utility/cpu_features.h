@@ -0,0 +1,14 @@
+#pragma once
+
+/**
+ * @brief The SIMD extensions this CPU and OS support, read once from CPUID at startup.
+ *
+ * AVX and AVX2 also require the OS to save the upper halves of the ymm registers.
+ */
+struct CpuFeatures {
+    bool sse41;
+    bool avx;
+    bool avx2;
+};
+
+const CpuFeatures& cpu_features();
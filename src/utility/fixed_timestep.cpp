@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "fixed_timestep.h"
+
+FixedTimestep::FixedTimestep(double step, unsigned max_steps) :
+    m_step(step), m_max_steps(max_steps), m_accumulator(0.0), m_dropped_time(0.0)
+{
+    if (!(step > 0.0) || max_steps == 0) {
+        throw std::invalid_argument("FixedTimestep: step and max steps must be positive");
+    }
+}
+
+unsigned FixedTimestep::advance(double elapsed)
+{
+    m_accumulator += elapsed;
+
+    if (m_accumulator >= m_step * (m_max_steps + 1)) {
+        double kept = m_step * m_max_steps;
+        m_dropped_time += m_accumulator - kept;
+        m_accumulator = kept;
+    }
+
+    unsigned steps = 0;
+
+    while (m_accumulator >= m_step) {
+        m_accumulator -= m_step;
+        steps++;
+    }
+
+    return steps;
+}
+
+void FixedTimestep::defer(unsigned steps)
+{
+    m_accumulator += m_step * steps;
+}
+
+double FixedTimestep::step() const
+{
+    return m_step;
+}
+
+float FixedTimestep::alpha() const
+{
+    return static_cast<float>(std::min(m_accumulator / m_step, 1.0));
+}
+
+double FixedTimestep::dropped_time() const
+{
+    return m_dropped_time;
+}
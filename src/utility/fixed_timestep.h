@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * @brief Turns variable frame times into a whole number of fixed-length simulation steps.
+ *
+ * Frame time accumulates until it covers a step, and the remainder carries over to the
+ * next frame. alpha() tells how far the current frame lies between the last two steps,
+ * for interpolating what is drawn.
+ */
+class FixedTimestep {
+public:
+    /**
+     * @param step The simulated time per step, in seconds.
+     * @param max_steps The most steps a single frame may run. Time beyond that is dropped,
+     *        so a slow frame cannot snowball into ever longer catch-up frames.
+     */
+    FixedTimestep(double step, unsigned max_steps);
+
+    /**
+     * @brief Adds elapsed seconds of frame time and returns the number of steps to simulate.
+     */
+    unsigned advance(double elapsed);
+
+    /**
+     * @brief Hands back steps that advance() returned but were not simulated, so later frames run them.
+     *
+     * They still count towards max_steps, so a long wait ends up in dropped_time().
+     */
+    void defer(unsigned steps);
+
+    double step() const;
+
+    /**
+     * @brief The fraction of a step accumulated since the last one, in [0, 1), or 1 while deferred steps wait.
+     */
+    float alpha() const;
+
+    /**
+     * @brief The total time dropped because a frame needed more than max_steps steps.
+     */
+    double dropped_time() const;
+private:
+    double m_step;
+    unsigned m_max_steps;
+    double m_accumulator;
+    double m_dropped_time;
+};
@@ -40,6 +40,35 @@ namespace GL {
         return m_id;
     }
 
+    Framebuffer::Framebuffer()
+    {
+        glGenFramebuffers(1, &m_id);
+    }
+
+    Framebuffer::~Framebuffer()
+    {
+        glDeleteFramebuffers(1, &m_id);
+    }
+
+    Framebuffer::Framebuffer(Framebuffer&& rhs) noexcept : m_id(std::exchange(rhs.m_id, 0))
+    {
+    }
+
+    Framebuffer& Framebuffer::operator=(Framebuffer&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            glDeleteFramebuffers(1, &m_id);
+            m_id = std::exchange(rhs.m_id, 0);
+        }
+
+        return *this;
+    }
+
+    Framebuffer::operator GLuint() const
+    {
+        return m_id;
+    }
+
     Program::Program() : m_id(glCreateProgram())
     {
         if (!m_id) {
@@ -26,6 +26,22 @@ namespace GL {
         GLuint m_id;
     };
 
+    class Framebuffer {
+    public:
+        Framebuffer();
+        ~Framebuffer();
+
+        Framebuffer(const Framebuffer&) = delete;
+        Framebuffer& operator=(const Framebuffer&) = delete;
+
+        Framebuffer(Framebuffer&& rhs) noexcept;
+        Framebuffer& operator=(Framebuffer&& rhs) noexcept;
+
+        operator GLuint() const;
+    private:
+        GLuint m_id;
+    };
+
     class Program {
     public:
         Program();
@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+namespace {
+    const std::uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+    const std::uint64_t FNV_PRIME = 0x100000001B3ull;
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) :
+    m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+    // sharing delete access lets replace_file() move the file aside while it is mapped
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(std::string("Failed to open '") + path + "'");
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(m_file, &size)) {
+        CloseHandle(m_file);
+        throw std::runtime_error(std::string("Failed to read the size of '") + path + "'");
+    }
+
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    // empty files cannot be mapped, and have nothing to map anyway
+    if (m_size > 0) {
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view = m_mapping ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        if (!view) {
+            if (m_mapping) {
+                CloseHandle(m_mapping);
+            }
+
+            CloseHandle(m_file);
+            throw std::runtime_error(std::string("Failed to map '") + path + "'");
+        }
+
+        m_data = static_cast<const std::uint8_t*>(view);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+
+    CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) :
+    m_data(nullptr), m_size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Failed to open '") + path + "'");
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Failed to read the size of '") + path + "'");
+    }
+
+    m_size = static_cast<std::size_t>(status.st_size);
+
+    // empty files cannot be mapped, and have nothing to map anyway
+    if (m_size > 0) {
+        void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (view == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(std::string("Failed to map '") + path + "'");
+        }
+
+        m_data = static_cast<const std::uint8_t*>(view);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        munmap(const_cast<std::uint8_t*>(m_data), m_size);
+    }
+}
+#endif
+
+const std::uint8_t* MappedFile::data() const
+{
+    return m_data;
+}
+
+std::size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+std::uint64_t MappedFile::hash() const
+{
+    // FNV-1a over 8-byte words rather than single bytes, so hashing keeps up with the disk;
+    // the shift folds the high bits of each product back down, which a multiply alone never does
+    std::uint64_t hash = FNV_OFFSET ^ m_size;
+    std::size_t i = 0;
+
+    for (; i + 8 <= m_size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, m_data + i, 8);
+        hash = (hash ^ word) * FNV_PRIME;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < m_size; i++) {
+        hash = (hash ^ m_data[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+bool replace_file(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    // rename() refuses to replace an existing file here
+    if (MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        return true;
+    }
+
+    // nor can MoveFileEx() while someone has the old file mapped, but it can still be moved aside
+    // and deleted, which takes effect once the last mapping is gone
+    std::string aside = to + ".old";
+
+    if (!MoveFileExA(to.c_str(), aside.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        return false;
+    }
+
+    if (!MoveFileExA(from.c_str(), to.c_str(), 0)) {
+        MoveFileExA(aside.c_str(), to.c_str(), 0);
+        return false;
+    }
+
+    DeleteFileA(aside.c_str());
+    return true;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
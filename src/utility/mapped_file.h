@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief A whole file mapped read-only into memory.
+ *
+ * Pages are read from disk the first time they are touched, and the mapping starts on a
+ * page boundary, so data laid out at aligned offsets in the file can be used in place.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Throws std::runtime_error if path cannot be opened or mapped.
+     */
+    MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::uint8_t* data() const;
+    std::size_t size() const;
+
+    /**
+     * @brief A 64-bit hash of the contents, for telling whether the file has changed.
+     *
+     * Not meant to resist deliberate collisions.
+     */
+    std::uint64_t hash() const;
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+/**
+ * @brief Renames from to to, replacing to if it exists, so readers see either the old file or the new one.
+ *
+ * to may still be mapped by a MappedFile, which keeps reading the old contents. On Windows that
+ * file is moved aside to to + ".old" first, so to is missing for a moment.
+ *
+ * @return false if the file could not be moved, in which case both files are left as they were.
+ */
+bool replace_file(const std::string& from, const std::string& to);
@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned num_threads) :
+    m_task(nullptr),
+    m_count(0),
+    m_grain(1),
+    m_next(0),
+    m_generation(0),
+    m_busy(0),
+    m_stop(false)
+{
+    for (unsigned i = 1; i < std::max(num_threads, 1u); i++) {
+        m_threads.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned ThreadPool::size() const
+{
+    return static_cast<unsigned>(m_threads.size()) + 1;
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t grain, const Task& task)
+{
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max<std::size_t>(grain, 1);
+
+    if (m_threads.empty() || count <= grain) {
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            task(begin, std::min(begin + grain, count));
+        }
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_grain = grain;
+        m_next = 0;
+        m_busy = static_cast<unsigned>(m_threads.size());
+        m_generation++;
+    }
+
+    m_wake.notify_all();
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::worker_loop()
+{
+    unsigned generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+            if (m_stop) {
+                return;
+            }
+
+            generation = m_generation;
+        }
+
+        run_chunks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (--m_busy == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run_chunks()
+{
+    while (true) {
+        std::size_t begin = m_next.fetch_add(m_grain);
+
+        if (begin >= m_count) {
+            return;
+        }
+
+        (*m_task)(begin, std::min(begin + m_grain, m_count));
+    }
+}
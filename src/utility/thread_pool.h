@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that split index ranges between themselves.
+ *
+ * Work is handed out in chunks from a single atomic counter, so threads that finish
+ * early simply claim more chunks. The calling thread takes part in every job.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void(std::size_t begin, std::size_t end)>;
+
+    ThreadPool(unsigned num_threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief The number of threads that run a job, including the calling thread.
+     */
+    unsigned size() const;
+
+    /**
+     * @brief Calls task(begin, end) for consecutive chunks of at most grain indices covering [0, count).
+     *
+     * Blocks until every chunk has been processed. Chunks may run on any thread in any order,
+     * so the task must not write to state shared between chunks.
+     */
+    void parallel_for(std::size_t count, std::size_t grain, const Task& task);
+private:
+    void worker_loop();
+    void run_chunks();
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_submit_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const Task* m_task;
+    std::size_t m_count;
+    std::size_t m_grain;
+    std::atomic<std::size_t> m_next;
+    unsigned m_generation;
+    unsigned m_busy;
+    bool m_stop;
+};